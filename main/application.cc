@@ -9,6 +9,8 @@
 #include "mcp_server.h"
 #include "assets.h"
 #include "settings.h"
+#include "network_metrics.h"
+#include "http_pool.h"
 
 #include <cstring>
 #include <esp_log.h>
@@ -257,7 +259,7 @@ void Application::ShowActivationCode(const std::string& code, const std::string&
         digit_sound{'9', Lang::Sounds::OGG_9}
     }};
 
-    // This sentence uses 9KB of SRAM, so we need to wait for it to finish
+    // PlaySound() only queues the sound, the digits are played in order after this sentence
     Alert(Lang::Strings::ACTIVATION, message.c_str(), "link", Lang::Sounds::OGG_ACTIVATION);
 
     for (const auto& digit : code) {
@@ -402,6 +404,7 @@ void Application::Start() {
     /* Setup the audio service */
     auto codec = board.GetAudioCodec();
     audio_service_.Initialize(codec);
+    audio_service_.SetSoundPacketIndex(Lang::Sounds::PACKET_INDEX);
     audio_service_.Start();
 
     AudioServiceCallbacks callbacks;
@@ -409,6 +412,13 @@ void Application::Start() {
         xEventGroupSetBits(event_group_, MAIN_EVENT_SEND_AUDIO);
     };
     callbacks.on_wake_word_detected = [this](const std::string& wake_word) {
+        wake_detected_us_ = AudioLatencyTracker::Now();
+        // Connecting can run on its own task while the main loop encodes the pre-roll
+        Schedule([this]() {
+            if (protocol_ && device_state_ == kDeviceStateIdle) {
+                protocol_->WarmUp();
+            }
+        });
         xEventGroupSetBits(event_group_, MAIN_EVENT_WAKE_WORD_DETECTED);
     };
     callbacks.on_vad_change = [this](bool speaking) {
@@ -465,6 +475,8 @@ void Application::Start() {
         protocol_ = std::make_unique<MqttProtocol>();
     }
 
+    UpdateFrameDuration();
+
     protocol_->OnConnected([this]() {
         DismissAlert();
     });
@@ -484,13 +496,22 @@ void Application::Start() {
             ESP_LOGW(TAG, "Server sample rate %d does not match device output sample rate %d, resampling may cause distortion",
                 protocol_->server_sample_rate(), codec->output_sample_rate());
         }
+        // The server hello announced the TTS format, have its decoder ready before the first packet
+        audio_service_.PrepareDecoder(protocol_->server_sample_rate(), protocol_->server_frame_duration());
+        audio_service_.SetFrameDuration(protocol_->client_frame_duration());
+        audio_service_.ResetJitterBuffer();
     });
     protocol_->OnAudioChannelClosed([this, &board]() {
         board.SetPowerSaveMode(true);
         Schedule([this]() {
+            send_scheduler_.Clear();
             auto display = Board::GetInstance().GetDisplay();
             display->SetChatMessage("system", "");
             SetDeviceState(kDeviceStateIdle);
+            // A follow-up question often comes soon after a chat
+            if (protocol_) {
+                protocol_->WarmUp();
+            }
         });
     });
     protocol_->OnIncomingJson([this, display](const cJSON* root) {
@@ -612,12 +633,17 @@ void Application::Schedule(std::function<void()> callback) {
 // they should use Schedule to call this function
 void Application::MainEventLoop() {
     while (true) {
+        // Frames held back to fill an aggregated packet are sent when their latency budget runs out
+        int flush_delay_ms = send_scheduler_.FlushDelayMs();
         auto bits = xEventGroupWaitBits(event_group_, MAIN_EVENT_SCHEDULE |
             MAIN_EVENT_SEND_AUDIO |
             MAIN_EVENT_WAKE_WORD_DETECTED |
             MAIN_EVENT_VAD_CHANGE |
             MAIN_EVENT_CLOCK_TICK |
-            MAIN_EVENT_ERROR, pdTRUE, pdFALSE, portMAX_DELAY);
+            MAIN_EVENT_ERROR, pdTRUE, pdFALSE, flush_delay_ms < 0 ? portMAX_DELAY : pdMS_TO_TICKS(flush_delay_ms) + 1);
+        if (flush_delay_ms >= 0 && send_scheduler_.FlushDelayMs() == 0) {
+            bits |= MAIN_EVENT_SEND_AUDIO;
+        }
 
         if (bits & MAIN_EVENT_ERROR) {
             SetDeviceState(kDeviceStateIdle);
@@ -626,14 +652,11 @@ void Application::MainEventLoop() {
 
         if (bits & MAIN_EVENT_SEND_AUDIO) {
             while (auto packet = audio_service_.PopPacketFromSendQueue()) {
-                if (protocol_ && !protocol_->SendAudio(std::move(packet))) {
-                    break;
-                }
+                send_scheduler_.Push(std::move(packet));
+            }
+            if (protocol_) {
+                audio_service_.ReportSendResult(send_scheduler_.Flush(*protocol_));
             }
-        }
-
-        if (bits & MAIN_EVENT_WAKE_WORD_DETECTED) {
-            OnWakeWordDetected();
         }
 
         if (bits & MAIN_EVENT_VAD_CHANGE) {
@@ -652,8 +675,17 @@ void Application::MainEventLoop() {
             }
         }
 
+        // After the scheduled tasks, so the warm-up posted with the wake word starts before the channel opens
+        if (bits & MAIN_EVENT_WAKE_WORD_DETECTED) {
+            OnWakeWordDetected();
+        }
+
         if (bits & MAIN_EVENT_CLOCK_TICK) {
             clock_ticks_++;
+            // Frames left after a failed write are retried at least once per tick
+            if (!send_scheduler_.Empty()) {
+                xEventGroupSetBits(event_group_, MAIN_EVENT_SEND_AUDIO);
+            }
             auto display = Board::GetInstance().GetDisplay();
             UpdateIdleDisplay();
             display->UpdateStatusBar();
@@ -666,6 +698,7 @@ void Application::MainEventLoop() {
                 // SystemInfo::PrintTaskCpuUsage(pdMS_TO_TICKS(1000));
                 // SystemInfo::PrintTaskList();
                 SystemInfo::PrintHeapStats();
+                AudioPool::PrintStatistics();
             }
         }
     }
@@ -686,13 +719,14 @@ void Application::OnWakeWordDetected() {
                 return;
             }
         }
+        audio_service_.GetLatencyTracker().TraceWakeToOpen(wake_detected_us_, AudioLatencyTracker::Now());
 
         auto wake_word = audio_service_.GetLastWakeWord();
         ESP_LOGI(TAG, "Wake word detected: %s", wake_word.c_str());
 #if CONFIG_SEND_WAKE_WORD_DATA
         // Encode and send the wake word data to the server
         while (auto packet = audio_service_.PopWakeWordPacket()) {
-            protocol_->SendAudio(std::move(packet));
+            protocol_->SendAudio(*packet);
         }
         // Set the chat state to wake word detected
         protocol_->SendWakeWordDetected(wake_word);
@@ -722,6 +756,14 @@ void Application::SetListeningMode(ListeningMode mode) {
     SetDeviceState(kDeviceStateListening);
 }
 
+/* Realtime chat trades some CPU for shorter frames, turn-based chat keeps the default */
+void Application::UpdateFrameDuration() {
+    int frame_duration = aec_mode_ == kAecOff ? OPUS_FRAME_DURATION_MS : CONFIG_REALTIME_OPUS_FRAME_DURATION_MS;
+    protocol_->SetPreferredFrameDuration(frame_duration);
+    // The wake word pre-roll is encoded before the hello, so it already uses the proposed duration
+    audio_service_.SetFrameDuration(frame_duration);
+}
+
 void Application::SetDeviceState(DeviceState state) {
     if (device_state_ == state) {
         return;
@@ -871,7 +913,7 @@ void Application::WakeWordInvoke(const std::string& wake_word) {
 #if CONFIG_USE_AFE_WAKE_WORD || CONFIG_USE_CUSTOM_WAKE_WORD
         // Encode and send the wake word data to the server
         while (auto packet = audio_service_.PopWakeWordPacket()) {
-            protocol_->SendAudio(std::move(packet));
+            protocol_->SendAudio(*packet);
         }
         // Set the chat state to wake word detected
         protocol_->SendWakeWordDetected(wake_word);
@@ -946,6 +988,11 @@ void Application::SetAecMode(AecMode mode) {
             break;
         }
 
+        // The next session proposes the frame duration of the new mode
+        if (protocol_) {
+            UpdateFrameDuration();
+        }
+
         // If the AEC mode is changed, close the audio channel
         if (protocol_ && protocol_->IsAudioChannelOpened()) {
             protocol_->CloseAudioChannel();
@@ -1067,23 +1114,26 @@ bool Application::FetchWeatherData(WeatherInfo& info) {
         api_key = kDefaultWeatherApiKey;
     }
 
-    auto& board = Board::GetInstance();
-    auto http = board.GetNetwork()->CreateHttp(5);
-    http->SetHeader("Accept", "application/json");
-    http->SetHeader("User-Agent", "xiaozhi-weather/1.0");
-
     std::string url = "https://api.openweathermap.org/data/2.5/weather?q=" + UrlEncode(city) +
         "&appid=" + api_key + "&units=metric&lang=en";
 
+    auto http = HttpPool::GetInstance().Acquire(url);
+    if (!http) {
+        ESP_LOGE(TAG, "No free connection for the weather request");
+        return false;
+    }
+    http.SetHeader("Accept", "application/json");
+    http.SetHeader("User-Agent", "xiaozhi-weather/1.0");
+
     ESP_LOGI(TAG, "Fetching weather from %s", url.c_str());
-    if (!http->Open("GET", url)) {
+    if (!http.Open("GET", url)) {
         ESP_LOGE(TAG, "Failed to open weather URL");
         return false;
     }
 
-    int status_code = http->GetStatusCode();
-    std::string body = http->ReadAll();
-    http->Close();
+    int status_code = http.GetStatusCode();
+    std::string body = http.ReadAll();
+    http.Release();
 
     if (status_code != 200) {
         ESP_LOGE(TAG, "Weather request failed with status %d", status_code);
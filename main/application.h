@@ -10,10 +10,12 @@
 #include <mutex>
 #include <deque>
 #include <memory>
+#include <atomic>
 
 #include "protocol.h"
 #include "ota.h"
 #include "audio_service.h"
+#include "audio_send_scheduler.h"
 #include "audio/sd_audio_player.h"
 #include "device_state_event.h"
 
@@ -26,6 +28,15 @@
 #define MAIN_EVENT_CHECK_NEW_VERSION_DONE (1 << 5)
 #define MAIN_EVENT_CLOCK_TICK (1 << 6)
 
+#define MAX_PENDING_SEND_PACKETS 64
+#define MAX_SEND_BATCH_PACKETS 8
+#define MAX_SEND_RETRIES 3
+#if CONFIG_AUDIO_FRAME_AGGREGATION
+#define AUDIO_AGGREGATION_BUDGET_MS CONFIG_AUDIO_AGGREGATION_BUDGET_MS
+#else
+#define AUDIO_AGGREGATION_BUDGET_MS 0
+#endif
+
 
 enum AecMode {
     kAecOff,
@@ -67,6 +78,7 @@ public:
     AecMode GetAecMode() const { return aec_mode_; }
     void PlaySound(const std::string_view& sound);
     AudioService& GetAudioService() { return audio_service_; }
+    const AudioSendStatistics& GetAudioSendStatistics() const { return send_scheduler_.statistics(); }
     SdAudioPlayer& GetAudioPlayer() { return audio_player_; }
     void StopAudioPlayback();
 
@@ -84,11 +96,14 @@ private:
     AecMode aec_mode_ = kAecOff;
     std::string last_error_message_;
     AudioService audio_service_;
+    AudioSendScheduler send_scheduler_{audio_service_.GetLatencyTracker(), CONFIG_AUDIO_SEND_DEADLINE_MS,
+        MAX_PENDING_SEND_PACKETS, MAX_SEND_BATCH_PACKETS, MAX_SEND_RETRIES, AUDIO_AGGREGATION_BUDGET_MS};
     SdAudioPlayer audio_player_;
 
     bool has_server_time_ = false;
     bool aborted_ = false;
     int clock_ticks_ = 0;
+    std::atomic<uint32_t> wake_detected_us_{0};
 
     struct WeatherInfo {
         std::string city;
@@ -123,6 +138,7 @@ private:
     void CheckAssetsVersion();
     void ShowActivationCode(const std::string& code, const std::string& message);
     void SetListeningMode(ListeningMode mode);
+    void UpdateFrameDuration();
     void FetchWeatherTask();
     bool FetchWeatherData(WeatherInfo& info);
     std::string FormatWeatherSummary(const WeatherInfo& info) const;
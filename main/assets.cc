@@ -4,6 +4,7 @@
 #include "application.h"
 #include "lvgl_theme.h"
 #include "emote_display.h"
+#include "network_metrics.h"
 
 #include <esp_log.h>
 #include <spi_flash_mmap.h>
@@ -383,7 +384,7 @@ bool Assets::Download(std::string url, std::function<void(int progress, size_t s
     auto network = Board::GetInstance().GetNetwork();
     auto http = network->CreateHttp(0);
     
-    if (!http->Open("GET", url)) {
+    if (!NetworkMetrics::GetInstance().OpenHttp(*http, "GET", url)) {
         ESP_LOGE(TAG, "Failed to open HTTP connection");
         return false;
     }
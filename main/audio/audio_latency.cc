@@ -0,0 +1,91 @@
+#include "audio_latency.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <algorithm>
+
+#define TAG "AudioLatency"
+
+uint32_t AudioLatencyTracker::Now() {
+    return (uint32_t)esp_timer_get_time();
+}
+
+const char* AudioLatencyTracker::StageName(AudioLatencyStage stage) {
+    static const char* const names[kLatencyStageCount] = {
+        "capture", "encode_wait", "encode", "send_wait", "uplink",
+        "jitter", "decode", "playback_wait", "downlink", "wake_to_open",
+    };
+    return names[stage];
+}
+
+void AudioLatencyTracker::Record(AudioLatencyStage stage, uint32_t from_us, uint32_t to_us) {
+    if (from_us == 0 || to_us == 0) {
+        return;
+    }
+    histograms_[stage].Add(to_us - from_us);
+}
+
+void AudioLatencyTracker::TraceUplink(const AudioLatencyTrace& trace, uint32_t sent_us) {
+    if (trace.origin_us == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    Record(kLatencyStageCapture, trace.origin_us, trace.queued_us);
+    Record(kLatencyStageEncodeWait, trace.queued_us, trace.codec_start_us);
+    Record(kLatencyStageEncode, trace.codec_start_us, trace.codec_end_us);
+    Record(kLatencyStageSendWait, trace.codec_end_us, sent_us);
+    Record(kLatencyStageUplink, trace.origin_us, sent_us);
+}
+
+void AudioLatencyTracker::TraceDownlink(const AudioLatencyTrace& trace, uint32_t played_us) {
+    if (trace.origin_us == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    Record(kLatencyStageJitter, trace.origin_us, trace.queued_us);
+    Record(kLatencyStageDecode, trace.codec_start_us, trace.codec_end_us);
+    Record(kLatencyStagePlaybackWait, trace.codec_end_us, played_us);
+    Record(kLatencyStageDownlink, trace.origin_us, played_us);
+}
+
+void AudioLatencyTracker::TraceWakeToOpen(uint32_t wake_us, uint32_t opened_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Record(kLatencyStageWakeToOpen, wake_us, opened_us);
+}
+
+AudioLatencyStageStatistics AudioLatencyTracker::GetStatistics(AudioLatencyStage stage) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& histogram = histograms_[stage];
+    AudioLatencyStageStatistics stats;
+    stats.count = histogram.count();
+    stats.p50_us = histogram.Percentile(50);
+    stats.p95_us = histogram.Percentile(95);
+    stats.p99_us = histogram.Percentile(99);
+    stats.max_us = histogram.max();
+    return stats;
+}
+
+void AudioLatencyTracker::Reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& histogram : histograms_) {
+        histogram.Reset();
+    }
+    logged_count_ = 0;
+}
+
+void AudioLatencyTracker::Log() {
+    auto uplink = GetStatistics(kLatencyStageUplink);
+    auto encode = GetStatistics(kLatencyStageEncode);
+    auto downlink = GetStatistics(kLatencyStageDownlink);
+    auto jitter = GetStatistics(kLatencyStageJitter);
+    uint32_t count = uplink.count + downlink.count;
+    if (count == logged_count_) {
+        return;
+    }
+    logged_count_ = count;
+    ESP_LOGI(TAG, "uplink %lu/%lu/%lums (encode %lu/%lu/%lums), downlink %lu/%lu/%lums (jitter %lu/%lu/%lums) p50/p95/p99",
+        uplink.p50_us / 1000, uplink.p95_us / 1000, uplink.p99_us / 1000,
+        encode.p50_us / 1000, encode.p95_us / 1000, encode.p99_us / 1000,
+        downlink.p50_us / 1000, downlink.p95_us / 1000, downlink.p99_us / 1000,
+        jitter.p50_us / 1000, jitter.p95_us / 1000, jitter.p99_us / 1000);
+}
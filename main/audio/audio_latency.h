@@ -0,0 +1,66 @@
+#ifndef AUDIO_LATENCY_H
+#define AUDIO_LATENCY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#include "latency_histogram.h"
+
+/*
+ * Timestamps a frame collects on its way through the pipeline, in microseconds of
+ * esp_timer_get_time() truncated to 32 bits (differences stay valid across the wrap).
+ * An origin of 0 means the frame is not traced, e.g. local sounds and concealed frames.
+ */
+struct AudioLatencyTrace {
+    uint32_t origin_us = 0;         // Uplink: frame captured, downlink: packet received
+    uint32_t queued_us = 0;         // Uplink: queued for encoding, downlink: taken from the jitter buffer
+    uint32_t codec_start_us = 0;
+    uint32_t codec_end_us = 0;
+};
+
+enum AudioLatencyStage {
+    kLatencyStageCapture,           // Capture to encode queue, i.e. the audio processor
+    kLatencyStageEncodeWait,
+    kLatencyStageEncode,
+    kLatencyStageSendWait,          // Encoded to handed over to the protocol
+    kLatencyStageUplink,            // Capture to send
+    kLatencyStageJitter,            // Received to out of the decode queue and jitter buffer
+    kLatencyStageDecode,
+    kLatencyStagePlaybackWait,      // Decoded to written to I2S
+    kLatencyStageDownlink,          // Received to written to I2S
+    kLatencyStageWakeToOpen,        // Wake word detected to audio channel opened
+    kLatencyStageCount,
+};
+
+struct AudioLatencyStageStatistics {
+    uint32_t count = 0;
+    uint32_t p50_us = 0;
+    uint32_t p95_us = 0;
+    uint32_t p99_us = 0;
+    uint32_t max_us = 0;
+};
+
+/* Per-stage latency histograms, recorded from the audio tasks and read from anywhere */
+class AudioLatencyTracker {
+public:
+    static uint32_t Now();
+    static const char* StageName(AudioLatencyStage stage);
+
+    void TraceUplink(const AudioLatencyTrace& trace, uint32_t sent_us);
+    void TraceDownlink(const AudioLatencyTrace& trace, uint32_t played_us);
+    void TraceWakeToOpen(uint32_t wake_us, uint32_t opened_us);
+    AudioLatencyStageStatistics GetStatistics(AudioLatencyStage stage);
+    void Reset();
+    // Logs p50/p95/p99 of the end-to-end stages if anything was recorded since the last call
+    void Log();
+
+private:
+    std::mutex mutex_;
+    LatencyHistogram histograms_[kLatencyStageCount];
+    uint32_t logged_count_ = 0;
+
+    void Record(AudioLatencyStage stage, uint32_t from_us, uint32_t to_us);
+};
+
+#endif // AUDIO_LATENCY_H
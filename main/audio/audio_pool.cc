@@ -0,0 +1,163 @@
+#include "audio_pool.h"
+#include "audio_task.h"
+#include "protocol.h"
+
+#include <esp_log.h>
+#include <esp_heap_caps.h>
+#include <new>
+
+#define TAG "AudioPool"
+
+// About 2.4 seconds of 60ms packets in flight, plus the encode / playback tasks
+#define AUDIO_POOL_PACKET_SLOTS 48
+#define AUDIO_POOL_TASK_SLOTS 8
+// Opus packets stay well below 1KB, a 60ms 24kHz PCM frame is 2880 bytes
+#define AUDIO_POOL_PAYLOAD_BUFFERS 16
+#define AUDIO_POOL_PAYLOAD_MAX_BYTES 1536
+#define AUDIO_POOL_PCM_BUFFERS 4
+#define AUDIO_POOL_PCM_MAX_BYTES 6144
+
+#if CONFIG_SPIRAM
+#define AUDIO_POOL_CAPS (MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
+#else
+#define AUDIO_POOL_CAPS (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT)
+#endif
+
+AudioSlab::AudioSlab(const char* name, size_t object_size, size_t count, uint32_t caps)
+    : name_(name), count_(count), caps_(caps) {
+    const size_t align = alignof(std::max_align_t);
+    slot_size_ = (object_size + align - 1) & ~(align - 1);
+}
+
+AudioSlab::~AudioSlab() {
+    if (block_ != nullptr) {
+        heap_caps_free(block_);
+    }
+}
+
+void AudioSlab::InitializeBlock() {
+    block_ = (uint8_t*)heap_caps_aligned_alloc(alignof(std::max_align_t), slot_size_ * count_, caps_);
+    if (block_ == nullptr) {
+        ESP_LOGW(TAG, "Failed to allocate %s slab (%u bytes), using heap", name_, slot_size_ * count_);
+        block_failed_ = true;
+        return;
+    }
+    for (size_t i = count_; i > 0; i--) {
+        auto slot = reinterpret_cast<FreeSlot*>(block_ + (i - 1) * slot_size_);
+        slot->next = free_list_;
+        free_list_ = slot;
+    }
+}
+
+bool AudioSlab::Owns(const void* ptr) const {
+    auto p = static_cast<const uint8_t*>(ptr);
+    return block_ != nullptr && p >= block_ && p < block_ + slot_size_ * count_;
+}
+
+void* AudioSlab::Allocate(size_t size) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (block_ == nullptr && !block_failed_) {
+            InitializeBlock();
+        }
+        if (size <= slot_size_ && free_list_ != nullptr) {
+            auto slot = free_list_;
+            free_list_ = slot->next;
+            statistics_.hits++;
+            statistics_.in_use++;
+            if (statistics_.in_use > statistics_.high_water) {
+                statistics_.high_water = statistics_.in_use;
+            }
+            return slot;
+        }
+        statistics_.misses++;
+    }
+    return ::operator new(size);
+}
+
+void AudioSlab::Free(void* ptr) {
+    if (ptr == nullptr) {
+        return;
+    }
+    if (!Owns(ptr)) {
+        ::operator delete(ptr);
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto slot = static_cast<FreeSlot*>(ptr);
+    slot->next = free_list_;
+    free_list_ = slot;
+    statistics_.in_use--;
+}
+
+AudioPoolStatistics AudioSlab::GetStatistics() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return statistics_;
+}
+
+static AudioSlab& GetPacketSlab() {
+    static AudioSlab slab("packet", sizeof(AudioStreamPacket), AUDIO_POOL_PACKET_SLOTS, AUDIO_POOL_CAPS);
+    return slab;
+}
+
+static AudioSlab& GetTaskSlab() {
+    static AudioSlab slab("task", sizeof(AudioTask), AUDIO_POOL_TASK_SLOTS, AUDIO_POOL_CAPS);
+    return slab;
+}
+
+static AudioBufferStash<uint8_t>& GetPayloadStash() {
+    static AudioBufferStash<uint8_t> stash(AUDIO_POOL_PAYLOAD_BUFFERS, AUDIO_POOL_PAYLOAD_MAX_BYTES);
+    return stash;
+}
+
+static AudioBufferStash<int16_t>& GetPcmStash() {
+    static AudioBufferStash<int16_t> stash(AUDIO_POOL_PCM_BUFFERS, AUDIO_POOL_PCM_MAX_BYTES);
+    return stash;
+}
+
+void* AudioPool::AllocatePacket(size_t size) {
+    return GetPacketSlab().Allocate(size);
+}
+
+void AudioPool::FreePacket(void* ptr) {
+    GetPacketSlab().Free(ptr);
+}
+
+void* AudioPool::AllocateTask(size_t size) {
+    return GetTaskSlab().Allocate(size);
+}
+
+void AudioPool::FreeTask(void* ptr) {
+    GetTaskSlab().Free(ptr);
+}
+
+std::vector<uint8_t> AudioPool::TakePayload() {
+    return GetPayloadStash().Take();
+}
+
+void AudioPool::RecyclePayload(std::vector<uint8_t>&& payload) {
+    GetPayloadStash().Give(std::move(payload));
+}
+
+std::vector<int16_t> AudioPool::TakePcm() {
+    return GetPcmStash().Take();
+}
+
+void AudioPool::RecyclePcm(std::vector<int16_t>&& pcm) {
+    GetPcmStash().Give(std::move(pcm));
+}
+
+void AudioPool::PrintStatistics() {
+    auto print_slab = [](const char* name, const AudioPoolStatistics& stats) {
+        ESP_LOGI(TAG, "%s: hits %lu misses %lu in use %lu high water %lu", name,
+            stats.hits, stats.misses, stats.in_use, stats.high_water);
+    };
+    auto print_stash = [](const char* name, const AudioPoolStatistics& stats) {
+        ESP_LOGI(TAG, "%s: hits %lu misses %lu idle %lu high water %lu", name,
+            stats.hits, stats.misses, stats.idle, stats.high_water);
+    };
+    print_slab("packet", GetPacketSlab().GetStatistics());
+    print_slab("task", GetTaskSlab().GetStatistics());
+    print_stash("payload", GetPayloadStash().GetStatistics());
+    print_stash("pcm", GetPcmStash().GetStatistics());
+}
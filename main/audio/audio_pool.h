@@ -0,0 +1,123 @@
+#ifndef AUDIO_POOL_H
+#define AUDIO_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+struct AudioPoolStatistics {
+    uint32_t hits = 0;
+    uint32_t misses = 0;
+    uint32_t in_use = 0;        // Slab slots handed out
+    uint32_t idle = 0;          // Stashed buffers waiting to be taken again
+    uint32_t high_water = 0;    // Most slots in use, or most buffers idle
+};
+
+/*
+ * Fixed-size slab for the small objects that travel through the audio pipeline every frame.
+ * The block is allocated on first use with the given heap capabilities (PSRAM or internal RAM).
+ * When every slot is taken the allocation falls back to the regular heap and counts a miss.
+ */
+class AudioSlab {
+public:
+    AudioSlab(const char* name, size_t object_size, size_t count, uint32_t caps);
+    ~AudioSlab();
+
+    void* Allocate(size_t size);
+    void Free(void* ptr);
+    AudioPoolStatistics GetStatistics();
+    inline const char* name() const { return name_; }
+
+private:
+    struct FreeSlot {
+        FreeSlot* next;
+    };
+
+    const char* name_;
+    size_t slot_size_;
+    size_t count_;
+    uint32_t caps_;
+    uint8_t* block_ = nullptr;
+    bool block_failed_ = false;
+    FreeSlot* free_list_ = nullptr;
+    std::mutex mutex_;
+    AudioPoolStatistics statistics_;
+
+    void InitializeBlock();
+    bool Owns(const void* ptr) const;
+};
+
+/*
+ * Keeps the storage of released vectors so the next frame can reuse the capacity instead of
+ * growing a fresh buffer. Only buffers up to max_bytes are kept, at most max_buffers of them.
+ */
+template <typename T>
+class AudioBufferStash {
+public:
+    AudioBufferStash(size_t max_buffers, size_t max_bytes)
+        : max_buffers_(max_buffers), max_bytes_(max_bytes) {
+        buffers_.reserve(max_buffers_);
+    }
+
+    std::vector<T> Take() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (buffers_.empty()) {
+            statistics_.misses++;
+            return std::vector<T>();
+        }
+        statistics_.hits++;
+        auto buffer = std::move(buffers_.back());
+        buffers_.pop_back();
+        statistics_.idle = buffers_.size();
+        return buffer;
+    }
+
+    void Give(std::vector<T>&& buffer) {
+        if (buffer.capacity() == 0 || buffer.capacity() * sizeof(T) > max_bytes_) {
+            return;
+        }
+        buffer.clear();
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (buffers_.size() < max_buffers_) {
+            buffers_.push_back(std::move(buffer));
+            statistics_.idle = buffers_.size();
+            if (statistics_.idle > statistics_.high_water) {
+                statistics_.high_water = statistics_.idle;
+            }
+        }
+    }
+
+    AudioPoolStatistics GetStatistics() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return statistics_;
+    }
+
+private:
+    size_t max_buffers_;
+    size_t max_bytes_;
+    std::vector<std::vector<T>> buffers_;
+    std::mutex mutex_;
+    AudioPoolStatistics statistics_;
+};
+
+/*
+ * Process-wide pools backing AudioStreamPacket / AudioTask allocations and their payloads.
+ * The structs route operator new / delete here, so std::make_unique and std::unique_ptr keep working.
+ */
+class AudioPool {
+public:
+    static void* AllocatePacket(size_t size);
+    static void FreePacket(void* ptr);
+    static void* AllocateTask(size_t size);
+    static void FreeTask(void* ptr);
+
+    static std::vector<uint8_t> TakePayload();
+    static void RecyclePayload(std::vector<uint8_t>&& payload);
+    static std::vector<int16_t> TakePcm();
+    static void RecyclePcm(std::vector<int16_t>&& pcm);
+
+    static void PrintStatistics();
+};
+
+#endif // AUDIO_POOL_H
@@ -1,6 +1,8 @@
 #include "audio_service.h"
+#include "dsp/pcm_kernels.h"
 #include <esp_log.h>
 #include <cstring>
+#include <algorithm>
 
 #if CONFIG_USE_AUDIO_PROCESSOR
 #include "processors/afe_audio_processor.h"
@@ -17,7 +19,6 @@
 
 #define TAG "AudioService"
 
-
 AudioService::AudioService() {
     event_group_ = xEventGroupCreate();
 }
@@ -34,9 +35,14 @@ void AudioService::Initialize(AudioCodec* codec) {
     codec_->Start();
 
     /* Setup the audio codec */
-    opus_decoder_ = std::make_unique<OpusDecoderWrapper>(codec->output_sample_rate(), 1, OPUS_FRAME_DURATION_MS);
-    opus_encoder_ = std::make_unique<OpusEncoderWrapper>(16000, 1, OPUS_FRAME_DURATION_MS);
-    opus_encoder_->SetComplexity(0);
+    {
+        std::lock_guard<std::mutex> lock(decoder_cache_mutex_);
+        decoder_cache_.reserve(MAX_CACHED_OPUS_DECODERS);
+        auto entry = GetCachedDecoder(codec->output_sample_rate(), OPUS_FRAME_DURATION_MS);
+        opus_decoder_ = entry->decoder.get();
+        output_resampler_ = entry->resampler.get();
+    }
+    CreateEncoder(OPUS_FRAME_DURATION_MS);
 
     if (codec->input_sample_rate() != 16000) {
         input_resampler_.Configure(codec->input_sample_rate(), 16000);
@@ -50,7 +56,16 @@ void AudioService::Initialize(AudioCodec* codec) {
 #endif
 
     audio_processor_->OnOutput([this](std::vector<int16_t>&& data) {
-        PushTaskToEncodeQueue(kAudioTaskTypeEncodeToSendQueue, std::move(data));
+        if (!silence_suppression_ || !vad_running_) {
+            PushTaskToEncodeQueue(kAudioTaskTypeEncodeToSendQueue, std::move(data));
+            return;
+        }
+        // The VAD callback runs right before the frames of the same chunk, so voice_detected_ is current
+        std::lock_guard<std::mutex> lock(uplink_gate_mutex_);
+        uplink_gate_.Process(std::move(data), frame_duration_ms_, voice_detected_,
+            [this](std::vector<int16_t>&& pcm, uint32_t skipped_frames) {
+                PushTaskToEncodeQueue(kAudioTaskTypeEncodeToSendQueue, std::move(pcm), skipped_frames);
+            });
     });
 
     audio_processor_->OnVadStateChange([this](bool speaking) {
@@ -109,12 +124,36 @@ void AudioService::Start() {
     }, "audio_output", 2048, this, 4, &audio_output_task_handle_);
 #endif
 
+    /* Start the sound task, it demuxes queued sounds into the decode queue */
+    xTaskCreate([](void* arg) {
+        AudioService* audio_service = (AudioService*)arg;
+        audio_service->AudioSoundTask();
+        vTaskDelete(NULL);
+    }, "audio_sound", 2048 * 2, this, 2, &audio_sound_task_handle_);
+
+#if CONFIG_SPLIT_OPUS_CODEC_TASKS
+    /* Start the opus encoder and decoder tasks */
+    xTaskCreatePinnedToCore([](void* arg) {
+        AudioService* audio_service = (AudioService*)arg;
+        audio_service->OpusEncoderTask();
+        vTaskDelete(NULL);
+    }, "opus_encoder", 2048 * 13, this, 2, &opus_encoder_task_handle_,
+        CONFIG_OPUS_ENCODER_TASK_CORE < 0 ? tskNO_AFFINITY : CONFIG_OPUS_ENCODER_TASK_CORE);
+
+    xTaskCreatePinnedToCore([](void* arg) {
+        AudioService* audio_service = (AudioService*)arg;
+        audio_service->OpusDecoderTask();
+        vTaskDelete(NULL);
+    }, "opus_decoder", 2048 * 6, this, 2, &opus_decoder_task_handle_,
+        CONFIG_OPUS_DECODER_TASK_CORE < 0 ? tskNO_AFFINITY : CONFIG_OPUS_DECODER_TASK_CORE);
+#else
     /* Start the opus codec task */
     xTaskCreate([](void* arg) {
         AudioService* audio_service = (AudioService*)arg;
         audio_service->OpusCodecTask();
         vTaskDelete(NULL);
-    }, "opus_codec", 2048 * 13, this, 2, &opus_codec_task_handle_);
+    }, "opus_codec", 2048 * 13, this, 2, &opus_encoder_task_handle_);
+#endif
 }
 
 void AudioService::Stop() {
@@ -124,12 +163,54 @@ void AudioService::Stop() {
         AS_EVENT_WAKE_WORD_RUNNING |
         AS_EVENT_AUDIO_PROCESSOR_RUNNING);
 
-    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-    audio_encode_queue_.clear();
-    audio_decode_queue_.clear();
-    audio_playback_queue_.clear();
-    audio_testing_queue_.clear();
-    audio_queue_cv_.notify_all();
+    xEventGroupSetBits(event_group_, AS_EVENT_ENCODE_QUEUE_AVAILABLE | AS_EVENT_DECODE_QUEUE_AVAILABLE);
+
+    audio_encode_queue_.Clear();
+    audio_decode_queue_.Clear();
+    audio_playback_queue_.Clear();
+    audio_testing_queue_.Clear();
+    jitter_buffer_reset_ = true;
+    sound_generation_++;
+    NotifyTask(audio_sound_task_handle_);
+    NotifyTask(opus_encoder_task_handle_);
+    NotifyTask(opus_decoder_task_handle_);
+    NotifyTask(audio_output_task_handle_);
+}
+
+void AudioService::NotifyTask(TaskHandle_t task) {
+    if (task != nullptr) {
+        xTaskNotifyGive(task);
+    }
+}
+
+static void RecordCodecFrame(CodecStatistics& stats, uint32_t queue_depth, uint32_t elapsed_us) {
+    stats.count++;
+    stats.queue_depth = queue_depth;
+    stats.queue_max = std::max(stats.queue_max, queue_depth);
+    stats.time_us = elapsed_us;
+    stats.time_max_us = std::max(stats.time_max_us, elapsed_us);
+    stats.time_total_us += elapsed_us;
+}
+
+DebugStatistics AudioService::GetDebugStatistics() {
+    DebugStatistics stats;
+    stats.input_count = input_count_;
+    stats.playback_count = playback_count_;
+    {
+        std::lock_guard<std::mutex> lock(encode_statistics_mutex_);
+        stats.encode = encode_statistics_;
+        stats.uplink_bytes = uplink_bytes_;
+    }
+    {
+        std::lock_guard<std::mutex> lock(decode_statistics_mutex_);
+        stats.decode = decode_statistics_;
+    }
+    return stats;
+}
+
+uint64_t AudioService::GetUplinkBytes() {
+    std::lock_guard<std::mutex> lock(encode_statistics_mutex_);
+    return uplink_bytes_;
 }
 
 bool AudioService::ReadAudioData(std::vector<int16_t>& data, int sample_rate, int samples) {
@@ -140,30 +221,28 @@ bool AudioService::ReadAudioData(std::vector<int16_t>& data, int sample_rate, in
     }
 
     if (codec_->input_sample_rate() != sample_rate) {
-        data.resize(samples * codec_->input_sample_rate() / sample_rate * codec_->input_channels());
-        if (!codec_->InputData(data)) {
+        /* Capture into persistent scratch buffers, they only grow on the first frames */
+        int frames = samples * codec_->input_sample_rate() / sample_rate;
+        capture_buffer_.resize(frames * codec_->input_channels());
+        if (!codec_->InputData(capture_buffer_)) {
             return false;
         }
         if (codec_->input_channels() == 2) {
-            auto mic_channel = std::vector<int16_t>(data.size() / 2);
-            auto reference_channel = std::vector<int16_t>(data.size() / 2);
-            for (size_t i = 0, j = 0; i < mic_channel.size(); ++i, j += 2) {
-                mic_channel[i] = data[j];
-                reference_channel[i] = data[j + 1];
-            }
-            auto resampled_mic = std::vector<int16_t>(input_resampler_.GetOutputSamples(mic_channel.size()));
-            auto resampled_reference = std::vector<int16_t>(reference_resampler_.GetOutputSamples(reference_channel.size()));
-            input_resampler_.Process(mic_channel.data(), mic_channel.size(), resampled_mic.data());
-            reference_resampler_.Process(reference_channel.data(), reference_channel.size(), resampled_reference.data());
-            data.resize(resampled_mic.size() + resampled_reference.size());
-            for (size_t i = 0, j = 0; i < resampled_mic.size(); ++i, j += 2) {
-                data[j] = resampled_mic[i];
-                data[j + 1] = resampled_reference[i];
-            }
+            int output_frames = input_resampler_.GetOutputSamples(frames);
+            capture_planar_.resize(frames * 2);
+            capture_resampled_.resize(output_frames * 2);
+            int16_t* mic = capture_planar_.data();
+            int16_t* reference = mic + frames;
+            int16_t* resampled_mic = capture_resampled_.data();
+            int16_t* resampled_reference = resampled_mic + output_frames;
+            PcmDeinterleaveStereo(capture_buffer_.data(), mic, reference, frames);
+            input_resampler_.Process(mic, frames, resampled_mic);
+            reference_resampler_.Process(reference, frames, resampled_reference);
+            data.resize(output_frames * 2);
+            PcmInterleaveStereo(resampled_mic, resampled_reference, data.data(), output_frames);
         } else {
-            auto resampled = std::vector<int16_t>(input_resampler_.GetOutputSamples(data.size()));
-            input_resampler_.Process(data.data(), data.size(), resampled.data());
-            data = std::move(resampled);
+            data.resize(input_resampler_.GetOutputSamples(frames));
+            input_resampler_.Process(capture_buffer_.data(), frames, data.data());
         }
     } else {
         data.resize(samples * codec_->input_channels());
@@ -174,7 +253,8 @@ bool AudioService::ReadAudioData(std::vector<int16_t>& data, int sample_rate, in
 
     /* Update the last input time */
     last_input_time_ = std::chrono::steady_clock::now();
-    debug_statistics_.input_count++;
+    last_capture_us_ = AudioLatencyTracker::Now();
+    input_count_++;
 
 #if CONFIG_USE_AUDIO_DEBUGGER
     // 音频调试：发送原始音频数据
@@ -188,6 +268,8 @@ bool AudioService::ReadAudioData(std::vector<int16_t>& data, int sample_rate, in
 }
 
 void AudioService::AudioInputTask() {
+    /* Reused across iterations so the capture path does not allocate per frame */
+    std::vector<int16_t> data;
     while (true) {
         EventBits_t bits = xEventGroupWaitBits(event_group_, AS_EVENT_AUDIO_TESTING_RUNNING |
             AS_EVENT_WAKE_WORD_RUNNING | AS_EVENT_AUDIO_PROCESSOR_RUNNING,
@@ -204,30 +286,31 @@ void AudioService::AudioInputTask() {
 
         /* Used for audio testing in NetworkConfiguring mode by clicking the BOOT button */
         if (bits & AS_EVENT_AUDIO_TESTING_RUNNING) {
-            if (audio_testing_queue_.size() >= AUDIO_TESTING_MAX_DURATION_MS / OPUS_FRAME_DURATION_MS) {
+            if (audio_testing_queue_.Size() >= MAX_AUDIO_TESTING_PACKETS) {
                 ESP_LOGW(TAG, "Audio testing queue is full, stopping audio testing");
                 EnableAudioTesting(false);
                 continue;
             }
-            std::vector<int16_t> data;
             int samples = OPUS_FRAME_DURATION_MS * 16000 / 1000;
             if (ReadAudioData(data, 16000, samples)) {
+                // The encode task takes ownership of the frame, so it gets its own buffer
+                auto pcm = AudioPool::TakePcm();
                 // If input channels is 2, we need to fetch the left channel data
                 if (codec_->input_channels() == 2) {
-                    auto mono_data = std::vector<int16_t>(data.size() / 2);
-                    for (size_t i = 0, j = 0; i < mono_data.size(); ++i, j += 2) {
-                        mono_data[i] = data[j];
+                    pcm.resize(data.size() / 2);
+                    for (size_t i = 0, j = 0; i < pcm.size(); ++i, j += 2) {
+                        pcm[i] = data[j];
                     }
-                    data = std::move(mono_data);
+                } else {
+                    pcm.assign(data.begin(), data.end());
                 }
-                PushTaskToEncodeQueue(kAudioTaskTypeEncodeToTestingQueue, std::move(data));
+                PushTaskToEncodeQueue(kAudioTaskTypeEncodeToTestingQueue, std::move(pcm));
                 continue;
             }
         }
 
         /* Feed the wake word */
         if (bits & AS_EVENT_WAKE_WORD_RUNNING) {
-            std::vector<int16_t> data;
             int samples = wake_word_->GetFeedSize();
             if (samples > 0) {
                 if (ReadAudioData(data, 16000, samples)) {
@@ -239,7 +322,6 @@ void AudioService::AudioInputTask() {
 
         /* Feed the audio processor */
         if (bits & AS_EVENT_AUDIO_PROCESSOR_RUNNING) {
-            std::vector<int16_t> data;
             int samples = audio_processor_->GetFeedSize();
             if (samples > 0) {
                 if (ReadAudioData(data, 16000, samples)) {
@@ -257,17 +339,15 @@ void AudioService::AudioInputTask() {
 }
 
 void AudioService::AudioOutputTask() {
-    while (true) {
-        std::unique_lock<std::mutex> lock(audio_queue_mutex_);
-        audio_queue_cv_.wait(lock, [this]() { return !audio_playback_queue_.empty() || service_stopped_; });
-        if (service_stopped_) {
-            break;
+    while (!service_stopped_) {
+        std::unique_ptr<AudioTask> task;
+        if (!audio_playback_queue_.Pop(task)) {
+            // The queue may have been flushed, let the decoder know there is room again
+            NotifyTask(opus_decoder_task_handle_);
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
         }
-
-        auto task = std::move(audio_playback_queue_.front());
-        audio_playback_queue_.pop_front();
-        audio_queue_cv_.notify_all();
-        lock.unlock();
+        NotifyTask(opus_decoder_task_handle_);
 
         if (!codec_->output_enabled()) {
             esp_timer_stop(audio_power_timer_);
@@ -275,10 +355,11 @@ void AudioService::AudioOutputTask() {
             codec_->EnableOutput(true);
         }
         codec_->OutputData(task->pcm);
+        latency_tracker_.TraceDownlink(task->trace, AudioLatencyTracker::Now());
 
         /* Update the last output time */
         last_output_time_ = std::chrono::steady_clock::now();
-        debug_statistics_.playback_count++;
+        playback_count_++;
 
         if (callbacks_.on_playback_frame) {
             callbacks_.on_playback_frame(task->pcm);
@@ -287,92 +368,212 @@ void AudioService::AudioOutputTask() {
 #if CONFIG_USE_SERVER_AEC
         /* Record the timestamp for server AEC */
         if (task->timestamp > 0) {
-            lock.lock();
-            timestamp_queue_.push_back(task->timestamp);
+            timestamp_queue_.Push(task->timestamp);
         }
 #endif
     }
 
+    audio_output_task_handle_ = nullptr;
     ESP_LOGW(TAG, "Audio output task stopped");
 }
 
 void AudioService::OpusCodecTask() {
-    while (true) {
-        std::unique_lock<std::mutex> lock(audio_queue_mutex_);
-        audio_queue_cv_.wait(lock, [this]() {
-            return service_stopped_ ||
-                (!audio_encode_queue_.empty() && audio_send_queue_.size() < MAX_SEND_PACKETS_IN_QUEUE) ||
-                (!audio_decode_queue_.empty() && audio_playback_queue_.size() < MAX_PLAYBACK_TASKS_IN_QUEUE);
-        });
-        if (service_stopped_) {
-            break;
+    /* Both directions share this task, producers of either queue notify it */
+    opus_decoder_task_handle_ = opus_encoder_task_handle_;
+    while (!service_stopped_) {
+        bool decoded = DecodeNextPacket();
+        bool encoded = EncodeNextTask();
+        if (!decoded && !encoded) {
+            ulTaskNotifyTake(pdTRUE, GetDecoderWaitTicks());
         }
+    }
 
-        /* Decode the audio from decode queue */
-        if (!audio_decode_queue_.empty() && audio_playback_queue_.size() < MAX_PLAYBACK_TASKS_IN_QUEUE) {
-            auto packet = std::move(audio_decode_queue_.front());
-            audio_decode_queue_.pop_front();
-            audio_queue_cv_.notify_all();
-            lock.unlock();
-
-            auto task = std::make_unique<AudioTask>();
-            task->type = kAudioTaskTypeDecodeToPlaybackQueue;
-            task->timestamp = packet->timestamp;
-
-            SetDecodeSampleRate(packet->sample_rate, packet->frame_duration);
-            if (opus_decoder_->Decode(std::move(packet->payload), task->pcm)) {
-                // Resample if the sample rate is different
-                if (opus_decoder_->sample_rate() != codec_->output_sample_rate()) {
-                    int target_size = output_resampler_.GetOutputSamples(task->pcm.size());
-                    std::vector<int16_t> resampled(target_size);
-                    output_resampler_.Process(task->pcm.data(), task->pcm.size(), resampled.data());
-                    task->pcm = std::move(resampled);
-                }
+    opus_decoder_task_handle_ = nullptr;
+    opus_encoder_task_handle_ = nullptr;
+    ESP_LOGW(TAG, "Opus codec task stopped");
+}
 
-                lock.lock();
-                audio_playback_queue_.push_back(std::move(task));
-                audio_queue_cv_.notify_all();
-            } else {
-                ESP_LOGE(TAG, "Failed to decode audio");
-                lock.lock();
-            }
-            debug_statistics_.decode_count++;
+void AudioService::OpusEncoderTask() {
+    while (!service_stopped_) {
+        if (!EncodeNextTask()) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
         }
-        
-        /* Encode the audio to send queue */
-        if (!audio_encode_queue_.empty() && audio_send_queue_.size() < MAX_SEND_PACKETS_IN_QUEUE) {
-            auto task = std::move(audio_encode_queue_.front());
-            audio_encode_queue_.pop_front();
-            audio_queue_cv_.notify_all();
-            lock.unlock();
+    }
 
-            auto packet = std::make_unique<AudioStreamPacket>();
-            packet->frame_duration = OPUS_FRAME_DURATION_MS;
-            packet->sample_rate = 16000;
-            packet->timestamp = task->timestamp;
-            if (!opus_encoder_->Encode(std::move(task->pcm), packet->payload)) {
-                ESP_LOGE(TAG, "Failed to encode audio");
-                continue;
-            }
+    opus_encoder_task_handle_ = nullptr;
+    ESP_LOGW(TAG, "Opus encoder task stopped");
+}
 
-            if (task->type == kAudioTaskTypeEncodeToSendQueue) {
-                {
-                    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-                    audio_send_queue_.push_back(std::move(packet));
-                }
-                if (callbacks_.on_send_queue_available) {
-                    callbacks_.on_send_queue_available();
-                }
-            } else if (task->type == kAudioTaskTypeEncodeToTestingQueue) {
-                std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-                audio_testing_queue_.push_back(std::move(packet));
-            }
-            debug_statistics_.encode_count++;
-            lock.lock();
+void AudioService::OpusDecoderTask() {
+    while (!service_stopped_) {
+        if (!DecodeNextPacket()) {
+            ulTaskNotifyTake(pdTRUE, GetDecoderWaitTicks());
         }
     }
 
-    ESP_LOGW(TAG, "Opus codec task stopped");
+    opus_decoder_task_handle_ = nullptr;
+    ESP_LOGW(TAG, "Opus decoder task stopped");
+}
+
+/* Decode one frame from the jitter buffer, returns false if there was nothing to do */
+bool AudioService::DecodeNextPacket() {
+    if (jitter_buffer_reset_.exchange(false)) {
+        auto& stats = jitter_buffer_.statistics();
+        ESP_LOGI(TAG, "Jitter buffer: received %lu, late %lu, lost %lu, dropped %lu, concealed %lu, jitter %lums",
+            stats.received, stats.late, stats.lost, stats.dropped, stats.concealed, stats.jitter_ms);
+        jitter_buffer_.Reset();
+    }
+
+    /* Move the arrived packets into the jitter buffer right away, so their arrival time is accurate */
+    int64_t start_time = esp_timer_get_time();
+    std::unique_ptr<AudioStreamPacket> packet;
+    bool received = false;
+    while (!jitter_buffer_.Full() && audio_decode_queue_.Pop(packet)) {
+        jitter_buffer_.Put(std::move(packet), start_time);
+        received = true;
+    }
+    if (received) {
+        xEventGroupSetBits(event_group_, AS_EVENT_DECODE_QUEUE_AVAILABLE);
+    }
+
+    if (audio_playback_queue_.Full()) {
+        return false;
+    }
+    uint32_t depth = jitter_buffer_.Size() + audio_decode_queue_.Size();
+    auto result = jitter_buffer_.Get(packet, start_time);
+    if (result == kJitterBufferEmpty) {
+        return false;
+    }
+    if (result == kJitterBufferPacketLost) {
+        // An empty payload makes the Opus decoder conceal the missing frame
+        packet = std::make_unique<AudioStreamPacket>();
+        packet->sample_rate = opus_decoder_->sample_rate();
+        packet->frame_duration = opus_decoder_->duration_ms();
+    }
+
+    auto task = std::make_unique<AudioTask>();
+    task->type = kAudioTaskTypeDecodeToPlaybackQueue;
+    task->timestamp = packet->timestamp;
+    task->trace = packet->trace;
+    task->trace.queued_us = (uint32_t)start_time;
+    task->pcm = AudioPool::TakePcm();
+
+    SetDecodeSampleRate(packet->sample_rate, packet->frame_duration);
+    task->trace.codec_start_us = AudioLatencyTracker::Now();
+    if (opus_decoder_->Decode(std::move(packet->payload), task->pcm)) {
+        // Resample if the sample rate is different
+        if (output_resampler_ != nullptr) {
+            int target_size = output_resampler_->GetOutputSamples(task->pcm.size());
+            auto resampled = AudioPool::TakePcm();
+            resampled.resize(target_size);
+            output_resampler_->Process(task->pcm.data(), task->pcm.size(), resampled.data());
+            task->pcm.swap(resampled);
+            AudioPool::RecyclePcm(std::move(resampled));
+        }
+        task->trace.codec_end_us = AudioLatencyTracker::Now();
+
+        audio_playback_queue_.Push(std::move(task));
+        NotifyTask(audio_output_task_handle_);
+    } else {
+        ESP_LOGE(TAG, "Failed to decode audio");
+    }
+
+    uint32_t elapsed = esp_timer_get_time() - start_time;
+    {
+        std::lock_guard<std::mutex> lock(decode_statistics_mutex_);
+        RecordCodecFrame(decode_statistics_, depth, elapsed);
+    }
+    return true;
+}
+
+/* Encode one task from the encode queue, returns false if there was nothing to do */
+bool AudioService::EncodeNextTask() {
+    if (audio_send_queue_.Size() >= MAX_SEND_QUEUE_DURATION_MS / frame_duration_ms_) {
+        return false;
+    }
+    uint32_t depth = audio_encode_queue_.Size();
+    std::unique_ptr<AudioTask> task;
+    if (!audio_encode_queue_.Pop(task)) {
+        return false;
+    }
+    xEventGroupSetBits(event_group_, AS_EVENT_ENCODE_QUEUE_AVAILABLE);
+    int64_t start_time = esp_timer_get_time();
+
+    /* Frames are cut by whoever queued them, the encoder follows when the session changes the duration */
+    int frame_duration = task->pcm.size() * 1000 / 16000;
+    if (frame_duration != encoder_frame_duration_) {
+        ESP_LOGI(TAG, "Opus encoder frame duration: %d ms", frame_duration);
+        CreateEncoder(frame_duration);
+    }
+
+    auto packet = std::make_unique<AudioStreamPacket>();
+    packet->frame_duration = frame_duration;
+    packet->sample_rate = 16000;
+    packet->timestamp = task->timestamp;
+    packet->skipped_frames = task->skipped_frames;
+    packet->trace = task->trace;
+    packet->trace.codec_start_us = (uint32_t)start_time;
+    packet->payload = AudioPool::TakePayload();
+    // Frames for the server get room for the transport header, so it is framed without a copy
+    if (task->type == kAudioTaskTypeEncodeToSendQueue) {
+        packet->headroom = AUDIO_PACKET_HEADROOM;
+    }
+    if (!opus_encoder_->Encode(task->pcm, packet->payload, packet->headroom)) {
+        ESP_LOGE(TAG, "Failed to encode audio");
+        return true;
+    }
+    packet->trace.codec_end_us = AudioLatencyTracker::Now();
+
+    size_t uplink_bytes = 0;
+    if (task->type == kAudioTaskTypeEncodeToSendQueue) {
+        uplink_bytes = packet->opus_size();
+        audio_send_queue_.Push(std::move(packet));
+        if (callbacks_.on_send_queue_available) {
+            callbacks_.on_send_queue_available();
+        }
+    } else if (task->type == kAudioTaskTypeEncodeToTestingQueue) {
+        audio_testing_queue_.Push(std::move(packet));
+    }
+
+    uint32_t elapsed = esp_timer_get_time() - start_time;
+    {
+        std::lock_guard<std::mutex> lock(encode_statistics_mutex_);
+        RecordCodecFrame(encode_statistics_, depth, elapsed);
+        uplink_bytes_ += uplink_bytes;
+    }
+
+#if CONFIG_OPUS_ADAPTIVE_ENCODER
+    if (task->type == kAudioTaskTypeEncodeToSendQueue &&
+        encoder_controller_.OnFrameEncoded(frame_duration, elapsed, audio_send_queue_.Size())) {
+        opus_encoder_->SetBitrate(encoder_controller_.bitrate());
+        opus_encoder_->SetComplexity(encoder_controller_.complexity());
+    }
+#endif
+    return true;
+}
+
+/* Only called by the encoder task, the settings picked by the controller carry over */
+void AudioService::CreateEncoder(int frame_duration) {
+    opus_encoder_ = std::make_unique<UplinkEncoder>(16000, 1, frame_duration);
+#if CONFIG_OPUS_ADAPTIVE_ENCODER
+    opus_encoder_->SetBitrate(encoder_controller_.bitrate());
+    opus_encoder_->SetComplexity(encoder_controller_.complexity());
+#endif
+    encoder_frame_duration_ = frame_duration;
+}
+
+void AudioService::ReportSendResult(bool success) {
+#if CONFIG_OPUS_ADAPTIVE_ENCODER
+    encoder_controller_.OnSendResult(success);
+#endif
+}
+
+/* Keep polling while the jitter buffer holds packets back, otherwise sleep until notified */
+TickType_t AudioService::GetDecoderWaitTicks() {
+    if (jitter_buffer_.Empty() || audio_playback_queue_.Full()) {
+        return portMAX_DELAY;
+    }
+    return pdMS_TO_TICKS(JITTER_BUFFER_POLL_MS);
 }
 
 void AudioService::SetDecodeSampleRate(int sample_rate, int frame_duration) {
@@ -380,61 +581,155 @@ void AudioService::SetDecodeSampleRate(int sample_rate, int frame_duration) {
         return;
     }
 
-    opus_decoder_.reset();
-    opus_decoder_ = std::make_unique<OpusDecoderWrapper>(sample_rate, 1, frame_duration);
+    /* Switching to a cached decoder keeps its state and costs no allocation */
+    std::lock_guard<std::mutex> lock(decoder_cache_mutex_);
+    auto entry = GetCachedDecoder(sample_rate, frame_duration);
+    opus_decoder_ = entry->decoder.get();
+    output_resampler_ = entry->resampler.get();
+}
+
+void AudioService::SetFrameDuration(int frame_duration_ms) {
+    if (frame_duration_ms != 20 && frame_duration_ms != 40 && frame_duration_ms != 60) {
+        ESP_LOGW(TAG, "Unsupported frame duration %d ms, keeping %d ms", frame_duration_ms, frame_duration_ms_.load());
+        return;
+    }
+    if (frame_duration_ms == frame_duration_ms_) {
+        return;
+    }
+
+    ESP_LOGI(TAG, "Uplink frame duration: %d ms", frame_duration_ms);
+    frame_duration_ms_ = frame_duration_ms;
+    if (audio_processor_initialized_) {
+        audio_processor_->SetFrameDuration(frame_duration_ms);
+    }
+    if (wake_word_) {
+        wake_word_->SetFrameDuration(frame_duration_ms);
+    }
+}
+
+void AudioService::PrepareDecoder(int sample_rate, int frame_duration) {
+    std::lock_guard<std::mutex> lock(decoder_cache_mutex_);
+    GetCachedDecoder(sample_rate, frame_duration);
+}
+
+void AudioService::ResetJitterBuffer() {
+    jitter_buffer_reset_ = true;
+    NotifyTask(opus_decoder_task_handle_);
+}
+
+/* Find or create the decoder for a stream format, evicting the least recently used one. Caller holds decoder_cache_mutex_ */
+OpusDecoderCacheEntry* AudioService::GetCachedDecoder(int sample_rate, int frame_duration) {
+    decoder_cache_clock_++;
+    OpusDecoderCacheEntry* victim = nullptr;
+    for (auto& entry : decoder_cache_) {
+        if (entry.sample_rate == sample_rate && entry.frame_duration == frame_duration) {
+            entry.last_used = decoder_cache_clock_;
+            return &entry;
+        }
+        // Never evict the decoder in use
+        if (entry.decoder.get() != opus_decoder_ && (victim == nullptr || entry.last_used < victim->last_used)) {
+            victim = &entry;
+        }
+    }
+    if (decoder_cache_.size() < MAX_CACHED_OPUS_DECODERS) {
+        decoder_cache_.emplace_back();
+        victim = &decoder_cache_.back();
+    } else {
+        ESP_LOGI(TAG, "Evicting Opus decoder %d/%d", victim->sample_rate, victim->frame_duration);
+    }
 
-    auto codec = Board::GetInstance().GetAudioCodec();
-    if (opus_decoder_->sample_rate() != codec->output_sample_rate()) {
-        ESP_LOGI(TAG, "Resampling audio from %d to %d", opus_decoder_->sample_rate(), codec->output_sample_rate());
-        output_resampler_.Configure(opus_decoder_->sample_rate(), codec->output_sample_rate());
+    ESP_LOGI(TAG, "Creating Opus decoder %d/%d", sample_rate, frame_duration);
+    victim->sample_rate = sample_rate;
+    victim->frame_duration = frame_duration;
+    victim->last_used = decoder_cache_clock_;
+    victim->decoder.reset();
+    victim->decoder = std::make_unique<OpusDecoderWrapper>(sample_rate, 1, frame_duration);
+    victim->resampler.reset();
+    if (sample_rate != codec_->output_sample_rate()) {
+        ESP_LOGI(TAG, "Resampling audio from %d to %d", sample_rate, codec_->output_sample_rate());
+        victim->resampler = std::make_unique<OpusResampler>();
+        victim->resampler->Configure(sample_rate, codec_->output_sample_rate());
     }
+    return victim;
 }
 
-void AudioService::PushTaskToEncodeQueue(AudioTaskType type, std::vector<int16_t>&& pcm) {
+void AudioService::PushTaskToEncodeQueue(AudioTaskType type, std::vector<int16_t>&& pcm, uint32_t skipped_frames) {
     auto task = std::make_unique<AudioTask>();
     task->type = type;
     task->pcm = std::move(pcm);
+    task->skipped_frames = skipped_frames;
+    task->trace.origin_us = last_capture_us_;
+    task->trace.queued_us = AudioLatencyTracker::Now();
     
-    /* Push the task to the encode queue */
-    std::unique_lock<std::mutex> lock(audio_queue_mutex_);
-
     /* If the task is to send queue, we need to set the timestamp */
-    if (type == kAudioTaskTypeEncodeToSendQueue && !timestamp_queue_.empty()) {
-        if (timestamp_queue_.size() <= MAX_TIMESTAMPS_IN_QUEUE) {
-            task->timestamp = timestamp_queue_.front();
-        } else {
-            ESP_LOGW(TAG, "Timestamp queue (%u) is full, dropping timestamp", timestamp_queue_.size());
+    uint32_t timestamp;
+    if (type == kAudioTaskTypeEncodeToSendQueue) {
+        size_t pending = timestamp_queue_.Size();
+        if (timestamp_queue_.Pop(timestamp)) {
+            if (pending <= MAX_TIMESTAMPS_IN_QUEUE) {
+                task->timestamp = timestamp;
+            } else {
+                ESP_LOGW(TAG, "Timestamp queue (%u) is full, dropping timestamp", pending);
+            }
         }
-        timestamp_queue_.pop_front();
     }
 
-    audio_queue_cv_.wait(lock, [this]() { return audio_encode_queue_.size() < MAX_ENCODE_TASKS_IN_QUEUE; });
-    audio_encode_queue_.push_back(std::move(task));
-    audio_queue_cv_.notify_all();
+    /* Push the task to the encode queue, wait for the codec task if it falls behind */
+    while (!audio_encode_queue_.Push(std::move(task))) {
+        xEventGroupClearBits(event_group_, AS_EVENT_ENCODE_QUEUE_AVAILABLE);
+        if (service_stopped_) {
+            return;
+        }
+        if (!audio_encode_queue_.Full()) {
+            continue;
+        }
+        xEventGroupWaitBits(event_group_, AS_EVENT_ENCODE_QUEUE_AVAILABLE, pdFALSE, pdFALSE, portMAX_DELAY);
+    }
+    NotifyTask(opus_encoder_task_handle_);
 }
 
 bool AudioService::PushPacketToDecodeQueue(std::unique_ptr<AudioStreamPacket> packet, bool wait) {
-    std::unique_lock<std::mutex> lock(audio_queue_mutex_);
-    if (audio_decode_queue_.size() >= MAX_DECODE_PACKETS_IN_QUEUE) {
-        if (wait) {
-            audio_queue_cv_.wait(lock, [this]() { return audio_decode_queue_.size() < MAX_DECODE_PACKETS_IN_QUEUE; });
-        } else {
+    packet->trace.origin_us = AudioLatencyTracker::Now();
+    return PushDecodePacket(std::move(packet), wait, 0);
+}
+
+/* A non-zero sound generation drops the packet once the sound it belongs to was cancelled */
+bool AudioService::PushDecodePacket(std::unique_ptr<AudioStreamPacket> packet, bool wait, uint32_t sound_generation) {
+    size_t max_packets = MAX_DECODE_QUEUE_DURATION_MS /
+        std::max(packet->frame_duration > 0 ? packet->frame_duration : OPUS_FRAME_DURATION_MS, OPUS_MIN_FRAME_DURATION_MS);
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(decode_producer_mutex_);
+            if (sound_generation != 0 && sound_generation != sound_generation_) {
+                return false;
+            }
+            if (audio_decode_queue_.Size() < max_packets) {
+                if (!audio_decode_queue_.Push(std::move(packet))) {
+                    return false;
+                }
+                break;
+            }
+        }
+        if (!wait || service_stopped_) {
             return false;
         }
+        /* Wait outside the producer lock so the network can still drop packets meanwhile */
+        xEventGroupClearBits(event_group_, AS_EVENT_DECODE_QUEUE_AVAILABLE);
+        if (audio_decode_queue_.Size() < max_packets) {
+            continue;
+        }
+        xEventGroupWaitBits(event_group_, AS_EVENT_DECODE_QUEUE_AVAILABLE, pdFALSE, pdFALSE, portMAX_DELAY);
     }
-    audio_decode_queue_.push_back(std::move(packet));
-    audio_queue_cv_.notify_all();
+    NotifyTask(opus_decoder_task_handle_);
     return true;
 }
 
 std::unique_ptr<AudioStreamPacket> AudioService::PopPacketFromSendQueue() {
-    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-    if (audio_send_queue_.empty()) {
+    std::unique_ptr<AudioStreamPacket> packet;
+    if (!audio_send_queue_.Pop(packet)) {
         return nullptr;
     }
-    auto packet = std::move(audio_send_queue_.front());
-    audio_send_queue_.pop_front();
-    audio_queue_cv_.notify_all();
+    NotifyTask(opus_encoder_task_handle_);
     return packet;
 }
 
@@ -482,19 +777,54 @@ void AudioService::EnableVoiceProcessing(bool enable) {
     ESP_LOGD(TAG, "%s voice processing", enable ? "Enabling" : "Disabling");
     if (enable) {
         if (!audio_processor_initialized_) {
-            audio_processor_->Initialize(codec_, OPUS_FRAME_DURATION_MS, models_list_);
+            audio_processor_->Initialize(codec_, frame_duration_ms_, models_list_);
             audio_processor_initialized_ = true;
         }
 
         /* We should make sure no audio is playing */
         ResetDecoder();
+        {
+            std::lock_guard<std::mutex> lock(uplink_gate_mutex_);
+            uplink_gate_.Reset();
+        }
+        uplink_bytes_at_start_ = GetUplinkBytes();
         audio_input_need_warmup_ = true;
         audio_processor_->Start();
         xEventGroupSetBits(event_group_, AS_EVENT_AUDIO_PROCESSOR_RUNNING);
     } else {
         audio_processor_->Stop();
         xEventGroupClearBits(event_group_, AS_EVENT_AUDIO_PROCESSOR_RUNNING);
+        LogUplinkGateStatistics();
+    }
+}
+
+void AudioService::EnableSilenceSuppression(bool enable) {
+    ESP_LOGI(TAG, "%s uplink silence suppression", enable ? "Enabling" : "Disabling");
+    silence_suppression_ = enable;
+}
+
+UplinkGateStatistics AudioService::GetUplinkGateStatistics() {
+    std::lock_guard<std::mutex> lock(uplink_gate_mutex_);
+    return uplink_gate_.statistics();
+}
+
+void AudioService::LogUplinkGateStatistics() {
+    // Stop() does not wait for the processor task, its last frames may still pass through the gate
+    std::lock_guard<std::mutex> lock(uplink_gate_mutex_);
+    auto& stats = uplink_gate_.statistics();
+    if (!silence_suppression_ || stats.frames == 0) {
+        return;
     }
+    // Suppressed frames are counted at the average size of the frames that were sent
+    uint64_t uplink_bytes = GetUplinkBytes();
+    uint32_t bytes = uplink_bytes - uplink_bytes_at_start_;
+    uint32_t duration_ms = std::max<uint32_t>(stats.frames * frame_duration_ms_, 1);
+    uint32_t saved = stats.sent > 0 ? (uint64_t)bytes * stats.suppressed / stats.sent : 0;
+    ESP_LOGI(TAG, "Uplink: sent %lu of %lu frames (%lu keepalive), %lu bytes/min, ~%lu bytes/min saved",
+        stats.sent, stats.frames, stats.keepalive,
+        (uint32_t)((uint64_t)bytes * 60000 / duration_ms), (uint32_t)((uint64_t)saved * 60000 / duration_ms));
+    uplink_gate_.Reset();
+    uplink_bytes_at_start_ = uplink_bytes;
 }
 
 void AudioService::EnableAudioTesting(bool enable) {
@@ -503,21 +833,48 @@ void AudioService::EnableAudioTesting(bool enable) {
         xEventGroupSetBits(event_group_, AS_EVENT_AUDIO_TESTING_RUNNING);
     } else {
         xEventGroupClearBits(event_group_, AS_EVENT_AUDIO_TESTING_RUNNING);
-        /* Copy audio_testing_queue_ to audio_decode_queue_ */
-        std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-        audio_decode_queue_ = std::move(audio_testing_queue_);
-        audio_queue_cv_.notify_all();
+        /* Move audio_testing_queue_ to audio_decode_queue_ */
+        {
+            std::lock_guard<std::mutex> lock(decode_producer_mutex_);
+            audio_decode_queue_.Clear();
+        }
+        std::unique_ptr<AudioStreamPacket> packet;
+        while (audio_testing_queue_.Pop(packet)) {
+            // The recording is not network audio, keep it out of the downlink latency
+            packet->trace = AudioLatencyTrace();
+            while (true) {
+                {
+                    std::lock_guard<std::mutex> lock(decode_producer_mutex_);
+                    if (audio_decode_queue_.Push(std::move(packet))) {
+                        break;
+                    }
+                }
+                if (service_stopped_) {
+                    return;
+                }
+                /* The flushed packets hold their slots until the decoder drops them, it only signals when it receives */
+                NotifyTask(opus_decoder_task_handle_);
+                xEventGroupClearBits(event_group_, AS_EVENT_DECODE_QUEUE_AVAILABLE);
+                if (!audio_decode_queue_.Full()) {
+                    continue;
+                }
+                xEventGroupWaitBits(event_group_, AS_EVENT_DECODE_QUEUE_AVAILABLE, pdFALSE, pdFALSE,
+                    pdMS_TO_TICKS(JITTER_BUFFER_POLL_MS));
+            }
+        }
+        NotifyTask(opus_decoder_task_handle_);
     }
 }
 
 void AudioService::EnableDeviceAec(bool enable) {
     ESP_LOGI(TAG, "%s device AEC", enable ? "Enabling" : "Disabling");
     if (!audio_processor_initialized_) {
-        audio_processor_->Initialize(codec_, OPUS_FRAME_DURATION_MS, models_list_);
+        audio_processor_->Initialize(codec_, frame_duration_ms_, models_list_);
         audio_processor_initialized_ = true;
     }
 
     audio_processor_->EnableDeviceAec(enable);
+    vad_running_ = !enable;
 }
 
 void AudioService::SetCallbacks(AudioServiceCallbacks& callbacks) {
@@ -525,117 +882,165 @@ void AudioService::SetCallbacks(AudioServiceCallbacks& callbacks) {
 }
 
 void AudioService::PlaySound(const std::string_view& ogg) {
+    AudioSoundRequest request;
+    request.ogg = ogg;
+    request.index = FindSoundPacketIndex(ogg);
+    EnqueueSound(std::move(request));
+}
+
+void AudioService::PlaySound(std::vector<uint8_t>&& ogg) {
+    AudioSoundRequest request;
+    request.storage = std::move(ogg);
+    request.ogg = std::string_view(reinterpret_cast<const char*>(request.storage.data()), request.storage.size());
+    EnqueueSound(std::move(request));
+}
+
+void AudioService::PlaySound(std::unique_ptr<AudioSoundSource>&& source) {
+    AudioSoundRequest request;
+    request.source = std::move(source);
+    EnqueueSound(std::move(request));
+}
+
+void AudioService::SetSoundPacketIndex(const OggPacketIndex* index) {
+    sound_packet_index_ = index;
+}
+
+const OggPacketIndex* AudioService::FindSoundPacketIndex(const std::string_view& ogg) const {
+    if (sound_packet_index_ == nullptr) {
+        return nullptr;
+    }
+    for (auto index = sound_packet_index_; index->data != nullptr; index++) {
+        if (index->data == ogg.data()) {
+            return index;
+        }
+    }
+    return nullptr;
+}
+
+void AudioService::EnqueueSound(AudioSoundRequest&& request) {
     if (!codec_->output_enabled()) {
         esp_timer_stop(audio_power_timer_);
         esp_timer_start_periodic(audio_power_timer_, AUDIO_POWER_CHECK_INTERVAL_MS * 1000);
         codec_->EnableOutput(true);
     }
 
-    const uint8_t* buf = reinterpret_cast<const uint8_t*>(ogg.data());
-    size_t size = ogg.size();
-    size_t offset = 0;
+    {
+        std::lock_guard<std::mutex> lock(sound_mutex_);
+        request.generation = sound_generation_;
+        sound_queue_.push_back(std::move(request));
+    }
+    NotifyTask(audio_sound_task_handle_);
+}
 
-    auto find_page = [&](size_t start)->size_t {
-        for (size_t i = start; i + 4 <= size; ++i) {
-            if (buf[i] == 'O' && buf[i+1] == 'g' && buf[i+2] == 'g' && buf[i+3] == 'S') return i;
+void AudioService::AudioSoundTask() {
+    OggDemuxer demuxer;
+    while (!service_stopped_) {
+        AudioSoundRequest request;
+        bool has_request = false;
+        {
+            std::lock_guard<std::mutex> lock(sound_mutex_);
+            if (!sound_queue_.empty()) {
+                request = std::move(sound_queue_.front());
+                sound_queue_.pop_front();
+                has_request = true;
+            }
+            sound_playing_ = has_request;
+        }
+        if (!has_request) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+        if (request.generation != sound_generation_) {
+            continue;
         }
-        return static_cast<size_t>(-1);
-    };
-
-    bool seen_head = false;
-    bool seen_tags = false;
-    int sample_rate = 16000; // 默认值
 
-    while (true) {
-        size_t pos = find_page(offset);
-        if (pos == static_cast<size_t>(-1)) break;
-        offset = pos;
-        if (offset + 27 > size) break;
-
-        const uint8_t* page = buf + offset;
-        uint8_t page_segments = page[26];
-        size_t seg_table_off = offset + 27;
-        if (seg_table_off + page_segments > size) break;
-
-        size_t body_size = 0;
-        for (size_t i = 0; i < page_segments; ++i) body_size += page[27 + i];
-
-        size_t body_off = seg_table_off + page_segments;
-        if (body_off + body_size > size) break;
-
-        // Parse packets using lacing
-        size_t cur = body_off;
-        size_t seg_idx = 0;
-        while (seg_idx < page_segments) {
-            size_t pkt_len = 0;
-            size_t pkt_start = cur;
-            bool continued = false;
-            do {
-                uint8_t l = page[27 + seg_idx++];
-                pkt_len += l;
-                cur += l;
-                continued = (l == 255);
-            } while (continued && seg_idx < page_segments);
-
-            if (pkt_len == 0) continue;
-            const uint8_t* pkt_ptr = buf + pkt_start;
-
-            if (!seen_head) {
-                // 解析OpusHead包
-                if (pkt_len >= 19 && std::memcmp(pkt_ptr, "OpusHead", 8) == 0) {
-                    seen_head = true;
-                    
-                    // OpusHead结构：[0-7] "OpusHead", [8] version, [9] channel_count, [10-11] pre_skip
-                    // [12-15] input_sample_rate, [16-17] output_gain, [18] mapping_family
-                    if (pkt_len >= 12) {
-                        uint8_t version = pkt_ptr[8];
-                        uint8_t channel_count = pkt_ptr[9];
-                        
-                        if (pkt_len >= 16) {
-                            // 读取输入采样率 (little-endian)
-                            sample_rate = pkt_ptr[12] | (pkt_ptr[13] << 8) | 
-                                        (pkt_ptr[14] << 16) | (pkt_ptr[15] << 24);
-                            ESP_LOGI(TAG, "OpusHead: version=%d, channels=%d, sample_rate=%d", 
-                                   version, channel_count, sample_rate);
-                        }
-                    }
+        auto on_packet = [this, &demuxer, &request](const uint8_t* data, size_t size) {
+            auto packet = std::make_unique<AudioStreamPacket>();
+            packet->sample_rate = demuxer.sample_rate();
+            packet->frame_duration = 60;
+            packet->payload = AudioPool::TakePayload();
+            packet->payload.assign(data, data + size);
+            return PushDecodePacket(std::move(packet), true, request.generation);
+        };
+
+        if (request.index != nullptr) {
+            /* Built-in sounds are indexed at build time, the packets are taken straight from flash */
+            auto index = request.index;
+            auto base = reinterpret_cast<const uint8_t*>(index->data);
+            for (size_t i = 0; i < index->packet_count && request.generation == sound_generation_; i++) {
+                auto packet = std::make_unique<AudioStreamPacket>();
+                packet->sample_rate = index->sample_rate;
+                packet->frame_duration = 60;
+                packet->payload = AudioPool::TakePayload();
+                packet->payload.assign(base + index->packets[i].offset, base + index->packets[i].offset + index->packets[i].size);
+                if (!PushDecodePacket(std::move(packet), true, request.generation)) {
+                    break;
                 }
-                continue;
             }
-            if (!seen_tags) {
-                // Expect OpusTags in second packet
-                if (pkt_len >= 8 && std::memcmp(pkt_ptr, "OpusTags", 8) == 0) {
-                    seen_tags = true;
+            continue;
+        }
+
+        demuxer.Reset();
+        if (request.source) {
+            /* Streamed sounds are fed chunk by chunk, the decode queue paces the reads */
+            while (request.generation == sound_generation_) {
+                auto chunk = request.source->Read();
+                if (chunk.empty()) {
+                    break;
+                }
+                if (!demuxer.Feed(reinterpret_cast<const uint8_t*>(chunk.data()), chunk.size(), on_packet)) {
+                    break;
                 }
-                continue;
             }
-
-            // Audio packet (Opus)
-            auto packet = std::make_unique<AudioStreamPacket>();
-            packet->sample_rate = sample_rate;
-            packet->frame_duration = 60;
-            packet->payload.resize(pkt_len);
-            std::memcpy(packet->payload.data(), pkt_ptr, pkt_len);
-            PushPacketToDecodeQueue(std::move(packet), true);
+        } else {
+            /* The whole file is fed at once, so every packet is a view into it until it is copied into the payload */
+            demuxer.Feed(reinterpret_cast<const uint8_t*>(request.ogg.data()), request.ogg.size(), on_packet);
         }
-
-        offset = body_off + body_size;
     }
+
+    audio_sound_task_handle_ = nullptr;
+    ESP_LOGW(TAG, "Audio sound task stopped");
 }
 
 bool AudioService::IsIdle() {
-    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-    return audio_encode_queue_.empty() && audio_decode_queue_.empty() && audio_playback_queue_.empty() && audio_testing_queue_.empty();
+    {
+        std::lock_guard<std::mutex> lock(sound_mutex_);
+        if (sound_playing_ || !sound_queue_.empty()) {
+            return false;
+        }
+    }
+    return audio_encode_queue_.Empty() && audio_decode_queue_.Empty() && jitter_buffer_.Empty() &&
+        audio_playback_queue_.Empty() && audio_testing_queue_.Empty();
 }
 
 void AudioService::ResetDecoder() {
-    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-    opus_decoder_->ResetState();
-    timestamp_queue_.clear();
-    audio_decode_queue_.clear();
-    audio_playback_queue_.clear();
-    audio_testing_queue_.clear();
-    audio_queue_cv_.notify_all();
+    {
+        std::lock_guard<std::mutex> lock(decoder_cache_mutex_);
+        for (auto& entry : decoder_cache_) {
+            entry.decoder->ResetState();
+        }
+    }
+    timestamp_queue_.Clear();
+    std::deque<AudioSoundRequest> cancelled;
+    {
+        /*
+         * Cancel the sound being demuxed and the ones still waiting. PushDecodePacket() checks the
+         * generation under the producer lock, so no packet of a cancelled sound gets in after the flush.
+         */
+        std::lock_guard<std::mutex> lock(sound_mutex_);
+        std::lock_guard<std::mutex> producer_lock(decode_producer_mutex_);
+        sound_generation_++;
+        cancelled.swap(sound_queue_);
+        audio_decode_queue_.Clear();
+    }
+    // Streamed sounds wait for their reader task when destroyed, so they go after the locks are released
+    cancelled.clear();
+    audio_playback_queue_.Clear();
+    audio_testing_queue_.Clear();
+    jitter_buffer_reset_ = true;
+    xEventGroupSetBits(event_group_, AS_EVENT_DECODE_QUEUE_AVAILABLE);
+    NotifyTask(opus_decoder_task_handle_);
+    NotifyTask(audio_output_task_handle_);
 }
 
 void AudioService::CheckAndUpdateAudioPowerState() {
@@ -651,6 +1056,11 @@ void AudioService::CheckAndUpdateAudioPowerState() {
     if (!codec_->input_enabled() && !codec_->output_enabled()) {
         esp_timer_stop(audio_power_timer_);
     }
+
+    if (++latency_log_ticks_ >= AUDIO_LATENCY_LOG_INTERVAL_MS / AUDIO_POWER_CHECK_INTERVAL_MS) {
+        latency_log_ticks_ = 0;
+        latency_tracker_.Log();
+    }
 }
 
 void AudioService::SetModelsList(srmodel_list_t* models_list) {
@@ -673,6 +1083,7 @@ void AudioService::SetModelsList(srmodel_list_t* models_list) {
 #endif
 
     if (wake_word_) {
+        wake_word_->SetFrameDuration(frame_duration_ms_);
         wake_word_->OnWakeWordDetected([this](const std::string& wake_word) {
             if (callbacks_.on_wake_word_detected) {
                 callbacks_.on_wake_word_detected(wake_word);
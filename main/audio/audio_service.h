@@ -2,10 +2,11 @@
 #define AUDIO_SERVICE_H
 
 #include <memory>
-#include <deque>
-#include <condition_variable>
 #include <chrono>
 #include <mutex>
+#include <atomic>
+#include <deque>
+#include <string_view>
 
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
@@ -22,35 +23,70 @@
 #include "processors/audio_debugger.h"
 #include "wake_word.h"
 #include "protocol.h"
+#include "spsc_queue.h"
+#include "jitter_buffer.h"
+#include "ogg_demuxer.h"
+#include "ogg_packet_index.h"
+#include "audio_latency.h"
+#include "audio_task.h"
+#include "audio_sound_source.h"
+#include "uplink_gate.h"
+#include "uplink_encoder.h"
+#include "encoder_controller.h"
 
 
 /*
  * There are two types of audio data flow:
  * 1. (MIC) -> [Processors] -> {Encode Queue} -> [Opus Encoder] -> {Send Queue} -> (Server)
- * 2. (Server) -> {Decode Queue} -> [Opus Decoder] -> {Playback Queue} -> (Speaker)
+ * 2. (Server) -> {Decode Queue} -> [Jitter Buffer] -> [Opus Decoder] -> {Playback Queue} -> (Speaker)
  *
- * We use one task for MIC / Speaker / Processors, and one task for Opus Encoder / Opus Decoder.
+ * We use one task for MIC / Speaker / Processors, and one task each for Opus Encoder / Opus Decoder
+ * (CONFIG_SPLIT_OPUS_CODEC_TASKS). Single core chips run both directions in one Opus codec task.
  * 
  * Decode Queue and Send Queue are the main queues, because Opus packets are quite smaller than PCM packets.
- * 
+ *
+ * Every queue is a lock-free SPSC ring. Tasks owned by the service (Opus codecs, output) sleep on
+ * task notifications, external producers that must block wait on the *_QUEUE_AVAILABLE event bits.
  */
 
+// Default uplink frame, a session may negotiate a shorter one (20/40/60ms) in the hello exchange
 #define OPUS_FRAME_DURATION_MS 60
+#define OPUS_MIN_FRAME_DURATION_MS 20
 #define MAX_ENCODE_TASKS_IN_QUEUE 2
 #define MAX_PLAYBACK_TASKS_IN_QUEUE 2
-#define MAX_DECODE_PACKETS_IN_QUEUE (2400 / OPUS_FRAME_DURATION_MS)
-#define MAX_SEND_PACKETS_IN_QUEUE (2400 / OPUS_FRAME_DURATION_MS)
+// The decode and send queues hold this much audio, whatever the frame duration
+#define MAX_DECODE_QUEUE_DURATION_MS 2400
+#define MAX_SEND_QUEUE_DURATION_MS 2400
+#define MAX_SEND_PACKETS_IN_QUEUE (MAX_SEND_QUEUE_DURATION_MS / OPUS_MIN_FRAME_DURATION_MS)
 #define AUDIO_TESTING_MAX_DURATION_MS 10000
+#define MAX_AUDIO_TESTING_PACKETS (AUDIO_TESTING_MAX_DURATION_MS / OPUS_FRAME_DURATION_MS)
 #define MAX_TIMESTAMPS_IN_QUEUE 3
+// What Opus picks on its own for the default uplink frame, the adaptive encoder starts from there
+#define OPUS_AUTO_BITRATE (16000 + 60 * 1000 / OPUS_FRAME_DURATION_MS)
+#define JITTER_BUFFER_CAPACITY 16
+#define JITTER_BUFFER_MAX_DELAY_MS 360
+// How often the decoder looks again while the jitter buffer holds packets back
+#define JITTER_BUFFER_POLL_MS 10
+// Decoders kept around for the stream formats seen recently (e.g. 16kHz sounds and 24kHz TTS)
+#if CONFIG_SPIRAM
+#define MAX_CACHED_OPUS_DECODERS 3
+#else
+#define MAX_CACHED_OPUS_DECODERS 2
+#endif
 
 #define AUDIO_POWER_TIMEOUT_MS 15000
 #define AUDIO_POWER_CHECK_INTERVAL_MS 1000
+#define AUDIO_LATENCY_LOG_INTERVAL_MS 30000
+// Silent frames held back before they are dropped, sent ahead of the speech the VAD detects late
+#define UPLINK_SILENCE_LOOKBACK_MS 300
 
 
 #define AS_EVENT_AUDIO_TESTING_RUNNING      (1 << 0)
 #define AS_EVENT_WAKE_WORD_RUNNING          (1 << 1)
 #define AS_EVENT_AUDIO_PROCESSOR_RUNNING    (1 << 2)
 #define AS_EVENT_PLAYBACK_NOT_EMPTY         (1 << 3)
+#define AS_EVENT_ENCODE_QUEUE_AVAILABLE     (1 << 4)
+#define AS_EVENT_DECODE_QUEUE_AVAILABLE     (1 << 5)
 
 struct AudioServiceCallbacks {
     std::function<void(void)> on_send_queue_available;
@@ -61,23 +97,38 @@ struct AudioServiceCallbacks {
 };
 
 
-enum AudioTaskType {
-    kAudioTaskTypeEncodeToSendQueue,
-    kAudioTaskTypeEncodeToTestingQueue,
-    kAudioTaskTypeDecodeToPlaybackQueue,
+struct AudioSoundRequest {
+    std::string_view ogg;           // Points into storage, or into flash for the built-in sounds
+    std::vector<uint8_t> storage;
+    std::unique_ptr<AudioSoundSource> source;   // Used instead of ogg when set
+    const OggPacketIndex* index = nullptr;      // Precompiled packet table of a built-in sound
+    uint32_t generation;
 };
 
-struct AudioTask {
-    AudioTaskType type;
-    std::vector<int16_t> pcm;
-    uint32_t timestamp;
+struct OpusDecoderCacheEntry {
+    int sample_rate = 0;
+    int frame_duration = 0;
+    std::unique_ptr<OpusDecoderWrapper> decoder;
+    std::unique_ptr<OpusResampler> resampler;   // Only set if the codec plays at another rate
+    uint32_t last_used = 0;
+};
+
+// Load of one codec direction, the queue depth is sampled each time a frame is taken
+struct CodecStatistics {
+    uint32_t count = 0;
+    uint32_t queue_depth = 0;
+    uint32_t queue_max = 0;
+    uint32_t time_us = 0;
+    uint32_t time_max_us = 0;
+    uint64_t time_total_us = 0;
 };
 
 struct DebugStatistics {
     uint32_t input_count = 0;
-    uint32_t decode_count = 0;
-    uint32_t encode_count = 0;
     uint32_t playback_count = 0;
+    CodecStatistics encode;
+    CodecStatistics decode;
+    uint64_t uplink_bytes = 0;
 };
 
 class AudioService {
@@ -101,15 +152,38 @@ public:
     void EnableVoiceProcessing(bool enable);
     void EnableAudioTesting(bool enable);
     void EnableDeviceAec(bool enable);
+    // Stop sending audio while the VAD reports silence, only effective while the VAD is running
+    void EnableSilenceSuppression(bool enable);
 
     void SetCallbacks(AudioServiceCallbacks& callbacks);
 
     bool PushPacketToDecodeQueue(std::unique_ptr<AudioStreamPacket> packet, bool wait = false);
     std::unique_ptr<AudioStreamPacket> PopPacketFromSendQueue();
+    // Queue an Ogg/Opus sound and return at once, the data must stay valid until it is played
     void PlaySound(const std::string_view& sound);
+    void PlaySound(std::vector<uint8_t>&& ogg);
+    void PlaySound(std::unique_ptr<AudioSoundSource>&& source);
+    // Built-in sounds found in this table (terminated by a null entry) are played without demuxing
+    void SetSoundPacketIndex(const OggPacketIndex* index);
     bool ReadAudioData(std::vector<int16_t>& data, int sample_rate, int samples);
     void ResetDecoder();
+    // Create the decoder for a stream format ahead of time, e.g. when the server announces it
+    void PrepareDecoder(int sample_rate, int frame_duration);
+    // A new session numbers its packets afresh, the jitter buffer takes the next one as its start
+    void ResetJitterBuffer();
+    // Uplink frame duration of the session, applied to the processor and wake word pre-roll
+    void SetFrameDuration(int frame_duration_ms);
+    int GetFrameDuration() const { return frame_duration_ms_; }
     void SetModelsList(srmodel_list_t* models_list);
+    DebugStatistics GetDebugStatistics();
+    JitterBufferStatistics GetJitterBufferStatistics() const { return jitter_buffer_.statistics(); }
+    UplinkGateStatistics GetUplinkGateStatistics();
+#if CONFIG_OPUS_ADAPTIVE_ENCODER
+    EncoderControllerStatistics GetEncoderControllerStatistics() const { return encoder_controller_.statistics(); }
+#endif
+    // Feeds the encoder controller, call it once per flush of the send queue to the protocol
+    void ReportSendResult(bool success);
+    AudioLatencyTracker& GetLatencyTracker() { return latency_tracker_; }
 
 private:
     AudioCodec* codec_ = nullptr;
@@ -117,12 +191,52 @@ private:
     std::unique_ptr<AudioProcessor> audio_processor_;
     std::unique_ptr<WakeWord> wake_word_;
     std::unique_ptr<AudioDebugger> audio_debugger_;
-    std::unique_ptr<OpusEncoderWrapper> opus_encoder_;
-    std::unique_ptr<OpusDecoderWrapper> opus_decoder_;
+    std::unique_ptr<UplinkEncoder> opus_encoder_;
+    int encoder_frame_duration_ = 0;    // Only touched by the encoder task
+#if CONFIG_OPUS_ADAPTIVE_ENCODER
+    EncoderController encoder_controller_{CONFIG_OPUS_MIN_BITRATE, CONFIG_OPUS_MAX_BITRATE, OPUS_AUTO_BITRATE, 0, CONFIG_OPUS_MAX_COMPLEXITY};
+#endif
+    std::atomic<int> frame_duration_ms_{OPUS_FRAME_DURATION_MS};
     OpusResampler input_resampler_;
     OpusResampler reference_resampler_;
-    OpusResampler output_resampler_;
-    DebugStatistics debug_statistics_;
+    // The active decoder and resampler point into the cache, only the decoder task switches them
+    std::mutex decoder_cache_mutex_;
+    std::vector<OpusDecoderCacheEntry> decoder_cache_;
+    uint32_t decoder_cache_clock_ = 0;
+    OpusDecoderWrapper* opus_decoder_ = nullptr;
+    OpusResampler* output_resampler_ = nullptr;
+    // Capture scratch buffers, only touched by the task reading the microphone
+    std::vector<int16_t> capture_buffer_;
+    std::vector<int16_t> capture_planar_;
+    std::vector<int16_t> capture_resampled_;
+    // Every task counts into its own fields, GetDebugStatistics() puts the snapshot together
+    std::atomic<uint32_t> input_count_{0};
+    std::atomic<uint32_t> playback_count_{0};
+    std::mutex encode_statistics_mutex_;
+    CodecStatistics encode_statistics_;
+    uint64_t uplink_bytes_ = 0;     // Guarded by encode_statistics_mutex_
+    std::mutex decode_statistics_mutex_;
+    CodecStatistics decode_statistics_;
+    AudioLatencyTracker latency_tracker_;
+    // Time of the latest microphone read, the origin of the frames queued for encoding
+    std::atomic<uint32_t> last_capture_us_{0};
+    int latency_log_ticks_ = 0;
+    // The gate runs on the audio processor task, Reset() and the statistics are called from others
+    std::mutex uplink_gate_mutex_;
+#if CONFIG_UPLINK_SILENCE_SUPPRESSION
+    UplinkGate uplink_gate_{CONFIG_UPLINK_SILENCE_HANGOVER_MS, CONFIG_UPLINK_SILENCE_KEEPALIVE_MS, UPLINK_SILENCE_LOOKBACK_MS};
+    std::atomic<bool> silence_suppression_{true};
+#else
+    UplinkGate uplink_gate_{0, 0, 0};
+    std::atomic<bool> silence_suppression_{false};
+#endif
+    // Device AEC replaces the VAD, the gate is bypassed without it
+#if CONFIG_USE_DEVICE_AEC
+    std::atomic<bool> vad_running_{false};
+#else
+    std::atomic<bool> vad_running_{true};
+#endif
+    uint64_t uplink_bytes_at_start_ = 0;
     srmodel_list_t* models_list_ = nullptr;
 
     EventGroupHandle_t event_group_;
@@ -130,16 +244,30 @@ private:
     // Audio encode / decode
     TaskHandle_t audio_input_task_handle_ = nullptr;
     TaskHandle_t audio_output_task_handle_ = nullptr;
-    TaskHandle_t opus_codec_task_handle_ = nullptr;
-    std::mutex audio_queue_mutex_;
-    std::condition_variable audio_queue_cv_;
-    std::deque<std::unique_ptr<AudioStreamPacket>> audio_decode_queue_;
-    std::deque<std::unique_ptr<AudioStreamPacket>> audio_send_queue_;
-    std::deque<std::unique_ptr<AudioStreamPacket>> audio_testing_queue_;
-    std::deque<std::unique_ptr<AudioTask>> audio_encode_queue_;
-    std::deque<std::unique_ptr<AudioTask>> audio_playback_queue_;
+    TaskHandle_t audio_sound_task_handle_ = nullptr;
+    // Both point to the same task when the codec directions share one task
+    TaskHandle_t opus_encoder_task_handle_ = nullptr;
+    TaskHandle_t opus_decoder_task_handle_ = nullptr;
+    // The decode queue has several producers (network, sounds, audio testing), they take turns here
+    std::mutex decode_producer_mutex_;
+    // The decode queue is sized to hold a whole audio testing recording, MAX_DECODE_QUEUE_DURATION_MS is the normal limit.
+    // The send queue has room for the shortest frames, longer ones are limited to MAX_SEND_QUEUE_DURATION_MS as well.
+    SpscQueue<std::unique_ptr<AudioStreamPacket>> audio_decode_queue_{MAX_AUDIO_TESTING_PACKETS};
+    SpscQueue<std::unique_ptr<AudioStreamPacket>> audio_send_queue_{MAX_SEND_PACKETS_IN_QUEUE};
+    SpscQueue<std::unique_ptr<AudioStreamPacket>> audio_testing_queue_{MAX_AUDIO_TESTING_PACKETS};
+    SpscQueue<std::unique_ptr<AudioTask>> audio_encode_queue_{MAX_ENCODE_TASKS_IN_QUEUE};
+    SpscQueue<std::unique_ptr<AudioTask>> audio_playback_queue_{MAX_PLAYBACK_TASKS_IN_QUEUE};
+    // Owned by the decoder, other threads only request a reset
+    JitterBuffer jitter_buffer_{JITTER_BUFFER_CAPACITY, JITTER_BUFFER_MAX_DELAY_MS};
+    std::atomic<bool> jitter_buffer_reset_{false};
+    // Sounds waiting to be demuxed into the decode queue, ResetDecoder() bumps the generation to cancel them
+    std::mutex sound_mutex_;
+    std::deque<AudioSoundRequest> sound_queue_;
+    bool sound_playing_ = false;
+    std::atomic<uint32_t> sound_generation_{1};
+    const OggPacketIndex* sound_packet_index_ = nullptr;
     // For server AEC
-    std::deque<uint32_t> timestamp_queue_;
+    SpscQueue<uint32_t> timestamp_queue_{MAX_TIMESTAMPS_IN_QUEUE * 2};
 
     bool wake_word_initialized_ = false;
     bool audio_processor_initialized_ = false;
@@ -154,9 +282,23 @@ private:
     void AudioInputTask();
     void AudioOutputTask();
     void OpusCodecTask();
-    void PushTaskToEncodeQueue(AudioTaskType type, std::vector<int16_t>&& pcm);
+    void AudioSoundTask();
+    void EnqueueSound(AudioSoundRequest&& request);
+    const OggPacketIndex* FindSoundPacketIndex(const std::string_view& ogg) const;
+    bool PushDecodePacket(std::unique_ptr<AudioStreamPacket> packet, bool wait, uint32_t sound_generation);
+    void OpusEncoderTask();
+    void OpusDecoderTask();
+    bool DecodeNextPacket();
+    TickType_t GetDecoderWaitTicks();
+    bool EncodeNextTask();
+    void PushTaskToEncodeQueue(AudioTaskType type, std::vector<int16_t>&& pcm, uint32_t skipped_frames = 0);
+    void LogUplinkGateStatistics();
+    uint64_t GetUplinkBytes();
     void SetDecodeSampleRate(int sample_rate, int frame_duration);
+    void CreateEncoder(int frame_duration);
+    OpusDecoderCacheEntry* GetCachedDecoder(int sample_rate, int frame_duration);
     void CheckAndUpdateAudioPowerState();
+    void NotifyTask(TaskHandle_t task);
 };
 
 #endif
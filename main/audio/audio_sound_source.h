@@ -0,0 +1,14 @@
+#ifndef AUDIO_SOUND_SOURCE_H
+#define AUDIO_SOUND_SOURCE_H
+
+#include <string_view>
+
+// A sound streamed in chunks, e.g. a file on the SD card
+class AudioSoundSource {
+public:
+    virtual ~AudioSoundSource() = default;
+    // Returns the next chunk of the Ogg stream, valid until the next call, empty at the end of the stream
+    virtual std::string_view Read() = 0;
+};
+
+#endif // AUDIO_SOUND_SOURCE_H
@@ -0,0 +1,28 @@
+#ifndef AUDIO_TASK_H
+#define AUDIO_TASK_H
+
+#include <cstdint>
+#include <vector>
+
+#include "audio_pool.h"
+#include "audio_latency.h"
+
+enum AudioTaskType {
+    kAudioTaskTypeEncodeToSendQueue,
+    kAudioTaskTypeEncodeToTestingQueue,
+    kAudioTaskTypeDecodeToPlaybackQueue,
+};
+
+struct AudioTask {
+    AudioTaskType type;
+    std::vector<int16_t> pcm;
+    uint32_t timestamp;
+    uint32_t skipped_frames = 0;
+    AudioLatencyTrace trace;
+
+    ~AudioTask() { AudioPool::RecyclePcm(std::move(pcm)); }
+    static void* operator new(size_t size) { return AudioPool::AllocateTask(size); }
+    static void operator delete(void* ptr) { AudioPool::FreeTask(ptr); }
+};
+
+#endif // AUDIO_TASK_H
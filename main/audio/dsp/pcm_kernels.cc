@@ -0,0 +1,95 @@
+#include "pcm_kernels.h"
+
+#include <cstring>
+#include <algorithm>
+
+static inline int16_t SaturateSymmetric16(int32_t value) {
+    return (int16_t)std::min<int32_t>(std::max<int32_t>(value, -INT16_MAX), INT16_MAX);
+}
+
+void PcmToI2s32(const int16_t* input, int32_t* output, size_t samples, int32_t gain_q16) {
+    for (size_t i = 0; i < samples; i++) {
+        output[i] = (int32_t)input[i] * gain_q16;
+    }
+}
+
+void I2s32ToPcm(const int32_t* input, int16_t* output, size_t samples, int shift) {
+    size_t i = 0;
+    for (; i + 4 <= samples; i += 4) {
+        output[i] = SaturateSymmetric16(input[i] >> shift);
+        output[i + 1] = SaturateSymmetric16(input[i + 1] >> shift);
+        output[i + 2] = SaturateSymmetric16(input[i + 2] >> shift);
+        output[i + 3] = SaturateSymmetric16(input[i + 3] >> shift);
+    }
+    for (; i < samples; i++) {
+        output[i] = SaturateSymmetric16(input[i] >> shift);
+    }
+}
+
+void PcmApplyGainQ16(int16_t* data, size_t samples, int32_t gain_q16) {
+    if ((gain_q16 & 0xFFFF) == 0) {
+        // Whole gains (at most 32767) keep the product of any sample within 32 bits
+        int32_t gain = gain_q16 >> 16;
+        for (size_t i = 0; i < samples; i++) {
+            data[i] = SaturateSymmetric16((int32_t)data[i] * gain);
+        }
+        return;
+    }
+    for (size_t i = 0; i < samples; i++) {
+        data[i] = SaturateSymmetric16((int32_t)(((int64_t)data[i] * gain_q16) >> 16));
+    }
+}
+
+/* Split interleaved L/R frames, each frame is loaded as one 32-bit word */
+void PcmDeinterleaveStereo(const int16_t* input, int16_t* left, int16_t* right, size_t frames) {
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        uint32_t f[4];
+        memcpy(f, input + i * 2, sizeof(f));
+        left[i] = (int16_t)f[0];
+        left[i + 1] = (int16_t)f[1];
+        left[i + 2] = (int16_t)f[2];
+        left[i + 3] = (int16_t)f[3];
+        right[i] = (int16_t)(f[0] >> 16);
+        right[i + 1] = (int16_t)(f[1] >> 16);
+        right[i + 2] = (int16_t)(f[2] >> 16);
+        right[i + 3] = (int16_t)(f[3] >> 16);
+    }
+    for (; i < frames; i++) {
+        left[i] = input[i * 2];
+        right[i] = input[i * 2 + 1];
+    }
+}
+
+/* Merge L/R planes back into interleaved frames, each frame is stored as one 32-bit word */
+void PcmInterleaveStereo(const int16_t* left, const int16_t* right, int16_t* output, size_t frames) {
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        uint32_t f[4];
+        f[0] = (uint16_t)left[i] | ((uint32_t)(uint16_t)right[i] << 16);
+        f[1] = (uint16_t)left[i + 1] | ((uint32_t)(uint16_t)right[i + 1] << 16);
+        f[2] = (uint16_t)left[i + 2] | ((uint32_t)(uint16_t)right[i + 2] << 16);
+        f[3] = (uint16_t)left[i + 3] | ((uint32_t)(uint16_t)right[i + 3] << 16);
+        memcpy(output + i * 2, f, sizeof(f));
+    }
+    for (; i < frames; i++) {
+        output[i * 2] = left[i];
+        output[i * 2 + 1] = right[i];
+    }
+}
+
+void PcmExtractChannel(const int16_t* input, int16_t* output, size_t frames, int channels, int channel) {
+    input += channel;
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        output[i] = input[0];
+        output[i + 1] = input[channels];
+        output[i + 2] = input[channels * 2];
+        output[i + 3] = input[channels * 3];
+        input += channels * 4;
+    }
+    for (; i < frames; i++) {
+        output[i] = *input;
+        input += channels;
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef PCM_KERNELS_H
+#define PCM_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Sample conversion kernels shared by the codecs and the audio service.
+ *
+ * All of them work on caller provided buffers and never allocate. The loops are branch-free
+ * (saturation is done with min / max, which maps onto the Xtensa MIN / MAX instructions) and
+ * every kernel matches the scalar code it replaced bit for bit.
+ */
+
+// Output volume 0-100 to the squared Q16 gain the I2S codecs use, 100 is exactly 1 << 16
+inline int32_t PcmVolumeToGainQ16(int volume) {
+    if (volume <= 0) {
+        return 0;
+    }
+    if (volume >= 100) {
+        return 1 << 16;
+    }
+    return (int32_t)(((int64_t)volume * volume << 16) / 10000);
+}
+
+// 16-bit samples to 32-bit I2S slots scaled by a Q16 gain of at most 1 << 16, which never overflows
+void PcmToI2s32(const int16_t* input, int32_t* output, size_t samples, int32_t gain_q16);
+// 32-bit I2S slots to 16-bit samples, shifted right and saturated to +-INT16_MAX
+void I2s32ToPcm(const int32_t* input, int16_t* output, size_t samples, int shift);
+// In-place Q16 gain saturated to +-INT16_MAX
+void PcmApplyGainQ16(int16_t* data, size_t samples, int32_t gain_q16);
+
+void PcmDeinterleaveStereo(const int16_t* input, int16_t* left, int16_t* right, size_t frames);
+void PcmInterleaveStereo(const int16_t* left, const int16_t* right, int16_t* output, size_t frames);
+// Picks one channel out of interleaved frames
+void PcmExtractChannel(const int16_t* input, int16_t* output, size_t frames, int channels, int channel);
+
+#endif // PCM_KERNELS_H
@@ -0,0 +1,95 @@
+#include "encoder_controller.h"
+
+#include <esp_log.h>
+#include <algorithm>
+
+#define TAG "EncoderController"
+
+#define CONTROLLER_WINDOW_MS 1000
+// Queued audio that means the network does not keep up, and the level that counts as calm
+#define CONGESTED_QUEUE_MS 500
+#define CALM_QUEUE_MS 200
+#define BITRATE_STEP 2000
+#define CALM_WINDOWS_BEFORE_INCREASE 3
+// Share of real time spent encoding
+#define HIGH_ENCODE_LOAD 40
+#define LOW_ENCODE_LOAD 15
+
+EncoderController::EncoderController(int min_bitrate, int max_bitrate, int start_bitrate, int min_complexity, int max_complexity)
+    : min_bitrate_(min_bitrate), max_bitrate_(max_bitrate),
+      min_complexity_(min_complexity), max_complexity_(max_complexity),
+      complexity_ceiling_(max_complexity), bitrate_(std::clamp(start_bitrate, min_bitrate, max_bitrate)),
+      complexity_(min_complexity) {
+    statistics_.bitrate = bitrate_;
+    statistics_.complexity = complexity_;
+}
+
+void EncoderController::OnSendResult(bool success) {
+    if (!success) {
+        send_failures_++;
+    }
+}
+
+bool EncoderController::OnFrameEncoded(int frame_duration_ms, uint32_t encode_us, size_t send_queue_depth) {
+    window_ms_ += frame_duration_ms;
+    window_encode_us_ += encode_us;
+    window_queue_peak_ms_ = std::max<uint32_t>(window_queue_peak_ms_, send_queue_depth * frame_duration_ms);
+    if (window_ms_ < CONTROLLER_WINDOW_MS) {
+        return false;
+    }
+    bool changed = Evaluate();
+    window_ms_ = 0;
+    window_encode_us_ = 0;
+    window_queue_peak_ms_ = 0;
+    return changed;
+}
+
+bool EncoderController::Evaluate() {
+    uint32_t failures = send_failures_;
+    uint32_t window_failures = failures - window_failures_start_;
+    window_failures_start_ = failures;
+    uint32_t load = window_encode_us_ / (window_ms_ * 10);
+
+    int bitrate = bitrate_;
+    int complexity = complexity_;
+    bool congested = window_failures > 0 || window_queue_peak_ms_ >= CONGESTED_QUEUE_MS;
+    if (congested) {
+        calm_windows_ = 0;
+        bitrate = std::max(min_bitrate_, bitrate_ * 3 / 4);
+    } else if (window_queue_peak_ms_ <= CALM_QUEUE_MS && ++calm_windows_ >= CALM_WINDOWS_BEFORE_INCREASE) {
+        calm_windows_ = 0;
+        bitrate = std::min(max_bitrate_, bitrate_ + BITRATE_STEP);
+        if (load < LOW_ENCODE_LOAD) {
+            complexity = std::min(complexity_ceiling_, complexity_ + 1);
+        }
+    }
+    if (load >= HIGH_ENCODE_LOAD && complexity_ > min_complexity_) {
+        complexity = complexity_ - 1;
+        complexity_ceiling_ = complexity;
+    }
+
+    statistics_.send_failures = failures;
+    statistics_.queue_peak_ms = window_queue_peak_ms_;
+    statistics_.encode_load = load;
+    if (bitrate == bitrate_ && complexity == complexity_) {
+        return false;
+    }
+
+    ESP_LOGI(TAG, "Bitrate %d -> %d, complexity %d -> %d (queue %lums, %lu send failures, encode load %lu%%)",
+        bitrate_, bitrate, complexity_, complexity, window_queue_peak_ms_, window_failures, load);
+    if (bitrate < bitrate_) {
+        statistics_.bitrate_decreases++;
+    } else if (bitrate > bitrate_) {
+        statistics_.bitrate_increases++;
+    }
+    if (complexity < complexity_) {
+        statistics_.complexity_decreases++;
+    } else if (complexity > complexity_) {
+        statistics_.complexity_increases++;
+    }
+    bitrate_ = bitrate;
+    complexity_ = complexity;
+    statistics_.bitrate = bitrate_;
+    statistics_.complexity = complexity_;
+    return true;
+}
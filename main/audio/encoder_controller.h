@@ -0,0 +1,67 @@
+#ifndef ENCODER_CONTROLLER_H
+#define ENCODER_CONTROLLER_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+struct EncoderControllerStatistics {
+    int bitrate = 0;
+    int complexity = 0;
+    uint32_t bitrate_decreases = 0;
+    uint32_t bitrate_increases = 0;
+    uint32_t complexity_decreases = 0;
+    uint32_t complexity_increases = 0;
+    uint32_t send_failures = 0;
+    uint32_t queue_peak_ms = 0;     // Most audio waiting in the send queue during the last window
+    uint32_t encode_load = 0;       // Percent of real time spent encoding during the last window
+};
+
+/*
+ * Picks the uplink bitrate and complexity once per second of encoded audio.
+ *
+ * Bitrate follows the network like AIMD: audio piling up in the send queue or a failed send cuts
+ * it by a quarter, a few calm windows in a row raise it by a fixed step. Complexity follows the
+ * CPU: it climbs slowly while encoding takes a small share of real time and the network is calm,
+ * drops at once when encoding gets expensive, and does not climb past that level again.
+ *
+ * The bitrate starts at start_bitrate, clamped to the range, so enabling the controller does not
+ * raise the uplink above what Opus would pick on its own.
+ *
+ * OnFrameEncoded() is called by the encoder task, OnSendResult() by whoever sends the packets.
+ */
+class EncoderController {
+public:
+    EncoderController(int min_bitrate, int max_bitrate, int start_bitrate, int min_complexity, int max_complexity);
+
+    // Returns true when the bitrate or complexity changed and should be applied to the encoder
+    bool OnFrameEncoded(int frame_duration_ms, uint32_t encode_us, size_t send_queue_depth);
+    void OnSendResult(bool success);
+
+    inline int bitrate() const { return bitrate_; }
+    inline int complexity() const { return complexity_; }
+    EncoderControllerStatistics statistics() const { return statistics_; }
+
+private:
+    int min_bitrate_;
+    int max_bitrate_;
+    int min_complexity_;
+    int max_complexity_;
+    int complexity_ceiling_;
+    int bitrate_;
+    int complexity_;
+
+    // Current window
+    uint32_t window_ms_ = 0;
+    uint64_t window_encode_us_ = 0;
+    uint32_t window_queue_peak_ms_ = 0;
+    uint32_t window_failures_start_ = 0;
+    int calm_windows_ = 0;
+
+    std::atomic<uint32_t> send_failures_{0};
+    EncoderControllerStatistics statistics_;
+
+    bool Evaluate();
+};
+
+#endif // ENCODER_CONTROLLER_H
@@ -0,0 +1,186 @@
+#include "jitter_buffer.h"
+
+#include <esp_log.h>
+
+#define TAG "JitterBuffer"
+
+// Weight of a new sample in the running jitter estimate, 1/16 as in RFC 3550
+#define JITTER_SMOOTHING_SHIFT 4
+
+JitterBuffer::JitterBuffer(size_t capacity, int max_delay_ms) : max_delay_ms_(max_delay_ms) {
+    size_t slots = 1;
+    while (slots < capacity) {
+        slots <<= 1;
+    }
+    capacity_ = slots;
+    mask_ = slots - 1;
+    slots_.resize(slots);
+}
+
+void JitterBuffer::Reset() {
+    for (auto& slot : slots_) {
+        slot.reset();
+    }
+    size_ = 0;
+    started_ = false;
+    prebuffering_ = true;
+    prebuffer_start_us_ = 0;
+    missing_since_us_ = 0;
+    has_last_arrival_ = false;
+    // The jitter estimate describes the network rather than the stream, so it is kept
+}
+
+bool JitterBuffer::Put(std::unique_ptr<AudioStreamPacket>&& packet, int64_t arrival_time_us) {
+    statistics_.received++;
+    if (packet->frame_duration > 0) {
+        frame_duration_ms_ = packet->frame_duration;
+    }
+
+    bool sequenced = packet->sequence != 0;
+    if (!sequenced) {
+        packet->sequence = started_ ? highest_sequence_ + 1 : 1;
+    }
+    uint32_t sequence = packet->sequence;
+
+    if (!started_) {
+        started_ = true;
+        next_sequence_ = sequence;
+        highest_sequence_ = sequence;
+    }
+    if (IsBefore(sequence, next_sequence_)) {
+        if (next_sequence_ - sequence < capacity_) {
+            statistics_.late++;
+            return false;
+        }
+        // Far behind anything played, the server restarted the stream with lower numbers
+        Restart(sequence);
+    } else if (sequence - next_sequence_ >= capacity_) {
+        if (sequence - highest_sequence_ >= capacity_) {
+            // The stream jumped (e.g. the server restarted it), start over from here
+            Restart(sequence);
+        } else {
+            // Too far ahead to keep waiting for the oldest packets, give them up
+            SkipTo(sequence - capacity_ + 1);
+        }
+    }
+
+    auto& slot = slots_[sequence & mask_];
+    if (slot) {
+        statistics_.duplicated++;
+        return false;
+    }
+
+    if (sequenced) {
+        UpdateJitter(sequence, arrival_time_us);
+    } else {
+        prebuffering_ = false;
+    }
+    if (size_ == 0 && prebuffering_) {
+        prebuffer_start_us_ = arrival_time_us;
+    }
+    if (size_ == 0 || IsBefore(highest_sequence_, sequence)) {
+        highest_sequence_ = sequence;
+    }
+    slot = std::move(packet);
+    size_++;
+    return true;
+}
+
+JitterBufferResult JitterBuffer::Get(std::unique_ptr<AudioStreamPacket>& packet, int64_t now_us) {
+    if (size_ == 0) {
+        return kJitterBufferEmpty;
+    }
+
+    int64_t frame_us = frame_duration_ms_ * 1000;
+    int64_t target_us = TargetDelayUs();
+    int64_t buffered_us = (int64_t)(highest_sequence_ - next_sequence_ + 1) * frame_us;
+    if (prebuffering_) {
+        if (buffered_us < target_us && now_us - prebuffer_start_us_ < target_us) {
+            return kJitterBufferEmpty;
+        }
+        prebuffering_ = false;
+    }
+
+    auto& slot = slots_[next_sequence_ & mask_];
+    if (slot) {
+        packet = std::move(slot);
+        next_sequence_++;
+        missing_since_us_ = 0;
+        if (--size_ == 0) {
+            // Ran dry, build up the target delay again before the next packet plays
+            prebuffering_ = true;
+        }
+        return kJitterBufferPacketReady;
+    }
+
+    /*
+     * The next packet is missing but later ones are here. Wait for it up to the target delay,
+     * unless so much audio piled up behind it that waiting would only add latency.
+     */
+    if (missing_since_us_ == 0) {
+        missing_since_us_ = now_us;
+    }
+    if (buffered_us < (int64_t)max_delay_ms_ * 1000 && now_us - missing_since_us_ < target_us) {
+        return kJitterBufferEmpty;
+    }
+    ESP_LOGD(TAG, "Packet %lu lost, concealing", next_sequence_);
+    next_sequence_++;
+    missing_since_us_ = 0;
+    statistics_.lost++;
+    statistics_.concealed++;
+    return kJitterBufferPacketLost;
+}
+
+void JitterBuffer::UpdateJitter(uint32_t sequence, int64_t arrival_time_us) {
+    if (has_last_arrival_ && !IsBefore(last_arrival_sequence_, sequence)) {
+        // Reordered packets do not tell us anything about the transit time
+        return;
+    }
+    if (has_last_arrival_) {
+        int64_t expected_us = (int64_t)(sequence - last_arrival_sequence_) * frame_duration_ms_ * 1000;
+        int64_t deviation_us = (arrival_time_us - last_arrival_us_) - expected_us;
+        if (deviation_us < 0) {
+            deviation_us = -deviation_us;
+        }
+        jitter_us_ += (deviation_us - jitter_us_) >> JITTER_SMOOTHING_SHIFT;
+    }
+    has_last_arrival_ = true;
+    last_arrival_sequence_ = sequence;
+    last_arrival_us_ = arrival_time_us;
+
+    int64_t frame_us = frame_duration_ms_ * 1000;
+    statistics_.jitter_ms = jitter_us_ / 1000;
+    statistics_.target_frames = (TargetDelayUs() + frame_us - 1) / frame_us;
+}
+
+void JitterBuffer::Restart(uint32_t sequence) {
+    for (auto& slot : slots_) {
+        slot.reset();
+    }
+    size_ = 0;
+    next_sequence_ = sequence;
+    missing_since_us_ = 0;
+    has_last_arrival_ = false;
+}
+
+void JitterBuffer::SkipTo(uint32_t sequence) {
+    while (IsBefore(next_sequence_, sequence)) {
+        auto& slot = slots_[next_sequence_ & mask_];
+        if (slot) {
+            slot.reset();
+            size_--;
+            statistics_.dropped++;
+        } else {
+            statistics_.lost++;
+        }
+        next_sequence_++;
+    }
+    missing_since_us_ = 0;
+}
+
+/* One frame plus three times the smoothed jitter, capped at the maximum delay */
+int64_t JitterBuffer::TargetDelayUs() const {
+    int64_t target_us = frame_duration_ms_ * 1000 + jitter_us_ * 3;
+    int64_t max_us = (int64_t)max_delay_ms_ * 1000;
+    return target_us < max_us ? target_us : max_us;
+}
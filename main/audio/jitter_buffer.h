@@ -0,0 +1,87 @@
+#ifndef JITTER_BUFFER_H
+#define JITTER_BUFFER_H
+
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+
+#include "protocol.h"
+
+struct JitterBufferStatistics {
+    uint32_t received = 0;
+    uint32_t late = 0;          // Arrived after their slot was played or concealed
+    uint32_t duplicated = 0;
+    uint32_t lost = 0;          // Never arrived in time
+    uint32_t dropped = 0;       // Arrived, but given up on to make room for newer packets
+    uint32_t concealed = 0;     // Replaced by a packet loss concealment frame
+    uint32_t target_frames = 0;
+    uint32_t jitter_ms = 0;
+};
+
+enum JitterBufferResult {
+    kJitterBufferEmpty,         // Nothing to play, or waiting for a missing / prebuffered packet
+    kJitterBufferPacketReady,
+    kJitterBufferPacketLost,    // The next packet is lost, the caller should conceal one frame
+};
+
+/*
+ * Reorders incoming packets by sequence and decides when a missing packet is given up on.
+ *
+ * Packets without a sequence number (sequence == 0, e.g. WebSocket or local sounds) are numbered
+ * on arrival, so the buffer simply acts as a FIFO for them. For sequenced streams (MQTT + UDP) the
+ * arrival jitter is measured as in RFC 3550 and sets the target delay: playback starts once that
+ * many frames are buffered, and a missing packet is waited for at most that long. A sequence more
+ * than the capacity away from the playback position, in either direction, restarts the buffer. A new
+session may start numbering anywhere, so it calls Reset() first: a restarted stream close below the
+old position would otherwise be taken for late packets.
+ *
+ * Only the decoder task calls Put() / Get() / Reset(), Size() may be read from any thread.
+ */
+class JitterBuffer {
+public:
+    JitterBuffer(size_t capacity, int max_delay_ms);
+
+    void Reset();
+    // Returns false if the packet is dropped (late or duplicated)
+    bool Put(std::unique_ptr<AudioStreamPacket>&& packet, int64_t arrival_time_us);
+    JitterBufferResult Get(std::unique_ptr<AudioStreamPacket>& packet, int64_t now_us);
+
+    bool Full() const { return size_ >= capacity_; }
+    bool Empty() const { return size_ == 0; }
+    size_t Size() const { return size_; }
+    const JitterBufferStatistics& statistics() const { return statistics_; }
+
+private:
+    size_t capacity_;
+    size_t mask_;
+    int max_delay_ms_;
+    std::vector<std::unique_ptr<AudioStreamPacket>> slots_;
+    std::atomic<size_t> size_{0};
+    JitterBufferStatistics statistics_;
+
+    bool started_ = false;
+    bool prebuffering_ = true;
+    uint32_t next_sequence_ = 0;        // Next sequence to be played
+    uint32_t highest_sequence_ = 0;     // Highest sequence stored so far
+    int64_t prebuffer_start_us_ = 0;
+    int64_t missing_since_us_ = 0;
+    int frame_duration_ms_ = 60;
+
+    // Jitter estimation for sequenced packets
+    bool has_last_arrival_ = false;
+    uint32_t last_arrival_sequence_ = 0;
+    int64_t last_arrival_us_ = 0;
+    int64_t jitter_us_ = 0;
+
+    void UpdateJitter(uint32_t sequence, int64_t arrival_time_us);
+    void Restart(uint32_t sequence);
+    void SkipTo(uint32_t sequence);
+    int64_t TargetDelayUs() const;
+
+    static inline bool IsBefore(uint32_t a, uint32_t b) {
+        return static_cast<int32_t>(a - b) < 0;
+    }
+};
+
+#endif // JITTER_BUFFER_H
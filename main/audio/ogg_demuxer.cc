@@ -0,0 +1,199 @@
+#include "ogg_demuxer.h"
+
+#include <esp_log.h>
+#include <cstring>
+#include <algorithm>
+
+#define TAG "OggDemuxer"
+
+static const uint8_t kCapturePattern[4] = {'O', 'g', 'g', 'S'};
+
+OggDemuxer::OggDemuxer() {
+    Reset();
+}
+
+void OggDemuxer::Reset() {
+    state_ = kStateCapture;
+    capture_matched_ = 0;
+    header_size_ = 0;
+    segment_count_ = 0;
+    segment_filled_ = 0;
+    segment_index_ = 0;
+    fragment_ready_ = false;
+    fragment_complete_ = false;
+    fragment_remaining_ = 0;
+    packet_buffer_.clear();
+    packet_open_ = false;
+    discarding_ = false;
+    seen_head_ = false;
+    seen_tags_ = false;
+    sample_rate_ = 16000;
+    channels_ = 1;
+}
+
+bool OggDemuxer::Feed(const uint8_t* data, size_t size, const PacketHandler& handler) {
+    size_t pos = 0;
+    while (true) {
+        if (state_ == kStateBody) {
+            if (!fragment_ready_) {
+                if (segment_index_ == segment_count_) {
+                    state_ = kStateCapture;
+                    continue;
+                }
+                NextFragment();
+            }
+            const uint8_t* view = nullptr;
+            size_t view_size = 0;
+            if (fragment_remaining_ > 0) {
+                if (pos == size) {
+                    break;
+                }
+                size_t n = std::min(fragment_remaining_, size - pos);
+                fragment_remaining_ -= n;
+                if (!discarding_) {
+                    if (packet_buffer_.empty() && fragment_complete_ && fragment_remaining_ == 0) {
+                        // The whole packet is inside this chunk, hand it out without copying
+                        view = data + pos;
+                        view_size = n;
+                    } else {
+                        packet_buffer_.insert(packet_buffer_.end(), data + pos, data + pos + n);
+                    }
+                }
+                pos += n;
+                if (fragment_remaining_ > 0) {
+                    continue;
+                }
+            }
+
+            /* The fragment is done, either the packet is complete or it continues on the next page */
+            fragment_ready_ = false;
+            packet_open_ = !fragment_complete_;
+            if (!fragment_complete_) {
+                continue;
+            }
+            bool keep_going = true;
+            if (!discarding_) {
+                if (!packet_buffer_.empty()) {
+                    view = packet_buffer_.data();
+                    view_size = packet_buffer_.size();
+                }
+                keep_going = HandlePacket(view, view_size, handler);
+            }
+            packet_buffer_.clear();
+            discarding_ = false;
+            if (!keep_going) {
+                return false;
+            }
+            continue;
+        }
+
+        if (pos == size) {
+            break;
+        }
+        switch (state_) {
+        case kStateCapture: {
+            uint8_t byte = data[pos++];
+            if (byte == kCapturePattern[capture_matched_]) {
+                capture_matched_++;
+            } else {
+                capture_matched_ = byte == kCapturePattern[0] ? 1 : 0;
+            }
+            if (capture_matched_ == sizeof(kCapturePattern)) {
+                memcpy(header_, kCapturePattern, sizeof(kCapturePattern));
+                header_size_ = sizeof(kCapturePattern);
+                capture_matched_ = 0;
+                state_ = kStateHeader;
+            }
+            break;
+        }
+        case kStateHeader: {
+            size_t n = std::min(kHeaderSize - header_size_, size - pos);
+            memcpy(header_ + header_size_, data + pos, n);
+            header_size_ += n;
+            pos += n;
+            if (header_size_ == kHeaderSize) {
+                if (header_[4] != 0) {
+                    ESP_LOGW(TAG, "Unsupported Ogg version %u, resyncing", header_[4]);
+                    state_ = kStateCapture;
+                    break;
+                }
+                segment_count_ = header_[26];
+                segment_filled_ = 0;
+                state_ = kStateSegmentTable;
+            }
+            break;
+        }
+        case kStateSegmentTable: {
+            size_t n = std::min(segment_count_ - segment_filled_, size - pos);
+            memcpy(segments_ + segment_filled_, data + pos, n);
+            segment_filled_ += n;
+            pos += n;
+            if (segment_filled_ == segment_count_) {
+                BeginPage();
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+    return true;
+}
+
+void OggDemuxer::BeginPage() {
+    bool continued = header_[5] & 0x01;
+    if (!continued && packet_open_) {
+        ESP_LOGW(TAG, "Unterminated packet dropped (%d bytes)", (int)packet_buffer_.size());
+        packet_buffer_.clear();
+        packet_open_ = false;
+        discarding_ = false;
+    } else if (continued && !packet_open_) {
+        // We joined in the middle of a packet, skip the rest of it
+        discarding_ = true;
+    }
+    segment_index_ = 0;
+    fragment_ready_ = false;
+    state_ = kStateBody;
+}
+
+/* Sum up the lacing values of the next packet fragment in the current page */
+void OggDemuxer::NextFragment() {
+    size_t length = 0;
+    bool complete = false;
+    while (segment_index_ < segment_count_) {
+        uint8_t lacing = segments_[segment_index_++];
+        length += lacing;
+        if (lacing < 255) {
+            complete = true;
+            break;
+        }
+    }
+    fragment_remaining_ = length;
+    fragment_complete_ = complete;
+    fragment_ready_ = true;
+}
+
+bool OggDemuxer::HandlePacket(const uint8_t* data, size_t size, const PacketHandler& handler) {
+    if (size == 0) {
+        return true;
+    }
+    if (!seen_head_) {
+        // OpusHead: [0-7] "OpusHead", [8] version, [9] channel_count, [10-11] pre_skip,
+        // [12-15] input_sample_rate, [16-17] output_gain, [18] mapping_family
+        if (size >= 19 && memcmp(data, "OpusHead", 8) == 0) {
+            seen_head_ = true;
+            channels_ = data[9];
+            sample_rate_ = data[12] | (data[13] << 8) | (data[14] << 16) | (data[15] << 24);
+            ESP_LOGI(TAG, "OpusHead: version=%d, channels=%d, sample_rate=%d", data[8], channels_, sample_rate_);
+        }
+        return true;
+    }
+    if (!seen_tags_) {
+        // Expect OpusTags in the second packet
+        if (size >= 8 && memcmp(data, "OpusTags", 8) == 0) {
+            seen_tags_ = true;
+        }
+        return true;
+    }
+    return handler(data, size);
+}
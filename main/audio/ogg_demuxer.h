@@ -0,0 +1,71 @@
+#ifndef OGG_DEMUXER_H
+#define OGG_DEMUXER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <functional>
+
+/*
+ * Incremental Ogg/Opus demuxer.
+ *
+ * Feed() accepts the stream in chunks of any size and calls the handler for every Opus audio
+ * packet, OpusHead / OpusTags are consumed internally. Only the current page header and segment
+ * table are kept between calls. A packet that lies entirely inside the fed chunk is handed out
+ * as a view into that chunk, only packets split across chunks (or pages) are copied.
+ *
+ * The packet view is valid during the handler call only. Returning false from the handler stops
+ * the demuxer, Reset() must be called before feeding another stream.
+ */
+class OggDemuxer {
+public:
+    using PacketHandler = std::function<bool(const uint8_t* data, size_t size)>;
+
+    OggDemuxer();
+
+    void Reset();
+    // Returns false if the handler asked to stop
+    bool Feed(const uint8_t* data, size_t size, const PacketHandler& handler);
+
+    inline int sample_rate() const { return sample_rate_; }
+    inline int channels() const { return channels_; }
+
+private:
+    enum State {
+        kStateCapture,
+        kStateHeader,
+        kStateSegmentTable,
+        kStateBody,
+    };
+
+    static constexpr size_t kHeaderSize = 27;
+
+    State state_ = kStateCapture;
+    size_t capture_matched_ = 0;
+    uint8_t header_[kHeaderSize];
+    size_t header_size_ = 0;
+    uint8_t segments_[255];
+    size_t segment_count_ = 0;
+    size_t segment_filled_ = 0;
+    size_t segment_index_ = 0;
+
+    // Current packet fragment within the page
+    bool fragment_ready_ = false;
+    bool fragment_complete_ = false;
+    size_t fragment_remaining_ = 0;
+    // A packet that continues on the next chunk or page
+    std::vector<uint8_t> packet_buffer_;
+    bool packet_open_ = false;
+    bool discarding_ = false;
+
+    bool seen_head_ = false;
+    bool seen_tags_ = false;
+    int sample_rate_ = 16000;
+    int channels_ = 1;
+
+    void BeginPage();
+    void NextFragment();
+    bool HandlePacket(const uint8_t* data, size_t size, const PacketHandler& handler);
+};
+
+#endif // OGG_DEMUXER_H
@@ -0,0 +1,27 @@
+#ifndef OGG_PACKET_INDEX_H
+#define OGG_PACKET_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Packet table of a built-in Ogg/Opus sound, generated at build time by scripts/gen_lang.py.
+ *
+ * Every audio packet of the embedded file is listed by its offset and size, so the sound can be
+ * played straight from flash without demuxing. Sounds with packets spanning pages are not indexed
+ * and go through the OggDemuxer instead. The generator checks the packets against the file size
+ * at build time, and the header is generated again whenever a sound changes.
+ */
+struct OggPacketEntry {
+    uint32_t offset;
+    uint16_t size;
+};
+
+struct OggPacketIndex {
+    const char* data;               // Start of the embedded file, nullptr terminates a table of indexes
+    const OggPacketEntry* packets;
+    size_t packet_count;
+    int sample_rate;
+};
+
+#endif // OGG_PACKET_INDEX_H
@@ -0,0 +1,128 @@
+#ifndef PCM_RING_H
+#define PCM_RING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+// A run of samples inside the ring, at most two of them describe any range
+struct PcmSpan {
+    const int16_t* data = nullptr;
+    size_t size = 0;
+};
+
+/*
+ * Fixed-capacity ring of PCM samples, used to cut arbitrary sized chunks into fixed frames
+ * and to keep a rolling history of recent audio.
+ *
+ * The storage is allocated once in Reset(), Push() and Pop() only copy the samples in and out.
+ * When a push does not fit, the oldest samples are overwritten, so a ring sized for the
+ * history always holds the newest audio. Not thread-safe, callers guard it if it is shared.
+ */
+class PcmRing {
+public:
+    PcmRing() = default;
+    explicit PcmRing(size_t capacity) { Reset(capacity); }
+
+    void Reset(size_t capacity) {
+        buffer_.assign(capacity, 0);
+        Clear();
+    }
+
+    void Clear() {
+        head_ = 0;
+        size_ = 0;
+    }
+
+    inline size_t size() const { return size_; }
+    inline size_t capacity() const { return buffer_.size(); }
+    inline bool empty() const { return size_ == 0; }
+
+    // Returns the number of old samples that were overwritten to make room
+    size_t Push(const int16_t* data, size_t samples) {
+        size_t capacity = buffer_.size();
+        if (capacity == 0) {
+            return samples;
+        }
+        size_t dropped = 0;
+        if (samples > capacity) {
+            // Only the newest samples fit, everything stored before is lost as well
+            dropped = size_ + samples - capacity;
+            data += samples - capacity;
+            samples = capacity;
+            Clear();
+        } else if (size_ + samples > capacity) {
+            dropped = size_ + samples - capacity;
+            Consume(dropped);
+        }
+        size_t tail = (head_ + size_) % capacity;
+        size_t first = std::min(samples, capacity - tail);
+        memcpy(buffer_.data() + tail, data, first * sizeof(int16_t));
+        memcpy(buffer_.data(), data + first, (samples - first) * sizeof(int16_t));
+        size_ += samples;
+        return dropped;
+    }
+
+    // Zero-copy view of the oldest samples, second is empty unless the range wraps around
+    void Peek(size_t samples, PcmSpan& first, PcmSpan& second) const {
+        samples = std::min(samples, size_);
+        first.data = buffer_.data() + head_;
+        first.size = std::min(samples, buffer_.size() - head_);
+        second.data = buffer_.data();
+        second.size = samples - first.size;
+    }
+
+    void Consume(size_t samples) {
+        samples = std::min(samples, size_);
+        head_ = buffer_.empty() ? 0 : (head_ + samples) % buffer_.size();
+        size_ -= samples;
+        if (size_ == 0) {
+            head_ = 0;
+        }
+    }
+
+    // Copies the oldest samples out and removes them, returns the number of samples copied
+    size_t Pop(int16_t* out, size_t samples) {
+        PcmSpan first, second;
+        Peek(samples, first, second);
+        if (first.size == 0) {
+            return 0;
+        }
+        memcpy(out, first.data, first.size * sizeof(int16_t));
+        memcpy(out + first.size, second.data, second.size * sizeof(int16_t));
+        Consume(first.size + second.size);
+        return first.size + second.size;
+    }
+
+    // Fills frame with exactly frame_samples samples, returns false if not enough are buffered
+    bool PopFrame(std::vector<int16_t>& frame, size_t frame_samples) {
+        if (size_ < frame_samples) {
+            return false;
+        }
+        frame.resize(frame_samples);
+        Pop(frame.data(), frame_samples);
+        return true;
+    }
+
+    // Copies the newest samples without removing them, e.g. the audio history before an event
+    void Snapshot(std::vector<int16_t>& out, size_t samples) const {
+        samples = std::min(samples, size_);
+        out.resize(samples);
+        if (samples == 0) {
+            return;
+        }
+        size_t start = (head_ + size_ - samples) % buffer_.size();
+        size_t first = std::min(samples, buffer_.size() - start);
+        memcpy(out.data(), buffer_.data() + start, first * sizeof(int16_t));
+        memcpy(out.data() + first, buffer_.data(), (samples - first) * sizeof(int16_t));
+    }
+
+private:
+    std::vector<int16_t> buffer_;
+    size_t head_ = 0;
+    size_t size_ = 0;
+};
+
+#endif // PCM_RING_H
@@ -1,4 +1,5 @@
 #include "afe_audio_processor.h"
+#include "audio_pool.h"
 #include <esp_log.h>
 
 #define PROCESSOR_RUNNING 0x01
@@ -12,10 +13,7 @@ AfeAudioProcessor::AfeAudioProcessor()
 
 void AfeAudioProcessor::Initialize(AudioCodec* codec, int frame_duration_ms, srmodel_list_t* models_list) {
     codec_ = codec;
-    frame_samples_ = frame_duration_ms * 16000 / 1000;
-
-    // Pre-allocate output buffer capacity
-    output_buffer_.reserve(frame_samples_);
+    SetFrameDuration(frame_duration_ms);
 
     int ref_num = codec_->input_reference() ? 1 : 0;
 
@@ -66,6 +64,9 @@ void AfeAudioProcessor::Initialize(AudioCodec* codec, int frame_duration_ms, srm
 
     afe_iface_ = esp_afe_handle_from_config(afe_config);
     afe_data_ = afe_iface_->create_from_config(afe_config);
+
+    // Room for a partial frame plus one fetch, frames are cut out without moving the rest
+    output_ring_.Reset(frame_samples_ + afe_iface_->get_fetch_chunksize(afe_data_));
     
     xTaskCreate([](void* arg) {
         auto this_ = (AfeAudioProcessor*)arg;
@@ -81,6 +82,10 @@ AfeAudioProcessor::~AfeAudioProcessor() {
     vEventGroupDelete(event_group_);
 }
 
+void AfeAudioProcessor::SetFrameDuration(int frame_duration_ms) {
+    frame_samples_ = frame_duration_ms * 16000 / 1000;
+}
+
 size_t AfeAudioProcessor::GetFeedSize() {
     if (afe_data_ == nullptr) {
         return 0;
@@ -151,22 +156,19 @@ void AfeAudioProcessor::AudioProcessorTask() {
 
         if (output_callback_) {
             size_t samples = res->data_size / sizeof(int16_t);
-            
-            // Add data to buffer
-            output_buffer_.insert(output_buffer_.end(), res->data, res->data + samples);
-            
-            // Output complete frames when buffer has enough data
-            while (output_buffer_.size() >= frame_samples_) {
-                if (output_buffer_.size() == frame_samples_) {
-                    // If buffer size equals frame size, move the entire buffer
-                    output_callback_(std::move(output_buffer_));
-                    output_buffer_.clear();
-                    output_buffer_.reserve(frame_samples_);
-                } else {
-                    // If buffer size exceeds frame size, copy one frame and remove it
-                    output_callback_(std::vector<int16_t>(output_buffer_.begin(), output_buffer_.begin() + frame_samples_));
-                    output_buffer_.erase(output_buffer_.begin(), output_buffer_.begin() + frame_samples_);
-                }
+            size_t frame_samples = frame_samples_;
+            if (output_ring_.capacity() < frame_samples + fetch_size) {
+                // The frame duration grew, the partial frame left in the ring is dropped
+                output_ring_.Reset(frame_samples + fetch_size);
+            }
+
+            output_ring_.Push(res->data, samples);
+
+            // Output complete frames when the ring has enough data
+            while (output_ring_.size() >= frame_samples) {
+                auto frame = AudioPool::TakePcm();
+                output_ring_.PopFrame(frame, frame_samples);
+                output_callback_(std::move(frame));
             }
         }
     }
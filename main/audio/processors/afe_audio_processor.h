@@ -9,9 +9,11 @@
 #include <string>
 #include <vector>
 #include <functional>
+#include <atomic>
 
 #include "audio_processor.h"
 #include "audio_codec.h"
+#include "pcm_ring.h"
 
 class AfeAudioProcessor : public AudioProcessor {
 public:
@@ -19,6 +21,7 @@ public:
     ~AfeAudioProcessor();
 
     void Initialize(AudioCodec* codec, int frame_duration_ms, srmodel_list_t* models_list) override;
+    void SetFrameDuration(int frame_duration_ms) override;
     void Feed(std::vector<int16_t>&& data) override;
     void Start() override;
     void Stop() override;
@@ -35,9 +38,10 @@ private:
     std::function<void(std::vector<int16_t>&& data)> output_callback_;
     std::function<void(bool speaking)> vad_state_change_callback_;
     AudioCodec* codec_ = nullptr;
-    int frame_samples_ = 0;
+    // Read by the processor task, which resizes its output ring when the frame grows
+    std::atomic<int> frame_samples_{0};
     bool is_speaking_ = false;
-    std::vector<int16_t> output_buffer_;
+    PcmRing output_ring_;
 
     void AudioProcessorTask();
 };
@@ -5,6 +5,10 @@
 
 void NoAudioProcessor::Initialize(AudioCodec* codec, int frame_duration_ms, srmodel_list_t* models_list) {
     codec_ = codec;
+    SetFrameDuration(frame_duration_ms);
+}
+
+void NoAudioProcessor::SetFrameDuration(int frame_duration_ms) {
     frame_samples_ = frame_duration_ms * 16000 / 1000;
 }
 
@@ -14,9 +14,9 @@
 
 namespace {
 constexpr char TAG[] = "SdAudioPlayer";
-constexpr size_t kReadChunk = 4096;
+// Two of these are in flight per track, the demuxer only copies packets split across them
+constexpr size_t kReadChunk = 16 * 1024;
 constexpr uint64_t kMonitorPeriodUs = 250000;
-constexpr size_t kSpectrumBands = 8;
 
 bool HasOggExtension(const std::string& name) {
     auto pos = name.find_last_of('.');
@@ -54,6 +54,13 @@ void SdAudioPlayer::Initialize(const std::string& mount_point, AudioService* aud
     audio_service_ = audio_service;
     display_ = display;
     EnsureMonitorTimer();
+
+    // The bars are computed and drawn by the analyzer task, away from the audio output task
+    spectrum_analyzer_.Start([this](const SpectrumBars& bars) {
+        if (playing_) {
+            display_->UpdateAudioSpectrum(bars);
+        }
+    });
 }
 
 std::vector<SdAudioTrack> SdAudioPlayer::ScanTracks(const std::string& subdir) const {
@@ -123,18 +130,10 @@ bool SdAudioPlayer::Play(const std::string& path) {
         ESP_LOGE(TAG, "Failed to open %s", path.c_str());
         return false;
     }
-
-    std::vector<uint8_t> buffer;
-    buffer.reserve(64 * 1024);
-    uint8_t chunk[kReadChunk];
-    size_t read_bytes = 0;
-    while ((read_bytes = fread(chunk, 1, sizeof(chunk), file)) > 0) {
-        buffer.insert(buffer.end(), chunk, chunk + read_bytes);
-    }
-    fclose(file);
-
-    if (buffer.empty()) {
+    struct stat st;
+    if (fstat(fileno(file), &st) == 0 && st.st_size == 0) {
         ESP_LOGW(TAG, "Track %s is empty", path.c_str());
+        fclose(file);
         return false;
     }
 
@@ -144,12 +143,15 @@ bool SdAudioPlayer::Play(const std::string& path) {
     current_track_title_ = ExtractTitle(path);
     playing_ = true;
     last_frame_time_ = std::chrono::steady_clock::now();
+    play_start_time_ = last_frame_time_;
+    first_frame_pending_ = true;
 
     display_->ShowAudioPlayer(current_track_title_);
     StartMonitor();
 
-    std::string_view sound(reinterpret_cast<const char*>(buffer.data()), buffer.size());
-    audio_service_->PlaySound(sound);
+    // The stream owns the file from here, it is closed when the audio service is done with it
+    ESP_LOGI(TAG, "Streaming %s with %u byte buffers", path.c_str(), 2 * kReadChunk);
+    audio_service_->PlaySound(std::make_unique<SdTrackStream>(file, kReadChunk));
     return true;
 }
 
@@ -167,32 +169,14 @@ void SdAudioPlayer::OnPlaybackFrame(const std::vector<int16_t>& pcm) {
     }
 
     last_frame_time_ = std::chrono::steady_clock::now();
-
-    std::array<uint8_t, kSpectrumBands> bars{};
-    size_t samples_per_band = pcm.size() / kSpectrumBands;
-    if (samples_per_band == 0) {
-        samples_per_band = pcm.size();
-    }
-
-    for (size_t band = 0; band < kSpectrumBands; ++band) {
-        size_t start = band * samples_per_band;
-        size_t end = std::min(start + samples_per_band, pcm.size());
-        if (start >= end) {
-            break;
-        }
-        uint64_t accum = 0;
-        for (size_t i = start; i < end; ++i) {
-            accum += std::abs(pcm[i]);
-        }
-        uint32_t avg = static_cast<uint32_t>(accum / (end - start));
-        float normalized = static_cast<float>(avg) / 32768.0f;
-        if (normalized > 1.0f) {
-            normalized = 1.0f;
-        }
-        bars[band] = static_cast<uint8_t>(normalized * 100.0f);
+    if (first_frame_pending_) {
+        first_frame_pending_ = false;
+        auto latency = std::chrono::duration_cast<std::chrono::milliseconds>(last_frame_time_ - play_start_time_).count();
+        ESP_LOGI(TAG, "Time to first audio: %lld ms", latency);
     }
 
-    display_->UpdateAudioSpectrum(bars);
+    auto codec = Board::GetInstance().GetAudioCodec();
+    spectrum_analyzer_.Feed(pcm.data(), pcm.size(), codec->output_sample_rate());
 }
 
 void SdAudioPlayer::HandlePlaybackFinished() {
@@ -5,10 +5,13 @@
 #include <string>
 #include <vector>
 #include <chrono>
+#include <cstdio>
 
 #include <esp_timer.h>
 
 #include "audio_service.h"
+#include "sd_track_stream.h"
+#include "spectrum_analyzer.h"
 #include "display.h"
 
 struct SdAudioTrack {
@@ -35,8 +38,6 @@ public:
     void OnPlaybackFrame(const std::vector<int16_t>& pcm);
 
 private:
-    static constexpr size_t kSpectrumBands = 8;
-
     AudioService* audio_service_ = nullptr;
     Display* display_ = nullptr;
     std::string mount_point_;
@@ -44,7 +45,10 @@ private:
     std::string current_track_title_;
     bool playing_ = false;
     esp_timer_handle_t monitor_timer_ = nullptr;
+    SpectrumAnalyzer spectrum_analyzer_;
     std::chrono::steady_clock::time_point last_frame_time_;
+    std::chrono::steady_clock::time_point play_start_time_;
+    bool first_frame_pending_ = false;
 
     void HandlePlaybackFinished();
     void EnsureMonitorTimer();
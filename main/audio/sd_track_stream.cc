@@ -0,0 +1,75 @@
+#include "sd_track_stream.h"
+
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#define TAG "SdTrackStream"
+
+SdTrackStream::SdTrackStream(FILE* file, size_t chunk_size) : file_(file) {
+    buffers_[0].resize(chunk_size);
+    buffers_[1].resize(chunk_size);
+    auto ret = xTaskCreate([](void* arg) {
+        auto stream = static_cast<SdTrackStream*>(arg);
+        stream->ReaderTask();
+        vTaskDelete(NULL);
+    }, "sd_reader", 2048 * 2, this, 3, nullptr);
+    if (ret != pdPASS) {
+        // Play nothing rather than wait for a reader that never runs
+        ESP_LOGE(TAG, "Failed to create the SD reader task");
+        fclose(file_);
+        reader_done_ = true;
+    }
+}
+
+SdTrackStream::~SdTrackStream() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    stop_ = true;
+    cv_.notify_all();
+    cv_.wait(lock, [this]() { return reader_done_; });
+}
+
+void SdTrackStream::ReaderTask() {
+    int index = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this, index]() { return stop_ || !ready_[index]; });
+            if (stop_) {
+                break;
+            }
+        }
+        // The buffer is not visible to the consumer until ready_ is set again
+        size_t bytes = fread(buffers_[index].data(), 1, buffers_[index].size(), file_);
+        std::lock_guard<std::mutex> lock(mutex_);
+        filled_[index] = bytes;
+        ready_[index] = true;
+        cv_.notify_all();
+        if (bytes == 0) {
+            break;
+        }
+        index ^= 1;
+    }
+
+    fclose(file_);
+    std::lock_guard<std::mutex> lock(mutex_);
+    reader_done_ = true;
+    cv_.notify_all();
+}
+
+std::string_view SdTrackStream::Read() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (holding_) {
+        // Hand the buffer returned by the previous call back to the reader
+        ready_[read_index_] = false;
+        read_index_ ^= 1;
+        holding_ = false;
+        cv_.notify_all();
+    }
+    cv_.wait(lock, [this]() { return ready_[read_index_] || reader_done_; });
+    if (!ready_[read_index_] || filled_[read_index_] == 0) {
+        return std::string_view();
+    }
+    holding_ = true;
+    return std::string_view(reinterpret_cast<const char*>(buffers_[read_index_].data()), filled_[read_index_]);
+}
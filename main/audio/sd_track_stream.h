@@ -0,0 +1,38 @@
+#ifndef SD_TRACK_STREAM_H
+#define SD_TRACK_STREAM_H
+
+#include <cstdio>
+#include <cstdint>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+
+#include "audio_sound_source.h"
+
+/*
+ * Streams a track from the SD card with two fixed buffers: a reader task fills one buffer
+ * while the audio service demuxes the other, so memory stays bounded regardless of file size.
+ */
+class SdTrackStream : public AudioSoundSource {
+public:
+    SdTrackStream(FILE* file, size_t chunk_size);
+    ~SdTrackStream();
+
+    std::string_view Read() override;
+
+private:
+    FILE* file_;
+    std::vector<uint8_t> buffers_[2];
+    size_t filled_[2] = {0, 0};
+    bool ready_[2] = {false, false};
+    int read_index_ = 0;
+    bool holding_ = false;
+    bool stop_ = false;
+    bool reader_done_ = false;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+
+    void ReaderTask();
+};
+
+#endif // SD_TRACK_STREAM_H
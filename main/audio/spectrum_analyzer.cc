@@ -0,0 +1,179 @@
+#include "spectrum_analyzer.h"
+
+#include <esp_log.h>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#define TAG "SpectrumAnalyzer"
+
+namespace {
+constexpr float kPi = 3.14159265358979f;
+
+struct SpectrumTables {
+    int16_t window[SPECTRUM_FFT_SIZE];
+    int16_t cos[SPECTRUM_FFT_SIZE / 2];
+    int16_t sin[SPECTRUM_FFT_SIZE / 2];
+
+    SpectrumTables() {
+        for (int i = 0; i < SPECTRUM_FFT_SIZE; i++) {
+            window[i] = (int16_t)(32767.0f * 0.5f * (1.0f - cosf(2.0f * kPi * i / (SPECTRUM_FFT_SIZE - 1))));
+        }
+        for (int i = 0; i < SPECTRUM_FFT_SIZE / 2; i++) {
+            cos[i] = (int16_t)lrintf(32767.0f * cosf(2.0f * kPi * i / SPECTRUM_FFT_SIZE));
+            sin[i] = (int16_t)lrintf(32767.0f * sinf(2.0f * kPi * i / SPECTRUM_FFT_SIZE));
+        }
+    }
+};
+
+const SpectrumTables& GetTables() {
+    static SpectrumTables tables;
+    return tables;
+}
+} // namespace
+
+SpectrumAnalyzer::SpectrumAnalyzer() {
+    GetTables();
+}
+
+SpectrumAnalyzer::~SpectrumAnalyzer() {
+    if (task_handle_ != nullptr) {
+        vTaskDelete(task_handle_);
+    }
+}
+
+void SpectrumAnalyzer::Start(std::function<void(const SpectrumBars&)> on_bars) {
+    if (task_handle_ != nullptr) {
+        return;
+    }
+    on_bars_ = on_bars;
+    xTaskCreate([](void* arg) {
+        auto analyzer = static_cast<SpectrumAnalyzer*>(arg);
+        analyzer->AnalyzerTask();
+        vTaskDelete(NULL);
+    }, "spectrum", 2048 + 1024, this, 1, &task_handle_);
+}
+
+void SpectrumAnalyzer::Feed(const int16_t* pcm, size_t samples, int sample_rate) {
+    if (task_handle_ == nullptr || samples == 0) {
+        return;
+    }
+
+    /* Only the newest samples are analyzed, older windows are overwritten if the task lags behind */
+    auto& window = input_.write_slot();
+    size_t count = std::min(samples, (size_t)SPECTRUM_FFT_SIZE);
+    size_t padding = SPECTRUM_FFT_SIZE - count;
+    memset(window.samples, 0, padding * sizeof(int16_t));
+    memcpy(window.samples + padding, pcm + samples - count, count * sizeof(int16_t));
+    window.sample_rate = sample_rate;
+    input_.Publish();
+    xTaskNotifyGive(task_handle_);
+}
+
+void SpectrumAnalyzer::AnalyzerTask() {
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (!input_.Fetch()) {
+            continue;
+        }
+        auto& window = input_.read_slot();
+        Analyze(window.samples, window.sample_rate, bars_);
+        if (on_bars_) {
+            on_bars_(bars_);
+        }
+    }
+}
+
+/* Log-spaced band edges in FFT bins, every band gets at least one bin */
+void SpectrumAnalyzer::ConfigureBands(int sample_rate) {
+    band_sample_rate_ = sample_rate;
+    float max_frequency = std::min(SPECTRUM_MAX_FREQUENCY, sample_rate / 2);
+    float ratio = max_frequency / SPECTRUM_MIN_FREQUENCY;
+    int previous = 0;
+    for (int band = 0; band <= SPECTRUM_BANDS; band++) {
+        float frequency = SPECTRUM_MIN_FREQUENCY * powf(ratio, (float)band / SPECTRUM_BANDS);
+        int bin = lrintf(frequency * SPECTRUM_FFT_SIZE / sample_rate);
+        if (band > 0 && bin <= previous) {
+            bin = previous + 1;
+        }
+        bin = std::max(1, std::min(bin, SPECTRUM_FFT_SIZE / 2));
+        band_edges_[band] = bin;
+        previous = bin;
+    }
+    ESP_LOGI(TAG, "Spectrum bands for %d Hz: %u-%u bins", sample_rate, band_edges_[0], band_edges_[SPECTRUM_BANDS]);
+}
+
+void SpectrumAnalyzer::Analyze(const int16_t* samples, int sample_rate, SpectrumBars& bars) {
+    if (sample_rate != band_sample_rate_) {
+        ConfigureBands(sample_rate);
+    }
+
+    auto& tables = GetTables();
+    for (int i = 0; i < SPECTRUM_FFT_SIZE; i++) {
+        fft_data_[i * 2] = (int16_t)(((int32_t)samples[i] * tables.window[i]) >> 15);
+        fft_data_[i * 2 + 1] = 0;
+    }
+    Fft(fft_data_);
+
+    /*
+     * The FFT output is scaled by 1/N, so a full scale sine under the Hann window peaks at
+     * 32767 / 4 in its bin. Band power is compared against that.
+     */
+    const float full_scale_power = (32767.0f / 4) * (32767.0f / 4);
+    for (int band = 0; band < SPECTRUM_BANDS; band++) {
+        uint64_t power = 0;
+        for (int bin = band_edges_[band]; bin < band_edges_[band + 1]; bin++) {
+            int32_t re = fft_data_[bin * 2];
+            int32_t im = fft_data_[bin * 2 + 1];
+            power += re * re + im * im;
+        }
+        if (power == 0) {
+            bars[band] = 0;
+            continue;
+        }
+        float db = 10.0f * log10f(power / full_scale_power);
+        int level = (int)((db + SPECTRUM_RANGE_DB) * 100 / SPECTRUM_RANGE_DB);
+        bars[band] = (uint8_t)std::max(0, std::min(level, 100));
+    }
+}
+
+/*
+ * In-place complex Q15 radix-2 FFT, every stage halves the values so the result is scaled by 1/N.
+ * Products and halvings round to nearest, truncating them would bias every bin downwards.
+ */
+void SpectrumAnalyzer::Fft(int16_t* data) {
+    const int n = SPECTRUM_FFT_SIZE;
+    for (int i = 1, j = 0; i < n; i++) {
+        int bit = n >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            std::swap(data[i * 2], data[j * 2]);
+            std::swap(data[i * 2 + 1], data[j * 2 + 1]);
+        }
+    }
+
+    auto& tables = GetTables();
+    for (int length = 2; length <= n; length <<= 1) {
+        int half = length >> 1;
+        int step = n / length;
+        for (int start = 0; start < n; start += length) {
+            for (int k = 0; k < half; k++) {
+                int32_t wr = tables.cos[k * step];
+                int32_t wi = -tables.sin[k * step];
+                int16_t* a = data + (start + k) * 2;
+                int16_t* b = data + (start + k + half) * 2;
+                int32_t tr = (b[0] * wr - b[1] * wi + (1 << 14)) >> 15;
+                int32_t ti = (b[0] * wi + b[1] * wr + (1 << 14)) >> 15;
+                int32_t ar = a[0];
+                int32_t ai = a[1];
+                a[0] = (int16_t)((ar + tr + 1) >> 1);
+                a[1] = (int16_t)((ai + ti + 1) >> 1);
+                b[0] = (int16_t)((ar - tr + 1) >> 1);
+                b[1] = (int16_t)((ai - ti + 1) >> 1);
+            }
+        }
+    }
+}
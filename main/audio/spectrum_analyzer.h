@@ -0,0 +1,62 @@
+#ifndef SPECTRUM_ANALYZER_H
+#define SPECTRUM_ANALYZER_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include "triple_buffer.h"
+
+#define SPECTRUM_FFT_SIZE 256
+#define SPECTRUM_BANDS 8
+#define SPECTRUM_MIN_FREQUENCY 60
+#define SPECTRUM_MAX_FREQUENCY 8000
+// Band levels from -SPECTRUM_RANGE_DB up to full scale are mapped to 0..100
+#define SPECTRUM_RANGE_DB 60
+
+using SpectrumBars = std::array<uint8_t, SPECTRUM_BANDS>;
+
+/*
+ * Frequency spectrum of the audio being played, shown as bars by the audio player.
+ *
+ * Feed() is called from the audio output task and only copies the newest FFT window into a
+ * lock-free mailbox. A low priority task applies a Hann window, runs a Q15 radix-2 FFT, sums the
+ * power into log-spaced bands and calls the bars callback from its own context.
+ */
+class SpectrumAnalyzer {
+public:
+    SpectrumAnalyzer();
+    ~SpectrumAnalyzer();
+
+    void Start(std::function<void(const SpectrumBars&)> on_bars);
+    void Feed(const int16_t* pcm, size_t samples, int sample_rate);
+
+    // Exposed for testing on the host, data holds SPECTRUM_FFT_SIZE interleaved re/im pairs
+    static void Fft(int16_t* data);
+    // Exposed for testing on the host, the bars of SPECTRUM_FFT_SIZE samples
+    void Analyze(const int16_t* samples, int sample_rate, SpectrumBars& bars);
+
+private:
+    struct Window {
+        int16_t samples[SPECTRUM_FFT_SIZE];
+        int sample_rate;
+    };
+
+    TaskHandle_t task_handle_ = nullptr;
+    std::function<void(const SpectrumBars&)> on_bars_;
+    TripleBuffer<Window> input_;
+    SpectrumBars bars_;
+    int band_sample_rate_ = 0;
+    uint16_t band_edges_[SPECTRUM_BANDS + 1];
+    int16_t fft_data_[SPECTRUM_FFT_SIZE * 2];
+
+    void AnalyzerTask();
+    void ConfigureBands(int sample_rate);
+};
+
+#endif // SPECTRUM_ANALYZER_H
@@ -0,0 +1,111 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Fixed-capacity lock-free single-producer / single-consumer ring.
+ *
+ * Push() is only called by the producer and Pop() only by the consumer. Indexes run freely
+ * and wrap naturally, the slot array is rounded up to a power of two so the wrap stays aligned.
+ *
+ * Clear() may be called from any thread. It does not touch the slots, it only records the
+ * current tail as a flush mark; the consumer drops everything before the mark on its next Pop().
+ * Size() and Empty() already exclude flushed items, Full() reports the physical slot usage.
+ */
+template <typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(size_t capacity)
+        : capacity_(capacity), mask_(RoundUpToPowerOfTwo(capacity) - 1), slots_(new T[mask_ + 1]) {
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    inline size_t capacity() const { return capacity_; }
+
+    bool Push(T&& item) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) >= capacity_) {
+            return false;
+        }
+        slots_[tail & mask_] = std::move(item);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool Push(const T& item) {
+        T copy(item);
+        return Push(std::move(copy));
+    }
+
+    bool Pop(T& item) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t flush = flush_.load(std::memory_order_acquire);
+        if (IsBefore(head, flush)) {
+            while (head != flush) {
+                slots_[head & mask_] = T();
+                head++;
+            }
+            head_.store(head, std::memory_order_release);
+        }
+        if (head == tail_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = std::move(slots_[head & mask_]);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    void Clear() {
+        size_t tail = tail_.load(std::memory_order_acquire);
+        size_t flush = flush_.load(std::memory_order_relaxed);
+        while (IsBefore(flush, tail) &&
+            !flush_.compare_exchange_weak(flush, tail, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+        }
+    }
+
+    size_t Size() const {
+        // Load order matters: head <= flush <= tail must hold for the values we read
+        size_t head = head_.load(std::memory_order_acquire);
+        size_t flush = flush_.load(std::memory_order_acquire);
+        size_t tail = tail_.load(std::memory_order_acquire);
+        if (IsBefore(head, flush)) {
+            head = flush;
+        }
+        return tail - head;
+    }
+
+    bool Empty() const { return Size() == 0; }
+
+    bool Full() const {
+        size_t head = head_.load(std::memory_order_acquire);
+        return tail_.load(std::memory_order_acquire) - head >= capacity_;
+    }
+
+private:
+    const size_t capacity_;
+    const size_t mask_;
+    std::unique_ptr<T[]> slots_;
+    std::atomic<size_t> head_{0};
+    std::atomic<size_t> tail_{0};
+    std::atomic<size_t> flush_{0};
+
+    static inline bool IsBefore(size_t a, size_t b) {
+        return static_cast<std::ptrdiff_t>(a - b) < 0;
+    }
+
+    static size_t RoundUpToPowerOfTwo(size_t value) {
+        size_t result = 1;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+};
+
+#endif // SPSC_QUEUE_H
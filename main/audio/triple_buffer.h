@@ -0,0 +1,45 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+#include <cstdint>
+
+/*
+ * Lock-free single-writer / single-reader mailbox that always holds the newest value.
+ *
+ * The writer fills the slot returned by write_slot() and calls Publish(), the reader calls Fetch()
+ * and then reads read_slot() until its next Fetch(). Neither side ever waits for the other,
+ * values published faster than the reader fetches them are simply overwritten.
+ */
+template <typename T>
+class TripleBuffer {
+public:
+    T& write_slot() { return slots_[write_index_]; }
+    const T& read_slot() const { return slots_[read_index_]; }
+
+    void Publish() {
+        uint8_t previous = middle_.exchange(write_index_ | kFresh, std::memory_order_acq_rel);
+        write_index_ = previous & kIndexMask;
+    }
+
+    // Returns false if nothing new was published since the last fetch
+    bool Fetch() {
+        if (!(middle_.load(std::memory_order_relaxed) & kFresh)) {
+            return false;
+        }
+        uint8_t previous = middle_.exchange(read_index_, std::memory_order_acq_rel);
+        read_index_ = previous & kIndexMask;
+        return true;
+    }
+
+private:
+    static constexpr uint8_t kFresh = 0x80;
+    static constexpr uint8_t kIndexMask = 0x03;
+
+    T slots_[3] = {};
+    uint8_t write_index_ = 0;
+    uint8_t read_index_ = 1;
+    std::atomic<uint8_t> middle_{2};
+};
+
+#endif // TRIPLE_BUFFER_H
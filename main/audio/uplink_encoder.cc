@@ -0,0 +1,61 @@
+#include "uplink_encoder.h"
+
+#include <esp_log.h>
+#include <cstring>
+
+#define TAG "UplinkEncoder"
+
+UplinkEncoder::UplinkEncoder(int sample_rate, int channels, int duration_ms)
+    : channels_(channels), duration_ms_(duration_ms), frame_size_(sample_rate / 1000 * duration_ms) {
+    int error;
+    encoder_ = opus_encoder_create(sample_rate, channels, OPUS_APPLICATION_VOIP, &error);
+    if (encoder_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to create audio encoder, error code: %d", error);
+        return;
+    }
+
+    // Silence is coded as tiny packets
+    opus_encoder_ctl(encoder_, OPUS_SET_DTX(1));
+    opus_encoder_ctl(encoder_, OPUS_SET_SIGNAL(OPUS_SIGNAL_VOICE));
+    SetComplexity(0);
+}
+
+UplinkEncoder::~UplinkEncoder() {
+    if (encoder_ != nullptr) {
+        opus_encoder_destroy(encoder_);
+    }
+}
+
+void UplinkEncoder::SetBitrate(int bitrate) {
+    if (encoder_ == nullptr || bitrate == bitrate_) {
+        return;
+    }
+    bitrate_ = bitrate;
+    opus_encoder_ctl(encoder_, OPUS_SET_BITRATE(bitrate > 0 ? bitrate : OPUS_AUTO));
+}
+
+void UplinkEncoder::SetComplexity(int complexity) {
+    if (encoder_ == nullptr) {
+        return;
+    }
+    complexity_ = complexity;
+    opus_encoder_ctl(encoder_, OPUS_SET_COMPLEXITY(complexity));
+}
+
+bool UplinkEncoder::Encode(const std::vector<int16_t>& pcm, std::vector<uint8_t>& opus, size_t headroom) {
+    if (encoder_ == nullptr || pcm.size() != (size_t)(frame_size_ * channels_)) {
+        return false;
+    }
+
+    // Encoded into the scratch buffer, so the packet only grows to its real size and its buffer can
+    // go back to the payload pool
+    auto ret = opus_encode(encoder_, pcm.data(), frame_size_, scratch_, UPLINK_MAX_PACKET_SIZE);
+    if (ret < 0) {
+        ESP_LOGE(TAG, "Failed to encode audio, error code: %d", ret);
+        opus.clear();
+        return false;
+    }
+    opus.resize(headroom + ret);
+    memcpy(opus.data() + headroom, scratch_, ret);
+    return true;
+}
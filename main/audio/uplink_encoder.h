@@ -0,0 +1,42 @@
+#ifndef UPLINK_ENCODER_H
+#define UPLINK_ENCODER_H
+
+#include <opus.h>
+
+#include <vector>
+#include <cstdint>
+
+// Largest packet Opus produces for 60ms (three 20ms frames of at most 1275 bytes)
+#define UPLINK_MAX_PACKET_SIZE (1275 * 3 + 7)
+
+/*
+ * Opus encoder of the microphone uplink, used directly through libopus because the bitrate
+ * has to follow the network at runtime, which OpusEncoderWrapper does not expose.
+ * Only the encoder task touches it.
+ */
+class UplinkEncoder {
+public:
+    UplinkEncoder(int sample_rate, int channels, int duration_ms);
+    ~UplinkEncoder();
+
+    // 0 lets Opus pick the bitrate from the sample rate and frame duration
+    void SetBitrate(int bitrate);
+    void SetComplexity(int complexity);
+    // The frame must hold exactly one frame duration of samples, the packet is written after headroom bytes
+    bool Encode(const std::vector<int16_t>& pcm, std::vector<uint8_t>& opus, size_t headroom = 0);
+
+    inline int duration_ms() const { return duration_ms_; }
+    inline int bitrate() const { return bitrate_; }
+    inline int complexity() const { return complexity_; }
+
+private:
+    OpusEncoder* encoder_ = nullptr;
+    int channels_;
+    int duration_ms_;
+    int frame_size_;
+    int bitrate_ = 0;
+    int complexity_ = 0;
+    uint8_t scratch_[UPLINK_MAX_PACKET_SIZE];
+};
+
+#endif // UPLINK_ENCODER_H
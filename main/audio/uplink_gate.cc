@@ -0,0 +1,68 @@
+#include "uplink_gate.h"
+#include "audio_pool.h"
+
+UplinkGate::UplinkGate(int hangover_ms, int keepalive_ms, int lookback_ms)
+    : hangover_ms_(hangover_ms), keepalive_ms_(keepalive_ms), lookback_ms_(lookback_ms) {
+}
+
+void UplinkGate::Reset() {
+    for (auto& pcm : held_) {
+        AudioPool::RecyclePcm(std::move(pcm));
+    }
+    held_.clear();
+    silence_ms_ = 0;
+    since_keepalive_ms_ = 0;
+    skipped_frames_ = 0;
+    statistics_ = UplinkGateStatistics();
+}
+
+void UplinkGate::Send(std::vector<int16_t>&& pcm, const SendCallback& send) {
+    statistics_.sent++;
+    uint32_t skipped = skipped_frames_;
+    skipped_frames_ = 0;
+    send(std::move(pcm), skipped);
+}
+
+void UplinkGate::Process(std::vector<int16_t>&& pcm, int frame_duration_ms, bool speaking, const SendCallback& send) {
+    statistics_.frames++;
+
+    if (speaking) {
+        while (!held_.empty()) {
+            Send(std::move(held_.front()), send);
+            held_.pop_front();
+        }
+        silence_ms_ = 0;
+        since_keepalive_ms_ = 0;
+        Send(std::move(pcm), send);
+        return;
+    }
+
+    silence_ms_ += frame_duration_ms;
+    if (silence_ms_ <= hangover_ms_) {
+        Send(std::move(pcm), send);
+        return;
+    }
+
+    since_keepalive_ms_ += frame_duration_ms;
+    if (keepalive_ms_ > 0 && since_keepalive_ms_ >= keepalive_ms_) {
+        // The held frames are older than the keepalive, they are not worth sending anymore
+        for (auto& frame : held_) {
+            AudioPool::RecyclePcm(std::move(frame));
+            statistics_.suppressed++;
+            skipped_frames_++;
+        }
+        held_.clear();
+        since_keepalive_ms_ = 0;
+        statistics_.keepalive++;
+        Send(std::move(pcm), send);
+        return;
+    }
+
+    held_.push_back(std::move(pcm));
+    if ((int)held_.size() * frame_duration_ms > lookback_ms_) {
+        AudioPool::RecyclePcm(std::move(held_.front()));
+        held_.pop_front();
+        statistics_.suppressed++;
+        skipped_frames_++;
+    }
+}
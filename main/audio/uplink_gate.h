@@ -0,0 +1,54 @@
+#ifndef UPLINK_GATE_H
+#define UPLINK_GATE_H
+
+#include <deque>
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+struct UplinkGateStatistics {
+    uint32_t frames = 0;
+    uint32_t sent = 0;
+    uint32_t suppressed = 0;    // Never encoded nor sent
+    uint32_t keepalive = 0;     // Silent frames sent so the server knows the stream is alive
+};
+
+/*
+ * Decides which processed microphone frames go to the encoder while the VAD reports silence.
+ *
+ * Speech and the first hangover_ms of every silence are sent as usual, so the server still hears
+ * the end of an utterance. After that only one frame per keepalive_ms is sent, the rest is held
+ * for lookback_ms and then dropped. When speech starts again, the held frames are sent first,
+ * which covers the onset the VAD needs to make up its mind.
+ *
+ * Every sent frame carries the number of frames dropped right before it, so the transport can
+ * leave a matching gap in its sequence numbers. Not thread-safe, the owner serializes Process()
+ * on the audio processor task with Reset() and the statistics.
+ *
+ * The uplink encoder runs with Opus DTX, which only shrinks the silent frames that are encoded;
+ * the gate keeps most of them from being encoded and sent at all.
+ */
+class UplinkGate {
+public:
+    using SendCallback = std::function<void(std::vector<int16_t>&& pcm, uint32_t skipped_frames)>;
+
+    UplinkGate(int hangover_ms, int keepalive_ms, int lookback_ms);
+
+    void Reset();
+    void Process(std::vector<int16_t>&& pcm, int frame_duration_ms, bool speaking, const SendCallback& send);
+    const UplinkGateStatistics& statistics() const { return statistics_; }
+
+private:
+    int hangover_ms_;
+    int keepalive_ms_;
+    int lookback_ms_;
+    std::deque<std::vector<int16_t>> held_;
+    int silence_ms_ = 0;
+    int since_keepalive_ms_ = 0;
+    uint32_t skipped_frames_ = 0;
+    UplinkGateStatistics statistics_;
+
+    void Send(std::vector<int16_t>&& pcm, const SendCallback& send);
+};
+
+#endif // UPLINK_GATE_H
@@ -19,6 +19,8 @@ public:
     virtual void Stop() = 0;
     virtual size_t GetFeedSize() = 0;
     virtual void EncodeWakeWordData() = 0;
+    // Frame duration of the pre-roll packets, it should match the uplink of the next session
+    virtual void SetFrameDuration(int frame_duration_ms) = 0;
     virtual bool GetWakeWordOpus(std::vector<uint8_t>& opus) = 0;
     virtual const std::string& GetLastDetectedWakeWord() const = 0;
 };
@@ -82,6 +82,9 @@ size_t EspWakeWord::GetFeedSize() {
 void EspWakeWord::EncodeWakeWordData() {
 }
 
+void EspWakeWord::SetFrameDuration(int frame_duration_ms) {
+}
+
 bool EspWakeWord::GetWakeWordOpus(std::vector<uint8_t>& opus) {
     return false;
 }
@@ -25,6 +25,7 @@ public:
     void Stop();
     size_t GetFeedSize();
     void EncodeWakeWordData();
+    void SetFrameDuration(int frame_duration_ms);
     bool GetWakeWordOpus(std::vector<uint8_t>& opus);
     const std::string& GetLastDetectedWakeWord() const { return last_detected_wake_word_; }
 
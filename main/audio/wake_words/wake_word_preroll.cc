@@ -0,0 +1,173 @@
+#include "wake_word_preroll.h"
+#include "audio_pool.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_heap_caps.h>
+#include <cassert>
+
+#define TAG "WakeWordPreroll"
+
+#define PREROLL_ENCODE_TASK_STACK_SIZE (4096 * 7)
+// Below the audio tasks, the background encoding must never delay capture or playback
+#define PREROLL_ENCODE_TASK_PRIORITY 1
+
+WakeWordPreroll::WakeWordPreroll(int sample_rate, int frame_duration_ms, int window_ms)
+    : sample_rate_(sample_rate),
+      window_ms_(window_ms),
+      frame_duration_ms_(frame_duration_ms),
+      frame_samples_(sample_rate * frame_duration_ms / 1000),
+      max_packets_(window_ms / frame_duration_ms) {
+    // If the encoder falls behind by a whole window, the oldest audio is not worth encoding anymore
+    pending_pcm_.Reset(max_packets_ * frame_samples_);
+}
+
+WakeWordPreroll::~WakeWordPreroll() {
+    if (encode_task_ != nullptr) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            stopping_ = true;
+            cv_.notify_all();
+            cv_.wait(lock, [this]() { return !task_running_; });
+        }
+        // The task parks itself after leaving its loop, delete it before releasing its stack
+        vTaskDelete(encode_task_);
+    }
+
+    if (encode_task_stack_ != nullptr) {
+        heap_caps_free(encode_task_stack_);
+    }
+
+    if (encode_task_buffer_ != nullptr) {
+        heap_caps_free(encode_task_buffer_);
+    }
+}
+
+void WakeWordPreroll::Store(const int16_t* data, size_t samples) {
+    if (samples == 0) {
+        return;
+    }
+    if (encode_task_ == nullptr) {
+        StartEncodeTask();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_pcm_.Push(data, samples);
+    if (pending_pcm_.size() >= frame_samples_) {
+        cv_.notify_all();
+    }
+}
+
+void WakeWordPreroll::Snapshot() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    output_.clear();
+    snapshot_requested_ = true;
+    snapshot_time_ = esp_timer_get_time();
+    cv_.notify_all();
+}
+
+void WakeWordPreroll::SetFrameDuration(int frame_duration_ms) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (frame_duration_ms == frame_duration_ms_) {
+        return;
+    }
+    frame_duration_ms_ = frame_duration_ms;
+    frame_samples_ = sample_rate_ * frame_duration_ms / 1000;
+    max_packets_ = window_ms_ / frame_duration_ms;
+    if (pending_pcm_.capacity() != max_packets_ * frame_samples_) {
+        // The samples not encoded yet carry over, the encode task cuts them with the new duration
+        std::vector<int16_t> pending;
+        pending_pcm_.Snapshot(pending, pending_pcm_.size());
+        pending_pcm_.Reset(max_packets_ * frame_samples_);
+        pending_pcm_.Push(pending.data(), pending.size());
+    }
+    for (auto& opus : window_) {
+        AudioPool::RecyclePayload(std::move(opus));
+    }
+    window_.clear();
+}
+
+bool WakeWordPreroll::GetOpus(std::vector<uint8_t>& opus) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this]() {
+        return !output_.empty();
+    });
+    opus.swap(output_.front());
+    output_.pop_front();
+    return !opus.empty();
+}
+
+void WakeWordPreroll::StartEncodeTask() {
+    encode_task_stack_ = (StackType_t*)heap_caps_malloc(PREROLL_ENCODE_TASK_STACK_SIZE, MALLOC_CAP_SPIRAM);
+    assert(encode_task_stack_ != nullptr);
+    encode_task_buffer_ = (StaticTask_t*)heap_caps_malloc(sizeof(StaticTask_t), MALLOC_CAP_INTERNAL);
+    assert(encode_task_buffer_ != nullptr);
+
+    task_running_ = true;
+    encode_task_ = xTaskCreateStatic([](void* arg) {
+        auto this_ = (WakeWordPreroll*)arg;
+        this_->EncodeTask();
+        vTaskSuspend(NULL);
+    }, "wake_word_preroll", PREROLL_ENCODE_TASK_STACK_SIZE, this, PREROLL_ENCODE_TASK_PRIORITY,
+        encode_task_stack_, encode_task_buffer_);
+}
+
+void WakeWordPreroll::EncodeTask() {
+    while (true) {
+        auto frame = AudioPool::TakePcm();
+        int frame_duration;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this]() {
+                return stopping_ || snapshot_requested_ || pending_pcm_.size() >= frame_samples_;
+            });
+            if (stopping_) {
+                break;
+            }
+            frame_duration = frame_duration_ms_;
+            if (!pending_pcm_.PopFrame(frame, frame_samples_)) {
+                /* Every frame stored before the detection is encoded, hand the window over */
+                snapshot_requested_ = false;
+                pending_pcm_.Clear();
+                output_.swap(window_);
+                window_.clear();
+                size_t packets = output_.size();
+                output_.emplace_back();
+                cv_.notify_all();
+                ESP_LOGI(TAG, "Wake word pre-roll ready: %u packets in %ld us", packets,
+                    (long)(esp_timer_get_time() - snapshot_time_));
+                AudioPool::RecyclePcm(std::move(frame));
+                continue;
+            }
+        }
+
+        if (frame_duration != encoder_frame_duration_) {
+            encoder_ = std::make_unique<OpusEncoderWrapper>(sample_rate_, 1, frame_duration);
+            encoder_->SetComplexity(0); // 0 is the fastest
+            encoder_frame_duration_ = frame_duration;
+        }
+
+        auto opus = AudioPool::TakePayload();
+        bool encoded = encoder_->Encode(std::move(frame), opus);
+        AudioPool::RecyclePcm(std::move(frame));
+        if (!encoded) {
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (frame_duration != frame_duration_ms_) {
+            AudioPool::RecyclePayload(std::move(opus));
+            continue;
+        }
+        window_.emplace_back(std::move(opus));
+        if (window_.size() > max_packets_) {
+            AudioPool::RecyclePayload(std::move(window_.front()));
+            window_.pop_front();
+        }
+    }
+
+    encoder_.reset();
+    std::lock_guard<std::mutex> lock(mutex_);
+    task_running_ = false;
+    cv_.notify_all();
+}
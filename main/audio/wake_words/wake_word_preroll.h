@@ -0,0 +1,66 @@
+#ifndef WAKE_WORD_PREROLL_H
+#define WAKE_WORD_PREROLL_H
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <opus_encoder.h>
+
+#include <deque>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+
+#include "pcm_ring.h"
+
+/*
+ * Rolling window of the last seconds of wake word audio, kept already encoded as Opus packets.
+ *
+ * Store() only copies the PCM into a ring, a low priority task cuts it into Opus frames and
+ * encodes them in the background as the audio arrives, dropping the oldest packets beyond the
+ * window. When a wake word is detected, Snapshot() hands over the packets encoded so far once
+ * the few queued frames are drained, so the pre-roll is ready almost at once instead of
+ * encoding the whole window on detection.
+ */
+class WakeWordPreroll {
+public:
+    WakeWordPreroll(int sample_rate, int frame_duration_ms, int window_ms);
+    ~WakeWordPreroll();
+
+    void Store(const int16_t* data, size_t samples);
+    void Snapshot();
+    // Packets already encoded with the old duration are dropped, the audio not encoded yet is kept
+    // and framed with the new duration
+    void SetFrameDuration(int frame_duration_ms);
+    // Blocks until the next pre-roll packet is ready, returns false after the last one
+    bool GetOpus(std::vector<uint8_t>& opus);
+
+private:
+    int sample_rate_;
+    int window_ms_;
+    int frame_duration_ms_;
+    size_t frame_samples_;
+    size_t max_packets_;
+
+    TaskHandle_t encode_task_ = nullptr;
+    StaticTask_t* encode_task_buffer_ = nullptr;
+    StackType_t* encode_task_stack_ = nullptr;
+    std::unique_ptr<OpusEncoderWrapper> encoder_;
+    int encoder_frame_duration_ = 0;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    PcmRing pending_pcm_;
+    std::deque<std::vector<uint8_t>> window_;
+    std::deque<std::vector<uint8_t>> output_;
+    bool snapshot_requested_ = false;
+    int64_t snapshot_time_ = 0;
+    bool stopping_ = false;
+    bool task_running_ = false;
+
+    void StartEncodeTask();
+    void EncodeTask();
+};
+
+#endif
@@ -13,6 +13,7 @@
 #include "lvgl_display.h"
 #include "mcp_server.h"
 #include "system_info.h"
+#include "network_metrics.h"
 
 #ifdef CONFIG_XIAOZHI_ENABLE_CAMERA_DEBUG_MODE
 #undef LOG_LOCAL_LEVEL
@@ -620,7 +621,7 @@ std::string Esp32Camera::Explain(const std::string& question) {
     }
     http->SetHeader("Content-Type", "multipart/form-data; boundary=" + boundary);
     http->SetHeader("Transfer-Encoding", "chunked");
-    if (!http->Open("POST", explain_url_)) {
+    if (!NetworkMetrics::GetInstance().OpenHttp(*http, "POST", explain_url_)) {
         ESP_LOGE(TAG, "Failed to connect to explain URL");
         // Clear the queue
         encoder_thread_.join();
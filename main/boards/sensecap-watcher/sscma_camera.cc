@@ -6,6 +6,7 @@
 #include "system_info.h"
 #include "config.h"
 #include "settings.h"
+#include "network_metrics.h"
 
 #include <esp_log.h>
 #include <esp_heap_caps.h>
@@ -656,7 +657,7 @@ std::string SscmaCamera::Explain(const std::string& question) {
     }
     http->SetHeader("Content-Type", "multipart/form-data; boundary=" + boundary);
     http->SetHeader("Transfer-Encoding", "chunked");
-    if (!http->Open("POST", explain_url_)) {
+    if (!NetworkMetrics::GetInstance().OpenHttp(*http, "POST", explain_url_)) {
         ESP_LOGE(TAG, "Failed to connect to explain URL");
         return "{\"success\": false, \"message\": \"Failed to connect to explain URL\"}";
     }
@@ -0,0 +1,352 @@
+#include "http_connection.h"
+
+#include <esp_log.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cctype>
+
+#define TAG "HttpConnection"
+
+#define HTTP_CONNECTION_RECEIVE_SIZE 1024
+// ReadAll() reserves for the announced body up to this, a bogus Content-Length must not take the heap
+#define HTTP_CONNECTION_MAX_RESERVE (16 * 1024)
+
+static std::string ToLower(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return std::tolower(c); });
+    return text;
+}
+
+static std::string Trim(const std::string& text) {
+    size_t start = text.find_first_not_of(" \t");
+    if (start == std::string::npos) {
+        return "";
+    }
+    size_t end = text.find_last_not_of(" \t");
+    return text.substr(start, end - start + 1);
+}
+
+HttpConnection::HttpConnection(std::unique_ptr<HttpTransport>&& transport, const std::string& host, int port, int timeout_ms)
+    : transport_(std::move(transport)), host_(host), port_(port), timeout_ms_(timeout_ms) {
+}
+
+bool HttpConnection::ParseUrl(const std::string& url, bool& tls, std::string& host, int& port, std::string& path) {
+    size_t start = url.find("://");
+    if (start == std::string::npos) {
+        return false;
+    }
+    std::string scheme = ToLower(url.substr(0, start));
+    if (scheme == "https") {
+        tls = true;
+        port = 443;
+    } else if (scheme == "http") {
+        tls = false;
+        port = 80;
+    } else {
+        return false;
+    }
+    start += 3;
+    size_t end = url.find_first_of("/?#", start);
+    std::string authority = url.substr(start, end == std::string::npos ? std::string::npos : end - start);
+    size_t colon = authority.rfind(':');
+    if (colon != std::string::npos && authority.find(']', colon) == std::string::npos) {
+        port = atoi(authority.c_str() + colon + 1);
+        authority.resize(colon);
+    }
+    if (authority.empty() || port <= 0 || port > 65535) {
+        return false;
+    }
+    host = authority;
+    path = end == std::string::npos ? "/" : url.substr(end);
+    if (path[0] != '/') {
+        path = "/" + path;
+    }
+    // The fragment stays on the client
+    size_t fragment = path.find('#');
+    if (fragment != std::string::npos) {
+        path.resize(fragment);
+    }
+    return true;
+}
+
+void HttpConnection::SetHeader(const std::string& key, const std::string& value) {
+    headers_.emplace_back(key, value);
+}
+
+void HttpConnection::SetContent(std::string&& content) {
+    content_ = std::move(content);
+}
+
+bool HttpConnection::reusable() const {
+    return transport_->connected() && !failed_ && keep_alive_ && body_complete_ && status_code_ > 0 &&
+        buffer_offset_ == buffer_.size();
+}
+
+bool HttpConnection::Connect() {
+    transport_->Close();
+    if (!transport_->Connect(host_, port_, timeout_ms_)) {
+        return false;
+    }
+    connects_++;
+    return true;
+}
+
+void HttpConnection::Close() {
+    transport_->Close();
+    ResetResponse();
+}
+
+void HttpConnection::ResetResponse() {
+    buffer_.clear();
+    buffer_offset_ = 0;
+    status_code_ = 0;
+    keep_alive_ = false;
+    chunked_ = false;
+    content_length_ = -1;
+    body_remaining_ = 0;
+    chunk_remaining_ = 0;
+    body_complete_ = false;
+    failed_ = false;
+}
+
+bool HttpConnection::Open(const std::string& method, const std::string& path) {
+    bool head_only = method == "HEAD";
+    std::string request = method + " " + path + " HTTP/1.1\r\nHost: " + host_;
+    if (port_ != 80 && port_ != 443) {
+        request += ":" + std::to_string(port_);
+    }
+    request += "\r\n";
+    for (auto& header : headers_) {
+        request += header.first + ": " + header.second + "\r\n";
+    }
+    if (!content_.empty() || method == "POST" || method == "PUT" || method == "PATCH") {
+        request += "Content-Length: " + std::to_string(content_.size()) + "\r\n";
+    }
+    request += "\r\n";
+    request += content_;
+    // Nothing of this request is carried over to the next one
+    headers_.clear();
+    content_.clear();
+
+    reused_ = reusable() && transport_->IsIdleAlive();
+    while (true) {
+        if (!reused_ && !Connect()) {
+            ResetResponse();
+            failed_ = true;
+            return false;
+        }
+        ResetResponse();
+        bool nothing_received = true;
+        if (transport_->Send(request.data(), request.size()) && ReadHead(head_only, nothing_received)) {
+            return true;
+        }
+        transport_->Close();
+        failed_ = true;
+        // Only a kept connection that went away without answering is worth a second try
+        if (!reused_ || !nothing_received) {
+            return false;
+        }
+        ESP_LOGW(TAG, "Kept connection to %s was closed, connecting again", host_.c_str());
+        reused_ = false;
+    }
+}
+
+bool HttpConnection::Fill() {
+    if (buffer_offset_ > 0) {
+        buffer_.erase(0, buffer_offset_);
+        buffer_offset_ = 0;
+    }
+    size_t size = buffer_.size();
+    buffer_.resize(size + HTTP_CONNECTION_RECEIVE_SIZE);
+    int ret = transport_->Receive(&buffer_[size], HTTP_CONNECTION_RECEIVE_SIZE);
+    buffer_.resize(size + std::max(ret, 0));
+    return ret > 0;
+}
+
+bool HttpConnection::ReadHead(bool head_only, bool& nothing_received) {
+    while (true) {
+        size_t end = buffer_.find("\r\n\r\n", buffer_offset_);
+        if (end == std::string::npos) {
+            if (buffer_.size() - buffer_offset_ > HTTP_CONNECTION_MAX_HEAD_SIZE) {
+                ESP_LOGE(TAG, "Response head from %s is too large", host_.c_str());
+                return false;
+            }
+            if (!Fill()) {
+                return false;
+            }
+            nothing_received = false;
+            continue;
+        }
+
+        std::string head = buffer_.substr(buffer_offset_, end - buffer_offset_);
+        buffer_offset_ = end + 4;
+        if (!ParseHead(head, head_only)) {
+            return false;
+        }
+        // Interim responses such as 100 Continue are followed by the real one
+        if (status_code_ >= 200 || status_code_ == 101) {
+            return true;
+        }
+    }
+}
+
+bool HttpConnection::ParseHead(const std::string& head, bool head_only) {
+    size_t line_end = head.find("\r\n");
+    std::string status_line = head.substr(0, line_end);
+    if (status_line.compare(0, 5, "HTTP/") != 0 || status_line.size() < 12) {
+        ESP_LOGE(TAG, "Invalid status line from %s: %s", host_.c_str(), status_line.c_str());
+        return false;
+    }
+    // HTTP/1.1 keeps the connection unless told otherwise, HTTP/1.0 the other way round
+    keep_alive_ = status_line.compare(0, 8, "HTTP/1.0") != 0;
+    status_code_ = atoi(status_line.c_str() + status_line.find(' ') + 1);
+    chunked_ = false;
+    content_length_ = -1;
+
+    while (line_end != std::string::npos) {
+        size_t start = line_end + 2;
+        line_end = head.find("\r\n", start);
+        std::string line = head.substr(start, line_end == std::string::npos ? std::string::npos : line_end - start);
+        size_t colon = line.find(':');
+        if (colon == std::string::npos) {
+            continue;
+        }
+        std::string name = ToLower(Trim(line.substr(0, colon)));
+        std::string value = Trim(line.substr(colon + 1));
+        if (name == "content-length") {
+            content_length_ = strtoll(value.c_str(), nullptr, 10);
+        } else if (name == "transfer-encoding") {
+            chunked_ = ToLower(value).find("chunked") != std::string::npos;
+        } else if (name == "connection") {
+            value = ToLower(value);
+            if (value.find("close") != std::string::npos) {
+                keep_alive_ = false;
+            } else if (value.find("keep-alive") != std::string::npos) {
+                keep_alive_ = true;
+            }
+        }
+    }
+
+    if (head_only || status_code_ < 200 || status_code_ == 204 || status_code_ == 304) {
+        body_complete_ = true;
+    } else if (chunked_) {
+        content_length_ = -1;
+    } else if (content_length_ >= 0) {
+        body_remaining_ = content_length_;
+        body_complete_ = content_length_ == 0;
+    } else {
+        // The body ends with the connection
+        keep_alive_ = false;
+    }
+    return true;
+}
+
+bool HttpConnection::ReadLine(std::string& line) {
+    while (true) {
+        size_t end = buffer_.find("\r\n", buffer_offset_);
+        if (end != std::string::npos) {
+            line = buffer_.substr(buffer_offset_, end - buffer_offset_);
+            buffer_offset_ = end + 2;
+            return true;
+        }
+        if (buffer_.size() - buffer_offset_ > HTTP_CONNECTION_MAX_HEAD_SIZE || !Fill()) {
+            return false;
+        }
+    }
+}
+
+int HttpConnection::ReadRaw(char* buffer, size_t size) {
+    if (buffer_offset_ < buffer_.size()) {
+        size = std::min(size, buffer_.size() - buffer_offset_);
+        std::copy_n(buffer_.data() + buffer_offset_, size, buffer);
+        buffer_offset_ += size;
+        if (buffer_offset_ == buffer_.size()) {
+            buffer_.clear();
+            buffer_offset_ = 0;
+        }
+        return size;
+    }
+    return transport_->Receive(buffer, size);
+}
+
+int HttpConnection::Read(char* buffer, size_t size) {
+    if (failed_) {
+        return -1;
+    }
+    if (body_complete_ || size == 0) {
+        return 0;
+    }
+
+    if (chunked_) {
+        if (chunk_remaining_ == 0) {
+            std::string line;
+            char* end = nullptr;
+            if (ReadLine(line)) {
+                chunk_remaining_ = strtoull(line.c_str(), &end, 16);
+            }
+            if (end == nullptr || end == line.c_str()) {
+                ESP_LOGE(TAG, "Invalid chunk from %s", host_.c_str());
+                failed_ = true;
+                return -1;
+            }
+            if (chunk_remaining_ == 0) {
+                // The last chunk is followed by optional trailers and an empty line
+                do {
+                    if (!ReadLine(line)) {
+                        failed_ = true;
+                        return -1;
+                    }
+                } while (!line.empty());
+                body_complete_ = true;
+                return 0;
+            }
+        }
+        int ret = ReadRaw(buffer, std::min<uint64_t>(size, chunk_remaining_));
+        if (ret <= 0) {
+            failed_ = true;
+            return -1;
+        }
+        chunk_remaining_ -= ret;
+        std::string line;
+        if (chunk_remaining_ == 0 && (!ReadLine(line) || !line.empty())) {
+            failed_ = true;
+            return -1;
+        }
+        return ret;
+    }
+
+    if (content_length_ >= 0) {
+        int ret = ReadRaw(buffer, std::min<uint64_t>(size, body_remaining_));
+        if (ret <= 0) {
+            failed_ = true;
+            return -1;
+        }
+        body_remaining_ -= ret;
+        body_complete_ = body_remaining_ == 0;
+        return ret;
+    }
+
+    int ret = ReadRaw(buffer, size);
+    if (ret < 0) {
+        failed_ = true;
+        return -1;
+    }
+    body_complete_ = ret == 0;
+    return ret;
+}
+
+std::string HttpConnection::ReadAll() {
+    std::string body;
+    if (content_length_ > 0) {
+        body.reserve(std::min<int64_t>(content_length_, HTTP_CONNECTION_MAX_RESERVE));
+    }
+    char buffer[HTTP_CONNECTION_RECEIVE_SIZE];
+    while (true) {
+        int ret = Read(buffer, sizeof(buffer));
+        if (ret <= 0) {
+            break;
+        }
+        body.append(buffer, ret);
+    }
+    return body;
+}
@@ -0,0 +1,87 @@
+#ifndef HTTP_CONNECTION_H
+#define HTTP_CONNECTION_H
+
+#include "http_transport.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <utility>
+#include <cstdint>
+
+#define HTTP_CONNECTION_TIMEOUT_MS 10000
+#define HTTP_CONNECTION_MAX_HEAD_SIZE 8192
+
+/*
+ * HTTP/1.1 client connection to a single host that can carry several requests one after another.
+ *
+ * The headers and content set before Open() belong to that request only, the next one starts from
+ * none. After a response the connection takes the next request only if the server did not ask to
+ * close it and the body was read to the end, reusable() tells; otherwise Open() connects again.
+ * A kept connection the server closed while it was idle is noticed before sending, or when it
+ * closes without answering, and the request then goes out once more on a new connection.
+ *
+ * Bodies framed by Content-Length, chunked transfer encoding or the end of the connection are
+ * supported. Not thread-safe, one request at a time.
+ */
+class HttpConnection {
+public:
+    HttpConnection(std::unique_ptr<HttpTransport>&& transport, const std::string& host, int port,
+        int timeout_ms = HTTP_CONNECTION_TIMEOUT_MS);
+
+    // Splits an http:// or https:// URL, the port defaults to the one of the scheme
+    static bool ParseUrl(const std::string& url, bool& tls, std::string& host, int& port, std::string& path);
+
+    void SetHeader(const std::string& key, const std::string& value);
+    void SetContent(std::string&& content);
+    // Sends the request and reads the response status line and headers
+    bool Open(const std::string& method, const std::string& path);
+    // Reads up to size bytes of the body, returns 0 at its end and -1 on error
+    int Read(char* buffer, size_t size);
+    std::string ReadAll();
+    void Close();
+
+    inline int status_code() const { return status_code_; }
+    // Announced by Content-Length, -1 for chunked or close delimited bodies
+    inline int64_t body_length() const { return content_length_; }
+    inline bool body_complete() const { return body_complete_; }
+    // True if the last Open() went over a connection kept from an earlier request
+    inline bool reused() const { return reused_; }
+    inline uint32_t connects() const { return connects_; }
+    bool reusable() const;
+
+private:
+    std::unique_ptr<HttpTransport> transport_;
+    std::string host_;
+    int port_;
+    int timeout_ms_;
+
+    // Request
+    std::vector<std::pair<std::string, std::string>> headers_;
+    std::string content_;
+
+    // Response
+    std::string buffer_;        // Received but not consumed yet
+    size_t buffer_offset_ = 0;
+    int status_code_ = 0;
+    bool keep_alive_ = false;
+    bool chunked_ = false;
+    int64_t content_length_ = -1;
+    uint64_t body_remaining_ = 0;
+    uint64_t chunk_remaining_ = 0;
+    bool body_complete_ = false;
+    bool failed_ = false;
+    bool reused_ = false;
+    uint32_t connects_ = 0;
+
+    bool Connect();
+    void ResetResponse();
+    // nothing_received stays true if the connection ended before the response started
+    bool ReadHead(bool head_only, bool& nothing_received);
+    bool ParseHead(const std::string& head, bool head_only);
+    bool ReadLine(std::string& line);
+    int ReadRaw(char* buffer, size_t size);
+    bool Fill();
+};
+
+#endif // HTTP_CONNECTION_H
@@ -0,0 +1,284 @@
+#include "http_pool.h"
+#include "board.h"
+#include "network_metrics.h"
+#include "tls_transport.h"
+
+#include <esp_log.h>
+#include <chrono>
+
+#define TAG "HttpPool"
+
+#define HTTP_POOL_ACQUIRE_TIMEOUT_MS 10000
+#define HTTP_POOL_IDLE_TIMEOUT_US (CONFIG_HTTP_POOL_IDLE_TIMEOUT_SECONDS * 1000000LL)
+
+// One slot per connect id. The 4G modules need a separate id for every open socket, and no other
+// client uses these.
+static const int kPoolConnectIds[] = { 5, 4 };
+
+PooledHttp::PooledHttp(HttpPool* pool, int slot, const std::string& origin, std::unique_ptr<HttpConnection>&& connection,
+    std::unique_ptr<Http>&& http)
+    : pool_(pool), slot_(slot), origin_(origin), connection_(std::move(connection)), http_(std::move(http)) {
+}
+
+PooledHttp::PooledHttp(PooledHttp&& other)
+    : pool_(other.pool_), slot_(other.slot_), origin_(std::move(other.origin_)),
+      connection_(std::move(other.connection_)), http_(std::move(other.http_)) {
+    other.pool_ = nullptr;
+}
+
+PooledHttp::~PooledHttp() {
+    if (pool_ == nullptr) {
+        return;
+    }
+    if (connection_ != nullptr) {
+        connection_->Close();
+    }
+    if (http_ != nullptr) {
+        http_->Close();
+    }
+    pool_->Release(slot_, nullptr, false);
+}
+
+void PooledHttp::SetHeader(const std::string& key, const std::string& value) {
+    if (connection_ != nullptr) {
+        connection_->SetHeader(key, value);
+    } else {
+        http_->SetHeader(key, value);
+    }
+}
+
+void PooledHttp::SetContent(std::string&& content) {
+    if (connection_ != nullptr) {
+        connection_->SetContent(std::move(content));
+    } else {
+        http_->SetContent(std::move(content));
+    }
+}
+
+bool PooledHttp::Open(const std::string& method, const std::string& url) {
+    auto& metrics = NetworkMetrics::GetInstance();
+    if (http_ != nullptr) {
+        pool_->CountOpen(false, false);
+        return metrics.OpenHttp(*http_, method, url);
+    }
+
+    bool tls;
+    std::string host;
+    int port;
+    std::string path;
+    if (!HttpConnection::ParseUrl(url, tls, host, port, path)) {
+        ESP_LOGE(TAG, "Invalid URL: %s", url.c_str());
+        return false;
+    }
+    bool kept = connection_->reusable();
+    int64_t start = esp_timer_get_time();
+    bool success = connection_->Open(method, path);
+    metrics.Record(url, success, esp_timer_get_time() - start, success && connection_->reused());
+    pool_->CountOpen(kept, success && connection_->reused());
+    return success;
+}
+
+int PooledHttp::GetStatusCode() {
+    return connection_ != nullptr ? connection_->status_code() : http_->GetStatusCode();
+}
+
+std::string PooledHttp::ReadAll() {
+    return connection_ != nullptr ? connection_->ReadAll() : http_->ReadAll();
+}
+
+void PooledHttp::Release() {
+    if (pool_ == nullptr) {
+        return;
+    }
+    if (http_ != nullptr) {
+        http_->Close();
+        http_.reset();
+        pool_->Release(slot_, nullptr, false);
+    } else if (connection_->reusable()) {
+        pool_->Release(slot_, std::move(connection_), false);
+    } else {
+        ESP_LOGD(TAG, "Not keeping the connection to %s", origin_.c_str());
+        bool answered = connection_->status_code() > 0;
+        connection_->Close();
+        connection_.reset();
+        pool_->Release(slot_, nullptr, answered);
+    }
+    pool_ = nullptr;
+}
+
+HttpPool::HttpPool() {
+    for (int connect_id : kPoolConnectIds) {
+        slots_.emplace_back();
+        slots_.back().connect_id = connect_id;
+    }
+
+    esp_timer_create_args_t idle_timer_args = {
+        .callback = [](void* arg) {
+            HttpPool* pool = (HttpPool*)arg;
+            pool->CloseExpired();
+        },
+        .arg = this,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "http_pool_idle",
+        .skip_unhandled_events = true,
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&idle_timer_args, &idle_timer_));
+}
+
+HttpPool::~HttpPool() {
+    if (idle_timer_ != nullptr) {
+        esp_timer_stop(idle_timer_);
+        esp_timer_delete(idle_timer_);
+    }
+}
+
+PooledHttp HttpPool::Acquire(const std::string& url) {
+    bool tls;
+    std::string host;
+    int port;
+    std::string path;
+    if (!HttpConnection::ParseUrl(url, tls, host, port, path)) {
+        ESP_LOGE(TAG, "Invalid URL: %s", url.c_str());
+        return PooledHttp();
+    }
+    std::string origin = (tls ? "https://" : "http://") + host + ":" + std::to_string(port);
+    // lwIP only reaches the network on Wi-Fi, the 4G modules keep their sockets in the modem
+    bool keep_alive = Board::GetInstance().GetBoardType() == "wifi";
+
+    std::unique_ptr<HttpConnection> evicted;
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    // An idle connection to the same origin first, then an empty slot, then the oldest idle connection
+    Slot* slot = nullptr;
+    auto find_slot = [this, &origin, &slot]() {
+        Slot* empty = nullptr;
+        Slot* oldest = nullptr;
+        for (auto& it : slots_) {
+            if (it.busy) {
+                continue;
+            }
+            if (it.connection != nullptr && it.origin == origin) {
+                slot = &it;
+                return true;
+            }
+            if (it.connection == nullptr) {
+                if (empty == nullptr) {
+                    empty = &it;
+                }
+            } else if (oldest == nullptr || it.idle_since_us < oldest->idle_since_us) {
+                oldest = &it;
+            }
+        }
+        slot = empty != nullptr ? empty : oldest;
+        return slot != nullptr;
+    };
+    if (!condition_.wait_for(lock, std::chrono::milliseconds(HTTP_POOL_ACQUIRE_TIMEOUT_MS), find_slot)) {
+        statistics_.timeouts++;
+        ESP_LOGW(TAG, "No free connection for %s", origin.c_str());
+        return PooledHttp();
+    }
+
+    slot->busy = true;
+    int index = slot - slots_.data();
+    std::unique_ptr<HttpConnection> connection;
+    if (slot->connection != nullptr && slot->origin == origin) {
+        connection = std::move(slot->connection);
+    } else if (slot->connection != nullptr) {
+        statistics_.evicted++;
+        evicted = std::move(slot->connection);
+    }
+    slot->origin = origin;
+    int connect_id = slot->connect_id;
+    lock.unlock();
+
+    if (evicted != nullptr) {
+        evicted->Close();
+        evicted.reset();
+    }
+    if (!keep_alive) {
+        auto http = Board::GetInstance().GetNetwork()->CreateHttp(connect_id);
+        return PooledHttp(this, index, origin, nullptr, std::move(http));
+    }
+    if (connection == nullptr) {
+        std::unique_ptr<HttpTransport> transport;
+        if (tls) {
+            transport = std::make_unique<TlsTransport>();
+        } else {
+            transport = std::make_unique<TcpTransport>();
+        }
+        connection = std::make_unique<HttpConnection>(std::move(transport), host, port);
+    }
+    return PooledHttp(this, index, origin, std::move(connection), nullptr);
+}
+
+void HttpPool::Release(int slot, std::unique_ptr<HttpConnection>&& connection, bool not_kept) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& it = slots_[slot];
+        it.busy = false;
+        if (not_kept) {
+            statistics_.not_kept++;
+        }
+        if (connection != nullptr) {
+            it.connection = std::move(connection);
+            it.idle_since_us = esp_timer_get_time();
+            if (!idle_timer_running_) {
+                idle_timer_running_ = true;
+                esp_timer_start_periodic(idle_timer_, HTTP_POOL_IDLE_TIMEOUT_US / 2);
+            }
+        } else {
+            it.origin.clear();
+        }
+    }
+    condition_.notify_one();
+}
+
+void HttpPool::CountOpen(bool kept, bool reused) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (reused) {
+        statistics_.reused++;
+    } else if (kept) {
+        statistics_.reconnects++;
+    } else {
+        statistics_.created++;
+    }
+}
+
+void HttpPool::CloseExpired() {
+    std::vector<std::unique_ptr<HttpConnection>> expired;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        int64_t now = esp_timer_get_time();
+        bool idle = false;
+        for (auto& it : slots_) {
+            if (it.busy || it.connection == nullptr) {
+                continue;
+            }
+            if (now - it.idle_since_us >= HTTP_POOL_IDLE_TIMEOUT_US) {
+                ESP_LOGI(TAG, "Closing idle connection to %s", it.origin.c_str());
+                expired.push_back(std::move(it.connection));
+                it.origin.clear();
+                statistics_.expired++;
+            } else {
+                idle = true;
+            }
+        }
+        if (!idle) {
+            esp_timer_stop(idle_timer_);
+            idle_timer_running_ = false;
+        }
+    }
+    for (auto& connection : expired) {
+        connection->Close();
+    }
+}
+
+HttpPoolStatistics HttpPool::statistics() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return statistics_;
+}
+
+void HttpPool::ResetStatistics() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    statistics_ = HttpPoolStatistics();
+}
@@ -0,0 +1,127 @@
+#ifndef HTTP_POOL_H
+#define HTTP_POOL_H
+
+#include <http.h>
+#include <esp_timer.h>
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+#include "http_connection.h"
+
+struct HttpPoolStatistics {
+    uint32_t created = 0;       // Requests that had to open a new connection
+    uint32_t reused = 0;        // Requests sent over a connection kept from an earlier request
+    uint32_t reconnects = 0;    // Kept connections the server had closed meanwhile, opened again
+    uint32_t not_kept = 0;      // Responses that asked to close the connection or were not read to the end
+    uint32_t evicted = 0;       // Idle connections closed to make room for another host
+    uint32_t expired = 0;       // Idle connections closed after the idle timeout
+    uint32_t timeouts = 0;      // Acquire() calls that found no free slot in time
+};
+
+class HttpPool;
+
+/*
+ * One pooled HTTP request, borrowed from the HttpPool.
+ *
+ * Set the headers and content, Open(), read the response and Release(). Headers and content only
+ * apply to this request, whatever the connection carried before. The connection goes back to the
+ * pool only if the server allows it and the body was read to the end, anything else closes it,
+ * as does a PooledHttp destroyed without Release(), e.g. after an exception.
+ */
+class PooledHttp {
+public:
+    PooledHttp() = default;
+    PooledHttp(PooledHttp&& other);
+    PooledHttp(const PooledHttp&) = delete;
+    PooledHttp& operator=(const PooledHttp&) = delete;
+    ~PooledHttp();
+
+    explicit operator bool() const { return pool_ != nullptr; }
+
+    void SetHeader(const std::string& key, const std::string& value);
+    void SetContent(std::string&& content);
+    bool Open(const std::string& method, const std::string& url);
+    int GetStatusCode();
+    std::string ReadAll();
+    void Release();
+
+private:
+    friend class HttpPool;
+
+    HttpPool* pool_ = nullptr;
+    int slot_ = -1;
+    std::string origin_;
+    // Keep-alive connection where the firmware owns the TCP/IP stack
+    std::unique_ptr<HttpConnection> connection_;
+    // One-off client of the network component otherwise
+    std::unique_ptr<Http> http_;
+
+    PooledHttp(HttpPool* pool, int slot, const std::string& origin, std::unique_ptr<HttpConnection>&& connection,
+        std::unique_ptr<Http>&& http);
+};
+
+/*
+ * Keep-alive pool for short REST calls.
+ *
+ * Holds a small fixed number of slots, which is also the limit of concurrent pooled requests. On
+ * Wi-Fi the requests go through HttpConnection over lwIP sockets and esp-tls: a connection whose
+ * response allowed it stays open in its slot, and the next request to the same
+ * scheme://host:port is sent over it, skipping the TCP and TLS setup. Idle connections are closed
+ * after CONFIG_HTTP_POOL_IDLE_TIMEOUT_SECONDS, or earlier when a request to another host needs
+ * their slot.
+ *
+ * The 4G modules run TCP and TLS in the modem, reached only through the network component, so
+ * there every request gets a fresh Http on the connect id of its slot and nothing is kept.
+ *
+ * Opt in for requests with a small response read to the end. Large downloads and uploads should
+ * keep using their own Http.
+ */
+class HttpPool {
+public:
+    static HttpPool& GetInstance() {
+        static HttpPool instance;
+        return instance;
+    }
+    // Delete copy constructor and assignment operator
+    HttpPool(const HttpPool&) = delete;
+    HttpPool& operator=(const HttpPool&) = delete;
+
+    // Waits for a free slot, returns an empty PooledHttp if none became free in time or the URL is invalid
+    PooledHttp Acquire(const std::string& url);
+
+    HttpPoolStatistics statistics();
+    void ResetStatistics();
+
+private:
+    HttpPool();
+    ~HttpPool();
+
+    friend class PooledHttp;
+
+    struct Slot {
+        int connect_id;
+        bool busy = false;
+        std::string origin;             // Where the idle connection goes, empty if none
+        std::unique_ptr<HttpConnection> connection;
+        int64_t idle_since_us = 0;
+    };
+
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    std::vector<Slot> slots_;
+    esp_timer_handle_t idle_timer_ = nullptr;
+    bool idle_timer_running_ = false;
+    HttpPoolStatistics statistics_;
+
+    // A null connection leaves the slot empty, not_kept counts a response that did not allow keeping it
+    void Release(int slot, std::unique_ptr<HttpConnection>&& connection, bool not_kept);
+    void CountOpen(bool kept, bool reused);
+    void CloseExpired();
+};
+
+#endif // HTTP_POOL_H
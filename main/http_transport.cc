@@ -0,0 +1,103 @@
+#include "http_transport.h"
+
+#include <esp_log.h>
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+#define TAG "HttpTransport"
+
+TcpTransport::~TcpTransport() {
+    Close();
+}
+
+int TcpTransport::OpenSocket(const std::string& host, int port, int timeout_ms) {
+    struct addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* result = nullptr;
+    std::string service = std::to_string(port);
+    int ret = getaddrinfo(host.c_str(), service.c_str(), &hints, &result);
+    if (ret != 0 || result == nullptr) {
+        ESP_LOGE(TAG, "Failed to resolve %s: %d", host.c_str(), ret);
+        return -1;
+    }
+
+    struct timeval timeout = {
+        .tv_sec = timeout_ms / 1000,
+        .tv_usec = (timeout_ms % 1000) * 1000,
+    };
+    int fd = -1;
+    for (auto it = result; it != nullptr; it = it->ai_next) {
+        fd = socket(it->ai_family, it->ai_socktype, it->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        if (connect(fd, it->ai_addr, it->ai_addrlen) == 0) {
+            break;
+        }
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(result);
+    if (fd < 0) {
+        ESP_LOGE(TAG, "Failed to connect to %s:%d, errno %d", host.c_str(), port, errno);
+    }
+    return fd;
+}
+
+bool TcpTransport::IsSocketIdleAlive(int fd) {
+    char byte;
+    int ret = recv(fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (ret < 0) {
+        // Nothing to read is what an idle connection looks like
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+    // 0 is the peer closing, data is a response nobody asked for, e.g. a TLS close_notify
+    return false;
+}
+
+bool TcpTransport::Connect(const std::string& host, int port, int timeout_ms) {
+    Close();
+    fd_ = OpenSocket(host, port, timeout_ms);
+    return fd_ >= 0;
+}
+
+bool TcpTransport::Send(const char* data, size_t size) {
+    while (size > 0) {
+        int ret = send(fd_, data, size, 0);
+        if (ret <= 0) {
+            ESP_LOGE(TAG, "Failed to send, errno %d", errno);
+            return false;
+        }
+        data += ret;
+        size -= ret;
+    }
+    return true;
+}
+
+int TcpTransport::Receive(char* buffer, size_t size) {
+    int ret = recv(fd_, buffer, size, 0);
+    if (ret < 0) {
+        ESP_LOGE(TAG, "Failed to receive, errno %d", errno);
+        return -1;
+    }
+    return ret;
+}
+
+void TcpTransport::Close() {
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+}
+
+bool TcpTransport::IsIdleAlive() {
+    return fd_ >= 0 && IsSocketIdleAlive(fd_);
+}
@@ -0,0 +1,50 @@
+#ifndef HTTP_TRANSPORT_H
+#define HTTP_TRANSPORT_H
+
+#include <string>
+#include <cstddef>
+
+/*
+ * Byte stream under an HttpConnection, a plain TCP socket or a TLS session on top of one.
+ *
+ * Connect() blocks until the connection is up or timeout_ms passed, Send() and Receive() use the
+ * same timeout. A transport can be connected again after Close().
+ */
+class HttpTransport {
+public:
+    virtual ~HttpTransport() = default;
+
+    virtual bool Connect(const std::string& host, int port, int timeout_ms) = 0;
+    // Returns false unless every byte was sent
+    virtual bool Send(const char* data, size_t size) = 0;
+    // Returns the number of bytes received, 0 when the peer closed the connection, -1 on error
+    virtual int Receive(char* buffer, size_t size) = 0;
+    virtual void Close() = 0;
+    virtual bool connected() const = 0;
+    // False if the peer closed the idle connection or sent something unexpected meanwhile
+    virtual bool IsIdleAlive() = 0;
+};
+
+/* Plain TCP over the socket API, lwIP on the device and POSIX on the host */
+class TcpTransport : public HttpTransport {
+public:
+    TcpTransport() = default;
+    ~TcpTransport();
+
+    bool Connect(const std::string& host, int port, int timeout_ms) override;
+    bool Send(const char* data, size_t size) override;
+    int Receive(char* buffer, size_t size) override;
+    void Close() override;
+    bool connected() const override { return fd_ >= 0; }
+    bool IsIdleAlive() override;
+
+    // Opens a socket to host:port with send and receive timeouts, returns -1 on failure
+    static int OpenSocket(const std::string& host, int port, int timeout_ms);
+    // Peeks at an idle socket without blocking, false if it was closed or has unread data
+    static bool IsSocketIdleAlive(int fd);
+
+private:
+    int fd_ = -1;
+};
+
+#endif // HTTP_TRANSPORT_H
@@ -0,0 +1,51 @@
+#include "latency_histogram.h"
+
+#include <algorithm>
+#include <iterator>
+
+int LatencyHistogram::BucketIndex(uint32_t us) {
+    if (us < 64) {
+        return us >> 4;
+    }
+    int octave = 31 - __builtin_clz(us);
+    int index = 4 + (octave - 6) * 4 + ((us >> (octave - 2)) & 3);
+    return std::min(index, kBuckets - 1);
+}
+
+void LatencyHistogram::Add(uint32_t us) {
+    buckets_[BucketIndex(us)]++;
+    count_++;
+    max_ = std::max(max_, us);
+}
+
+void LatencyHistogram::Reset() {
+    std::fill(std::begin(buckets_), std::end(buckets_), 0);
+    count_ = 0;
+    max_ = 0;
+}
+
+uint32_t LatencyHistogram::Percentile(int percent) const {
+    if (count_ == 0) {
+        return 0;
+    }
+    uint32_t rank = ((uint64_t)count_ * percent + 99) / 100;
+    uint32_t seen = 0;
+    for (int i = 0; i < kBuckets; i++) {
+        seen += buckets_[i];
+        if (seen < rank || buckets_[i] == 0) {
+            continue;
+        }
+        // Report the middle of the bucket, but never more than the largest value seen
+        uint32_t lower, width;
+        if (i < 4) {
+            lower = i * 16;
+            width = 16;
+        } else {
+            int octave = (i - 4) / 4 + 6;
+            width = 1u << (octave - 2);
+            lower = (1u << octave) + ((i - 4) % 4) * width;
+        }
+        return std::min(lower + width / 2, max_);
+    }
+    return max_;
+}
@@ -0,0 +1,28 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <cstdint>
+
+/*
+ * Log-linear histogram of microsecond durations: 4 buckets per power of two from 64 us up to
+ * ~8 s, so a percentile is off by at most an eighth of its value and the memory stays fixed.
+ */
+class LatencyHistogram {
+public:
+    void Add(uint32_t us);
+    void Reset();
+    uint32_t Percentile(int percent) const;
+    inline uint32_t count() const { return count_; }
+    inline uint32_t max() const { return max_; }
+
+private:
+    static constexpr int kBuckets = 4 + 4 * 17;
+
+    uint32_t buckets_[kBuckets] = {};
+    uint32_t count_ = 0;
+    uint32_t max_ = 0;
+
+    static int BucketIndex(uint32_t us);
+};
+
+#endif // LATENCY_HISTOGRAM_H
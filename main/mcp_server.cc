@@ -18,6 +18,9 @@
 #include "oled_display.h"
 #include "board.h"
 #include "settings.h"
+#include "network_metrics.h"
+#include "http_pool.h"
+#include "tls_session_cache.h"
 #include "lvgl_theme.h"
 #include "lvgl_display.h"
 
@@ -151,6 +154,112 @@ void McpServer::AddUserOnlyTools() {
             return true;
         });
 
+    AddUserOnlyTool("self.audio.get_latency_stats",
+        "Get the per-stage audio latency percentiles (microseconds) from capture to send and from receive to playback, the uplink encoder settings and the send scheduler counters",
+        PropertyList({
+            Property("reset", kPropertyTypeBoolean, false)
+        }),
+        [](const PropertyList& properties) -> ReturnValue {
+            auto& tracker = Application::GetInstance().GetAudioService().GetLatencyTracker();
+            cJSON* root = cJSON_CreateObject();
+            for (int i = 0; i < kLatencyStageCount; i++) {
+                auto stage = static_cast<AudioLatencyStage>(i);
+                auto stats = tracker.GetStatistics(stage);
+                cJSON* item = cJSON_CreateObject();
+                cJSON_AddNumberToObject(item, "count", stats.count);
+                cJSON_AddNumberToObject(item, "p50_us", stats.p50_us);
+                cJSON_AddNumberToObject(item, "p95_us", stats.p95_us);
+                cJSON_AddNumberToObject(item, "p99_us", stats.p99_us);
+                cJSON_AddNumberToObject(item, "max_us", stats.max_us);
+                cJSON_AddItemToObject(root, AudioLatencyTracker::StageName(stage), item);
+            }
+#if CONFIG_OPUS_ADAPTIVE_ENCODER
+            auto encoder = Application::GetInstance().GetAudioService().GetEncoderControllerStatistics();
+            cJSON* item = cJSON_CreateObject();
+            cJSON_AddNumberToObject(item, "bitrate", encoder.bitrate);
+            cJSON_AddNumberToObject(item, "complexity", encoder.complexity);
+            cJSON_AddNumberToObject(item, "bitrate_decreases", encoder.bitrate_decreases);
+            cJSON_AddNumberToObject(item, "bitrate_increases", encoder.bitrate_increases);
+            cJSON_AddNumberToObject(item, "complexity_decreases", encoder.complexity_decreases);
+            cJSON_AddNumberToObject(item, "complexity_increases", encoder.complexity_increases);
+            cJSON_AddNumberToObject(item, "send_failures", encoder.send_failures);
+            cJSON_AddNumberToObject(item, "queue_peak_ms", encoder.queue_peak_ms);
+            cJSON_AddNumberToObject(item, "encode_load", encoder.encode_load);
+            cJSON_AddItemToObject(root, "encoder", item);
+#endif
+            auto send = Application::GetInstance().GetAudioSendStatistics();
+            cJSON* send_item = cJSON_CreateObject();
+            cJSON_AddNumberToObject(send_item, "sent", send.sent);
+            cJSON_AddNumberToObject(send_item, "writes", send.writes);
+            cJSON_AddNumberToObject(send_item, "expired", send.expired);
+            cJSON_AddNumberToObject(send_item, "overflowed", send.overflowed);
+            cJSON_AddNumberToObject(send_item, "failures", send.failures);
+            cJSON_AddNumberToObject(send_item, "abandoned", send.abandoned);
+            cJSON_AddNumberToObject(send_item, "held", send.held);
+            cJSON_AddItemToObject(root, "send", send_item);
+            if (properties["reset"].value<bool>()) {
+                tracker.Reset();
+            }
+            return root;
+        });
+
+    AddUserOnlyTool("self.network.get_connection_stats",
+        "Get how long opening HTTPS / WSS connections takes per host (microseconds), mostly the TLS handshake, "
+        "how often the HTTP keep-alive pool reused a connection and how often a saved TLS session was offered",
+        PropertyList({
+            Property("reset", kPropertyTypeBoolean, false)
+        }),
+        [](const PropertyList& properties) -> ReturnValue {
+            auto& metrics = NetworkMetrics::GetInstance();
+            auto& pool = HttpPool::GetInstance();
+            auto& sessions = TlsSessionCache::GetInstance();
+            cJSON* root = cJSON_CreateObject();
+            cJSON* hosts = cJSON_CreateArray();
+            for (auto& stats : metrics.GetStatistics()) {
+                cJSON* item = cJSON_CreateObject();
+                cJSON_AddStringToObject(item, "host", stats.host.c_str());
+                cJSON_AddBoolToObject(item, "tls", stats.tls);
+                cJSON_AddNumberToObject(item, "connects", stats.connects);
+                cJSON_AddNumberToObject(item, "failures", stats.failures);
+                cJSON_AddNumberToObject(item, "p50_us", stats.p50_us);
+                cJSON_AddNumberToObject(item, "p95_us", stats.p95_us);
+                cJSON_AddNumberToObject(item, "max_us", stats.max_us);
+                cJSON_AddNumberToObject(item, "reused", stats.reused);
+                cJSON_AddNumberToObject(item, "reused_p50_us", stats.reused_p50_us);
+                cJSON_AddItemToArray(hosts, item);
+            }
+            cJSON_AddItemToObject(root, "hosts", hosts);
+
+            auto pool_stats = pool.statistics();
+            cJSON* pool_json = cJSON_CreateObject();
+            cJSON_AddNumberToObject(pool_json, "created", pool_stats.created);
+            cJSON_AddNumberToObject(pool_json, "reused", pool_stats.reused);
+            cJSON_AddNumberToObject(pool_json, "reconnects", pool_stats.reconnects);
+            cJSON_AddNumberToObject(pool_json, "not_kept", pool_stats.not_kept);
+            cJSON_AddNumberToObject(pool_json, "evicted", pool_stats.evicted);
+            cJSON_AddNumberToObject(pool_json, "expired", pool_stats.expired);
+            cJSON_AddNumberToObject(pool_json, "timeouts", pool_stats.timeouts);
+            cJSON_AddItemToObject(root, "pool", pool_json);
+
+            auto session_stats = sessions.statistics();
+            cJSON* sessions_json = cJSON_CreateObject();
+            cJSON_AddNumberToObject(sessions_json, "handshakes", session_stats.handshakes);
+            cJSON_AddNumberToObject(sessions_json, "failures", session_stats.failures);
+            cJSON_AddNumberToObject(sessions_json, "offered", session_stats.offered);
+            cJSON_AddNumberToObject(sessions_json, "stored", session_stats.stored);
+            cJSON_AddNumberToObject(sessions_json, "evicted", session_stats.evicted);
+            cJSON_AddNumberToObject(sessions_json, "full_p50_us", session_stats.full_p50_us);
+            cJSON_AddNumberToObject(sessions_json, "resumed_p50_us", session_stats.resumed_p50_us);
+            cJSON_AddItemToObject(root, "tls_sessions", sessions_json);
+
+            if (properties["reset"].value<bool>()) {
+                metrics.Reset();
+                pool.ResetStatistics();
+                sessions.Reset();
+            }
+            return root;
+        });
+
     // Firmware upgrade
     AddUserOnlyTool("self.upgrade_firmware", "Upgrade firmware from a specific URL. This will download and install the firmware, then reboot the device.",
         PropertyList({
@@ -213,7 +322,7 @@ void McpServer::AddUserOnlyTools() {
                 
                 auto http = Board::GetInstance().GetNetwork()->CreateHttp(3);
                 http->SetHeader("Content-Type", "multipart/form-data; boundary=" + boundary);
-                if (!http->Open("POST", url)) {
+                if (!NetworkMetrics::GetInstance().OpenHttp(*http, "POST", url)) {
                     throw std::runtime_error("Failed to open URL: " + url);
                 }
                 {
@@ -254,7 +363,7 @@ void McpServer::AddUserOnlyTools() {
                 auto url = properties["url"].value<std::string>();
                 auto http = Board::GetInstance().GetNetwork()->CreateHttp(3);
 
-                if (!http->Open("GET", url)) {
+                if (!NetworkMetrics::GetInstance().OpenHttp(*http, "GET", url)) {
                     throw std::runtime_error("Failed to open URL: " + url);
                 }
                 int status_code = http->GetStatusCode();
@@ -397,16 +506,19 @@ void McpServer::AddUserOnlyTools() {
         "Kiểm tra trạng thái Cloudflare MCP Worker.",
         PropertyList(),
         [](const PropertyList&) -> ReturnValue {
-            auto& board = Board::GetInstance();
-            auto http = board.GetNetwork()->CreateHttp(5);
-            http->SetHeader("Accept", "application/json");
-            if (!http->Open("GET", "https://ai.micsoftvn.workers.dev/health")) {
+            const std::string url = "https://ai.micsoftvn.workers.dev/health";
+            auto http = HttpPool::GetInstance().Acquire(url);
+            if (!http) {
+                throw std::runtime_error("No free connection for MCP worker health endpoint");
+            }
+            http.SetHeader("Accept", "application/json");
+            if (!http.Open("GET", url)) {
                 throw std::runtime_error("Failed to open MCP worker health endpoint");
             }
 
-            int status_code = http->GetStatusCode();
-            std::string body = http->ReadAll();
-            http->Close();
+            int status_code = http.GetStatusCode();
+            std::string body = http.ReadAll();
+            http.Release();
 
             if (status_code != 200) {
                 throw std::runtime_error("MCP worker health returned status " + std::to_string(status_code));
@@ -422,14 +534,11 @@ void McpServer::AddUserOnlyTools() {
         PropertyList({ Property("limit", kPropertyTypeInteger, 5, 1, 10) }),
         [](const PropertyList& properties) -> ReturnValue {
             int limit = properties["limit"].value<int>();
-            auto& board = Board::GetInstance();
-            auto http = board.GetNetwork()->CreateHttp(5);
-            http->SetHeader("Content-Type", "application/json");
-            http->SetHeader("Accept", "application/json");
-            if (!http->Open("POST", "https://ai.micsoftvn.workers.dev/mcp")) {
-                throw std::runtime_error("Failed to open MCP worker news endpoint");
+            const std::string url = "https://ai.micsoftvn.workers.dev/mcp";
+            auto http = HttpPool::GetInstance().Acquire(url);
+            if (!http) {
+                throw std::runtime_error("No free connection for MCP worker news endpoint");
             }
-
             cJSON* payload = cJSON_CreateObject();
             cJSON_AddStringToObject(payload, "tool", "vn_news");
             cJSON* input = cJSON_CreateObject();
@@ -437,14 +546,20 @@ void McpServer::AddUserOnlyTools() {
             cJSON_AddItemToObject(payload, "input", input);
 
             char* payload_str = cJSON_PrintUnformatted(payload);
-            http->Write(payload_str, strlen(payload_str));
-            http->Write("", 0);
+            std::string content(payload_str);
             cJSON_free(payload_str);
             cJSON_Delete(payload);
 
-            int status_code = http->GetStatusCode();
-            std::string body = http->ReadAll();
-            http->Close();
+            http.SetHeader("Content-Type", "application/json");
+            http.SetHeader("Accept", "application/json");
+            http.SetContent(std::move(content));
+            if (!http.Open("POST", url)) {
+                throw std::runtime_error("Failed to open MCP worker news endpoint");
+            }
+
+            int status_code = http.GetStatusCode();
+            std::string body = http.ReadAll();
+            http.Release();
 
             if (status_code != 200) {
                 throw std::runtime_error("MCP worker news returned status " + std::to_string(status_code));
@@ -482,22 +597,23 @@ void McpServer::AddUserOnlyTools() {
         "Fetch the latest headlines from VNExpress RSS feed.",
         PropertyList({ Property("limit", kPropertyTypeInteger, 5, 1, 20) }),
         [](const PropertyList& properties) -> ReturnValue {
-            auto& board = Board::GetInstance();
             int limit = properties["limit"].value<int>();
-            auto http = board.GetNetwork()->CreateHttp(5);
             const std::string url = "https://vnexpress.net/rss/tin-moi-nhat.rss";
-            http->SetHeader("User-Agent", "Mozilla/5.0 (X11; Linux x86_64)");
-            http->SetHeader("Accept", "application/rss+xml, application/xml;q=0.9, */*;q=0.8");
-            http->SetHeader("Accept-Encoding", "identity");
-            http->SetHeader("Connection", "close");
-            if (!http->Open("GET", url)) {
+            auto http = HttpPool::GetInstance().Acquire(url);
+            if (!http) {
+                throw std::runtime_error("No free connection for " + url);
+            }
+            http.SetHeader("User-Agent", "Mozilla/5.0 (X11; Linux x86_64)");
+            http.SetHeader("Accept", "application/rss+xml, application/xml;q=0.9, */*;q=0.8");
+            http.SetHeader("Accept-Encoding", "identity");
+            if (!http.Open("GET", url)) {
                 throw std::runtime_error("Failed to open URL: " + url);
             }
-            if (http->GetStatusCode() != 200) {
-                throw std::runtime_error("Unexpected status code: " + std::to_string(http->GetStatusCode()));
+            if (http.GetStatusCode() != 200) {
+                throw std::runtime_error("Unexpected status code: " + std::to_string(http.GetStatusCode()));
             }
-            std::string body = http->ReadAll();
-            http->Close();
+            std::string body = http.ReadAll();
+            http.Release();
 
             auto strip_cdata = [](std::string text) {
                 const std::string begin = "<![CDATA[";
@@ -596,22 +712,22 @@ void McpServer::AddUserOnlyTools() {
 
             auto query = properties["query"].value<std::string>();
             int limit = properties["limit"].value<int>();
-
-            auto& board = Board::GetInstance();
-            auto http = board.GetNetwork()->CreateHttp(5);
             std::string url = "https://api.duckduckgo.com/?q=" + url_encode(query) + "&format=json&no_html=1&skip_disambig=1";
-            http->SetHeader("User-Agent", "Mozilla/5.0 (X11; Linux x86_64)");
-            http->SetHeader("Accept", "application/json");
-            http->SetHeader("Accept-Encoding", "identity");
-            http->SetHeader("Connection", "close");
-            if (!http->Open("GET", url)) {
+            auto http = HttpPool::GetInstance().Acquire(url);
+            if (!http) {
+                throw std::runtime_error("No free connection for " + url);
+            }
+            http.SetHeader("User-Agent", "Mozilla/5.0 (X11; Linux x86_64)");
+            http.SetHeader("Accept", "application/json");
+            http.SetHeader("Accept-Encoding", "identity");
+            if (!http.Open("GET", url)) {
                 throw std::runtime_error("Failed to open DuckDuckGo API");
             }
-            if (http->GetStatusCode() != 200) {
-                throw std::runtime_error("DuckDuckGo API returned status " + std::to_string(http->GetStatusCode()));
+            if (http.GetStatusCode() != 200) {
+                throw std::runtime_error("DuckDuckGo API returned status " + std::to_string(http.GetStatusCode()));
             }
-            std::string body = http->ReadAll();
-            http->Close();
+            std::string body = http.ReadAll();
+            http.Release();
 
             cJSON* root = cJSON_Parse(body.c_str());
             if (!root) {
@@ -689,22 +805,23 @@ void McpServer::AddUserOnlyTools() {
         "Fetch the latest Vietcombank USD exchange rate (buy/transfer/sell).",
         PropertyList(),
         [](const PropertyList&) -> ReturnValue {
-            auto& board = Board::GetInstance();
-            auto http = board.GetNetwork()->CreateHttp(5);
             const std::string url = "https://portal.vietcombank.com.vn/Usercontrols/TVPortal.TyGia/pXML.aspx?b=10";
-            http->SetHeader("User-Agent", "Mozilla/5.0 (X11; Linux x86_64)");
-            http->SetHeader("Referer", "https://portal.vietcombank.com.vn/");
-            http->SetHeader("Accept", "application/xml, text/xml;q=0.9, */*;q=0.8");
-            http->SetHeader("Accept-Encoding", "identity");
-            http->SetHeader("Connection", "close");
-            if (!http->Open("GET", url)) {
+            auto http = HttpPool::GetInstance().Acquire(url);
+            if (!http) {
+                throw std::runtime_error("No free connection for " + url);
+            }
+            http.SetHeader("User-Agent", "Mozilla/5.0 (X11; Linux x86_64)");
+            http.SetHeader("Referer", "https://portal.vietcombank.com.vn/");
+            http.SetHeader("Accept", "application/xml, text/xml;q=0.9, */*;q=0.8");
+            http.SetHeader("Accept-Encoding", "identity");
+            if (!http.Open("GET", url)) {
                 throw std::runtime_error("Failed to open Vietcombank exchange rate API");
             }
-            if (http->GetStatusCode() != 200) {
-                throw std::runtime_error("Vietcombank API returned status " + std::to_string(http->GetStatusCode()));
+            if (http.GetStatusCode() != 200) {
+                throw std::runtime_error("Vietcombank API returned status " + std::to_string(http.GetStatusCode()));
             }
-            std::string body = http->ReadAll();
-            http->Close();
+            std::string body = http.ReadAll();
+            http.Release();
 
             auto find_between = [](const std::string& text, const std::string& begin, const std::string& end) -> std::string {
                 size_t start = text.find(begin);
@@ -789,7 +906,6 @@ void McpServer::AddUserOnlyTools() {
             Property("api_key", kPropertyTypeString, "")
         }),
         [](const PropertyList& properties) -> ReturnValue {
-            auto& board = Board::GetInstance();
             auto cve_id = properties["cve_id"].value<std::string>();
             auto api_key = properties["api_key"].value<std::string>();
 
@@ -811,23 +927,25 @@ void McpServer::AddUserOnlyTools() {
                 return encoded;
             };
 
-            auto http = board.GetNetwork()->CreateHttp(5);
             std::string url = "https://services.nvd.nist.gov/rest/json/cves/2.0?cveId=" + url_encode(cve_id);
-            http->SetHeader("User-Agent", "Mozilla/5.0 (X11; Linux x86_64)");
-            http->SetHeader("Accept", "application/json");
-            http->SetHeader("Accept-Encoding", "identity");
-            http->SetHeader("Connection", "close");
+            auto http = HttpPool::GetInstance().Acquire(url);
+            if (!http) {
+                throw std::runtime_error("No free connection for " + url);
+            }
+            http.SetHeader("User-Agent", "Mozilla/5.0 (X11; Linux x86_64)");
+            http.SetHeader("Accept", "application/json");
+            http.SetHeader("Accept-Encoding", "identity");
             if (!api_key.empty()) {
-                http->SetHeader("apiKey", api_key);
+                http.SetHeader("apiKey", api_key);
             }
-            if (!http->Open("GET", url)) {
+            if (!http.Open("GET", url)) {
                 throw std::runtime_error("Failed to open NVD API");
             }
-            if (http->GetStatusCode() != 200) {
-                throw std::runtime_error("NVD API returned status " + std::to_string(http->GetStatusCode()));
+            if (http.GetStatusCode() != 200) {
+                throw std::runtime_error("NVD API returned status " + std::to_string(http.GetStatusCode()));
             }
-            std::string body = http->ReadAll();
-            http->Close();
+            std::string body = http.ReadAll();
+            http.Release();
 
             cJSON* root = cJSON_Parse(body.c_str());
             if (!root) {
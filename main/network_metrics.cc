@@ -0,0 +1,97 @@
+#include "network_metrics.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+
+#define TAG "NetworkMetrics"
+
+#define MAX_TRACKED_HOSTS 8
+
+static void ParseUrl(const std::string& url, std::string& host, bool& tls) {
+    size_t start = url.find("://");
+    std::string scheme = start == std::string::npos ? "" : url.substr(0, start);
+    tls = scheme == "https" || scheme == "wss";
+    start = start == std::string::npos ? 0 : start + 3;
+    size_t end = url.find_first_of("/?#", start);
+    host = url.substr(start, end == std::string::npos ? std::string::npos : end - start);
+}
+
+bool NetworkMetrics::OpenHttp(Http& http, const std::string& method, const std::string& url, bool reused) {
+    int64_t start = esp_timer_get_time();
+    bool success = http.Open(method, url);
+    Record(url, success, esp_timer_get_time() - start, reused);
+    return success;
+}
+
+bool NetworkMetrics::ConnectWebSocket(WebSocket& websocket, const std::string& url) {
+    int64_t start = esp_timer_get_time();
+    bool success = websocket.Connect(url.c_str());
+    Record(url, success, esp_timer_get_time() - start);
+    return success;
+}
+
+void NetworkMetrics::Record(const std::string& url, bool success, uint32_t duration_us, bool reused) {
+    std::string host;
+    bool tls;
+    ParseUrl(url, host, tls);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    HostEntry* entry = nullptr;
+    for (auto& it : hosts_) {
+        if (it.host == host) {
+            entry = &it;
+            break;
+        }
+    }
+    if (entry == nullptr) {
+        if (hosts_.size() < MAX_TRACKED_HOSTS) {
+            hosts_.emplace_back();
+            entry = &hosts_.back();
+        } else {
+            entry = &hosts_[0];
+            for (auto& it : hosts_) {
+                if (it.last_used < entry->last_used) {
+                    entry = &it;
+                }
+            }
+        }
+        *entry = HostEntry{host, tls, 0, 0, 0, 0, LatencyHistogram(), LatencyHistogram()};
+    }
+
+    entry->last_used = ++use_counter_;
+    if (success && reused) {
+        entry->reused++;
+        entry->reused_histogram.Add(duration_us);
+    } else if (success) {
+        entry->connects++;
+        entry->histogram.Add(duration_us);
+    } else {
+        entry->failures++;
+    }
+    ESP_LOGD(TAG, "%s %s in %lu ms", host.c_str(), success ? (reused ? "reused" : "opened") : "failed", duration_us / 1000);
+}
+
+std::vector<HostConnectStatistics> NetworkMetrics::GetStatistics() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<HostConnectStatistics> result;
+    result.reserve(hosts_.size());
+    for (auto& entry : hosts_) {
+        HostConnectStatistics stats;
+        stats.host = entry.host;
+        stats.tls = entry.tls;
+        stats.connects = entry.connects;
+        stats.failures = entry.failures;
+        stats.p50_us = entry.histogram.Percentile(50);
+        stats.p95_us = entry.histogram.Percentile(95);
+        stats.max_us = entry.histogram.max();
+        stats.reused = entry.reused;
+        stats.reused_p50_us = entry.reused_histogram.Percentile(50);
+        result.push_back(stats);
+    }
+    return result;
+}
+
+void NetworkMetrics::Reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    hosts_.clear();
+}
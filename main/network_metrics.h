@@ -0,0 +1,73 @@
+#ifndef NETWORK_METRICS_H
+#define NETWORK_METRICS_H
+
+#include <http.h>
+#include <web_socket.h>
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+
+#include "latency_histogram.h"
+
+struct HostConnectStatistics {
+    std::string host;           // host[:port]
+    bool tls = false;
+    uint32_t connects = 0;
+    uint32_t failures = 0;
+    uint32_t p50_us = 0;
+    uint32_t p95_us = 0;
+    uint32_t max_us = 0;
+    uint32_t reused = 0;        // Opens on a connection kept alive from an earlier request
+    uint32_t reused_p50_us = 0;
+};
+
+/*
+ * Process-wide record of how long opening a connection takes, per host. For HTTPS and WSS that is
+ * dominated by the TLS handshake, which the network component runs from scratch for every client.
+ * Http::Open() also sends the request and reads the response headers, so its figure includes the
+ * server's time to first byte.
+ *
+ * Every HTTP / WebSocket client in the firmware opens through here. Opens on a connection that the
+ * HttpPool kept alive are counted apart, so the two medians show what reuse saves. The least
+ * recently used host is forgotten when the table is full.
+ */
+class NetworkMetrics {
+public:
+    static NetworkMetrics& GetInstance() {
+        static NetworkMetrics instance;
+        return instance;
+    }
+    // Delete copy constructor and assignment operator
+    NetworkMetrics(const NetworkMetrics&) = delete;
+    NetworkMetrics& operator=(const NetworkMetrics&) = delete;
+
+    bool OpenHttp(Http& http, const std::string& method, const std::string& url, bool reused = false);
+    bool ConnectWebSocket(WebSocket& websocket, const std::string& url);
+    // Counts a connection that was opened some other way
+    void Record(const std::string& url, bool success, uint32_t duration_us, bool reused = false);
+
+    std::vector<HostConnectStatistics> GetStatistics();
+    void Reset();
+
+private:
+    NetworkMetrics() = default;
+
+    struct HostEntry {
+        std::string host;
+        bool tls;
+        uint32_t connects;
+        uint32_t failures;
+        uint32_t last_used;
+        uint32_t reused;
+        LatencyHistogram histogram;
+        LatencyHistogram reused_histogram;
+    };
+
+    std::mutex mutex_;
+    std::vector<HostEntry> hosts_;
+    uint32_t use_counter_ = 0;
+};
+
+#endif // NETWORK_METRICS_H
@@ -1,6 +1,7 @@
 #include "ota.h"
 #include "system_info.h"
 #include "settings.h"
+#include "network_metrics.h"
 #include "assets/lang_config.h"
 
 #include <cJSON.h>
@@ -91,7 +92,7 @@ bool Ota::CheckVersion() {
     std::string method = data.length() > 0 ? "POST" : "GET";
     http->SetContent(std::move(data));
 
-    if (!http->Open(method, url)) {
+    if (!NetworkMetrics::GetInstance().OpenHttp(*http, method, url)) {
         ESP_LOGE(TAG, "Failed to open HTTP connection");
         return false;
     }
@@ -275,7 +276,7 @@ bool Ota::Upgrade(const std::string& firmware_url) {
 
     auto network = Board::GetInstance().GetNetwork();
     auto http = network->CreateHttp(0);
-    if (!http->Open("GET", firmware_url)) {
+    if (!NetworkMetrics::GetInstance().OpenHttp(*http, "GET", firmware_url)) {
         ESP_LOGE(TAG, "Failed to open HTTP connection");
         return false;
     }
@@ -458,7 +459,7 @@ esp_err_t Ota::Activate() {
     std::string data = GetActivationPayload();
     http->SetContent(std::move(data));
 
-    if (!http->Open("POST", url)) {
+    if (!NetworkMetrics::GetInstance().OpenHttp(*http, "POST", url)) {
         ESP_LOGE(TAG, "Failed to open HTTP connection");
         return ESP_FAIL;
     }
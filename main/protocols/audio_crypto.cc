@@ -0,0 +1,77 @@
+#include "audio_crypto.h"
+
+#include <esp_log.h>
+#include <cstring>
+
+#define TAG "AudioCrypto"
+
+AudioCrypto::AudioCrypto() {
+    mbedtls_aes_init(&aes_);
+}
+
+AudioCrypto::~AudioCrypto() {
+    mbedtls_aes_free(&aes_);
+}
+
+bool AudioCrypto::SetKey(const std::string& key, const std::string& nonce) {
+    ready_ = false;
+    if (key.size() != 16 || nonce.size() != AUDIO_CRYPTO_HEADER_SIZE) {
+        ESP_LOGE(TAG, "Invalid key / nonce size: %u / %u", key.size(), nonce.size());
+        return false;
+    }
+    int ret = mbedtls_aes_setkey_enc(&aes_, (const unsigned char*)key.data(), 128);
+    if (ret != 0) {
+        ESP_LOGE(TAG, "Failed to set key, ret: %d", ret);
+        return false;
+    }
+    memcpy(header_, nonce.data(), AUDIO_CRYPTO_HEADER_SIZE);
+    ready_ = true;
+    return true;
+}
+
+bool AudioCrypto::Encrypt(const uint8_t* data, size_t size, uint32_t timestamp, uint32_t sequence, uint8_t flags,
+    std::string& datagram) {
+    if (!ready_ || size > UINT16_MAX) {
+        return false;
+    }
+
+    // mbedtls advances the counter block, so it works on a copy of the header
+    uint8_t counter[AUDIO_CRYPTO_HEADER_SIZE];
+    memcpy(counter, header_, AUDIO_CRYPTO_HEADER_SIZE);
+    counter[1] |= flags;
+    counter[2] = size >> 8;
+    counter[3] = size & 0xFF;
+    WriteUint32(counter + 8, timestamp);
+    WriteUint32(counter + 12, sequence);
+
+    datagram.resize(AUDIO_CRYPTO_HEADER_SIZE + size);
+    auto output = (uint8_t*)datagram.data();
+    memcpy(output, counter, AUDIO_CRYPTO_HEADER_SIZE);
+
+    size_t nc_off = 0;
+    uint8_t stream_block[16];
+    int ret = mbedtls_aes_crypt_ctr(&aes_, size, &nc_off, counter, stream_block, data, output + AUDIO_CRYPTO_HEADER_SIZE);
+    if (ret != 0) {
+        ESP_LOGE(TAG, "Failed to encrypt audio data, ret: %d", ret);
+        return false;
+    }
+    return true;
+}
+
+bool AudioCrypto::Decrypt(const uint8_t* datagram, size_t size, uint8_t* output) {
+    if (!ready_ || size < AUDIO_CRYPTO_HEADER_SIZE) {
+        return false;
+    }
+
+    uint8_t counter[AUDIO_CRYPTO_HEADER_SIZE];
+    memcpy(counter, datagram, AUDIO_CRYPTO_HEADER_SIZE);
+    size_t nc_off = 0;
+    uint8_t stream_block[16];
+    int ret = mbedtls_aes_crypt_ctr(&aes_, size - AUDIO_CRYPTO_HEADER_SIZE, &nc_off, counter, stream_block,
+        datagram + AUDIO_CRYPTO_HEADER_SIZE, output);
+    if (ret != 0) {
+        ESP_LOGE(TAG, "Failed to decrypt audio data, ret: %d", ret);
+        return false;
+    }
+    return true;
+}
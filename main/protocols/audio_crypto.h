@@ -0,0 +1,61 @@
+#ifndef AUDIO_CRYPTO_H
+#define AUDIO_CRYPTO_H
+
+#include <mbedtls/aes.h>
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+#define AUDIO_CRYPTO_HEADER_SIZE 16
+#define AUDIO_CRYPTO_PACKET_TYPE 0x01
+
+/*
+ * AES-128-CTR for the MQTT + UDP audio datagrams:
+ * |type 1u|flags 1u|payload_len 2u|ssrc 4u|timestamp 4u|sequence 4u|payload payload_len|
+ * The 16-byte header doubles as the initial counter block.
+ *
+ * The key schedule is expanded once per session and the header kept preformatted from the server
+ * nonce, so a packet only costs patching a few header bytes on the stack and the cipher itself,
+ * written into a datagram buffer that keeps its storage. With CONFIG_MBEDTLS_HARDWARE_AES (the IDF
+ * default) mbedtls runs the cipher on the AES peripheral, in DMA mode for longer inputs on targets
+ * that have it.
+ *
+ * Encrypt() and Decrypt() may run on different tasks, they do not touch shared state besides the
+ * read-only key schedule.
+ */
+class AudioCrypto {
+public:
+    AudioCrypto();
+    ~AudioCrypto();
+
+    // Key and nonce as sent in the server hello, 16 bytes each
+    bool SetKey(const std::string& key, const std::string& nonce);
+    inline bool ready() const { return ready_; }
+
+    // Writes header and ciphertext into datagram, which keeps its capacity from packet to packet
+    bool Encrypt(const uint8_t* data, size_t size, uint32_t timestamp, uint32_t sequence, uint8_t flags,
+        std::string& datagram);
+    // Decrypts the payload of a datagram (header included) into output, which must hold size - 16 bytes
+    bool Decrypt(const uint8_t* datagram, size_t size, uint8_t* output);
+
+    static uint32_t ReadTimestamp(const uint8_t* header) { return ReadUint32(header + 8); }
+    static uint32_t ReadSequence(const uint8_t* header) { return ReadUint32(header + 12); }
+
+private:
+    mbedtls_aes_context aes_;
+    uint8_t header_[AUDIO_CRYPTO_HEADER_SIZE] = {0};
+    bool ready_ = false;
+
+    static uint32_t ReadUint32(const uint8_t* p) {
+        return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+    }
+    static void WriteUint32(uint8_t* p, uint32_t value) {
+        p[0] = value >> 24;
+        p[1] = value >> 16;
+        p[2] = value >> 8;
+        p[3] = value;
+    }
+};
+
+#endif // AUDIO_CRYPTO_H
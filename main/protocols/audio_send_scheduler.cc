@@ -0,0 +1,101 @@
+#include "audio_send_scheduler.h"
+
+#include <esp_log.h>
+#include <algorithm>
+
+#define TAG "AudioSendScheduler"
+
+AudioSendScheduler::AudioSendScheduler(AudioLatencyTracker& tracker, int deadline_ms, size_t max_pending, size_t max_batch, int max_retries,
+    int aggregation_budget_ms)
+    : tracker_(tracker), deadline_us_(deadline_ms * 1000), max_pending_(max_pending),
+      max_batch_(max_batch), max_retries_(max_retries), aggregation_budget_us_(aggregation_budget_ms * 1000) {
+    batch_.reserve(max_batch);
+}
+
+/* The frame after a dropped one carries the gap, like frames suppressed as silence */
+void AudioSendScheduler::DropOldest() {
+    uint32_t skipped = pending_.front().packet->skipped_frames + 1;
+    pending_.pop_front();
+    if (!pending_.empty()) {
+        pending_.front().packet->skipped_frames += skipped;
+    }
+    retries_ = 0;
+}
+
+void AudioSendScheduler::Push(std::unique_ptr<AudioStreamPacket>&& packet) {
+    uint32_t now = AudioLatencyTracker::Now();
+    uint32_t origin_us = packet->trace.origin_us != 0 ? packet->trace.origin_us : now;
+    pending_.push_back({std::move(packet), origin_us + deadline_us_, now});
+    if (pending_.size() > max_pending_) {
+        DropOldest();
+        statistics_.overflowed++;
+    }
+}
+
+void AudioSendScheduler::Clear() {
+    pending_.clear();
+    retries_ = 0;
+    holding_ = false;
+}
+
+int AudioSendScheduler::FlushDelayMs() const {
+    if (!holding_ || pending_.empty()) {
+        return -1;
+    }
+    int32_t remaining_us = aggregation_budget_us_ - (AudioLatencyTracker::Now() - pending_.front().queued_us);
+    return remaining_us > 0 ? (remaining_us + 999) / 1000 : 0;
+}
+
+bool AudioSendScheduler::Flush(Protocol& protocol) {
+    /* The oldest frames expire first, a late frame only delays the fresh ones behind it */
+    uint32_t now = AudioLatencyTracker::Now();
+    size_t expired = 0;
+    while (!pending_.empty() && (int32_t)(now - pending_.front().deadline_us) > 0) {
+        DropOldest();
+        expired++;
+    }
+    if (expired > 0) {
+        statistics_.expired += expired;
+        ESP_LOGW(TAG, "Dropped %u frames past their deadline", expired);
+    }
+
+    holding_ = false;
+    size_t frames_per_packet = std::min<size_t>(protocol.frames_per_packet(), max_batch_);
+    while (!pending_.empty()) {
+        size_t count = std::min(pending_.size(), max_batch_);
+        // Only whole aggregated packets go out until the oldest frame used up its budget
+        if (frames_per_packet > 1 && (int32_t)(now - pending_.front().queued_us) < (int32_t)aggregation_budget_us_) {
+            count -= count % frames_per_packet;
+            if (count == 0) {
+                holding_ = true;
+                statistics_.held++;
+                return true;
+            }
+        }
+        batch_.clear();
+        for (size_t i = 0; i < count; i++) {
+            batch_.push_back(pending_[i].packet.get());
+        }
+
+        size_t sent = protocol.SendAudioBatch(batch_.data(), count);
+        statistics_.writes++;
+        if (sent > 0) {
+            uint32_t sent_us = AudioLatencyTracker::Now();
+            for (size_t i = 0; i < sent; i++) {
+                tracker_.TraceUplink(pending_.front().packet->trace, sent_us);
+                pending_.pop_front();
+            }
+            statistics_.sent += sent;
+            retries_ = 0;
+        }
+        if (sent < count) {
+            statistics_.failures++;
+            if (++retries_ > max_retries_) {
+                DropOldest();
+                statistics_.abandoned++;
+            }
+            return false;
+        }
+    }
+    return true;
+}
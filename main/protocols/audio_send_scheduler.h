@@ -0,0 +1,72 @@
+#ifndef AUDIO_SEND_SCHEDULER_H
+#define AUDIO_SEND_SCHEDULER_H
+
+#include <deque>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include "protocol.h"
+#include "audio_latency.h"
+
+struct AudioSendStatistics {
+    uint32_t sent = 0;
+    uint32_t writes = 0;        // Transport writes, each carries one batch of frames
+    uint32_t expired = 0;       // Dropped because they missed their deadline
+    uint32_t overflowed = 0;    // Dropped oldest-first because too many were pending
+    uint32_t failures = 0;      // Failed writes, each is retried later
+    uint32_t abandoned = 0;     // Dropped after failing max_retries times
+    uint32_t held = 0;          // Flushes that held frames back to fill an aggregated packet
+};
+
+/*
+ * Sends the encoded uplink frames from the main loop.
+ *
+ * Every frame gets a deadline counted from its capture. Frames are sent oldest first in batches,
+ * so a transport that can pack several frames into one write gets them together. A failed write
+ * keeps the frames and is retried on the next flush, up to max_retries times before the oldest
+ * frame is given up on. Frames that missed their deadline, and the oldest ones beyond max_pending,
+ * are dropped before sending, so after a stall the server gets fresh audio instead of a backlog.
+ *
+ * When the transport packs several frames per packet, frames are held back until a whole packet
+ * is ready, but never longer than the aggregation budget.
+ *
+ * Only the main loop task touches it.
+ */
+class AudioSendScheduler {
+public:
+    AudioSendScheduler(AudioLatencyTracker& tracker, int deadline_ms, size_t max_pending, size_t max_batch, int max_retries,
+        int aggregation_budget_ms);
+
+    void Push(std::unique_ptr<AudioStreamPacket>&& packet);
+    // Returns false if a write failed and frames are left for a retry
+    bool Flush(Protocol& protocol);
+    void Clear();
+    bool Empty() const { return pending_.empty(); }
+    // Time until the frames held back for aggregation must be flushed, -1 if none are held
+    int FlushDelayMs() const;
+    const AudioSendStatistics& statistics() const { return statistics_; }
+
+private:
+    struct PendingPacket {
+        std::unique_ptr<AudioStreamPacket> packet;
+        uint32_t deadline_us;
+        uint32_t queued_us;
+    };
+
+    AudioLatencyTracker& tracker_;
+    uint32_t deadline_us_;
+    size_t max_pending_;
+    size_t max_batch_;
+    int max_retries_;
+    uint32_t aggregation_budget_us_;
+    bool holding_ = false;
+    int retries_ = 0;   // Failed writes of the current oldest frame
+    std::deque<PendingPacket> pending_;
+    std::vector<AudioStreamPacket*> batch_;
+    AudioSendStatistics statistics_;
+
+    void DropOldest();
+};
+
+#endif // AUDIO_SEND_SCHEDULER_H
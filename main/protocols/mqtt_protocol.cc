@@ -6,7 +6,6 @@
 #include <esp_log.h>
 #include <cstring>
 #include <exception>
-#include <arpa/inet.h>
 #include "assets/lang_config.h"
 
 #define TAG "MQTT"
@@ -194,30 +193,54 @@ bool MqttProtocol::SendText(const std::string& text) {
     return true;
 }
 
-bool MqttProtocol::SendAudio(std::unique_ptr<AudioStreamPacket> packet) {
+bool MqttProtocol::SendAudio(AudioStreamPacket& packet) {
     std::lock_guard<std::mutex> lock(channel_mutex_);
     if (udp_ == nullptr) {
         return false;
     }
 
-    std::string nonce(aes_nonce_);
-    *(uint16_t*)&nonce[2] = htons(packet->payload.size());
-    *(uint32_t*)&nonce[8] = htonl(packet->timestamp);
-    *(uint32_t*)&nonce[12] = htonl(++local_sequence_);
+    return SendDatagram(packet.opus_data(), packet.opus_size(), packet, 1);
+}
 
-    std::string encrypted;
-    encrypted.resize(aes_nonce_.size() + packet->payload.size());
-    memcpy(encrypted.data(), nonce.data(), nonce.size());
+size_t MqttProtocol::SendAudioBatch(AudioStreamPacket* const* packets, size_t count) {
+    if (frames_per_packet_ <= 1) {
+        return Protocol::SendAudioBatch(packets, count);
+    }
 
-    size_t nc_off = 0;
-    uint8_t stream_block[16] = {0};
-    if (mbedtls_aes_crypt_ctr(&aes_ctx_, packet->payload.size(), &nc_off, (uint8_t*)nonce.c_str(), stream_block,
-        (uint8_t*)packet->payload.data(), (uint8_t*)&encrypted[nonce.size()]) != 0) {
-        ESP_LOGE(TAG, "Failed to encrypt audio data");
-        return false;
+    std::lock_guard<std::mutex> lock(channel_mutex_);
+    if (udp_ == nullptr) {
+        return 0;
     }
+    size_t sent = 0;
+    while (sent < count) {
+        size_t frames = PackFrames(packets + sent, count - sent, 0);
+        bool success = frames == 1
+            ? SendDatagram(packets[sent]->opus_data(), packets[sent]->opus_size(), *packets[sent], 1)
+            : SendDatagram(aggregate_buffer_.data(), aggregate_buffer_.size(), *packets[sent], frames);
+        if (!success) {
+            break;
+        }
+        sent += frames;
+    }
+    return sent;
+}
 
-    return udp_->Send(encrypted) > 0;
+/*
+ * Sends frames that follow each other in one datagram, numbered by the first one. Suppressed silence
+ * before it leaves a gap in the sequence, so the server sees the discontinuity. The sequence only
+ * moves on once the datagram is out, a retry reuses it.
+ */
+bool MqttProtocol::SendDatagram(const uint8_t* data, size_t size, const AudioStreamPacket& first, size_t frames) {
+    uint32_t sequence = local_sequence_ + first.skipped_frames + 1;
+    uint8_t flags = frames > 1 ? UDP_FLAG_AGGREGATED_OPUS : 0;
+    if (!crypto_.Encrypt(data, size, first.timestamp, sequence, flags, datagram_)) {
+        return false;
+    }
+    if (udp_->Send(datagram_) <= 0) {
+        return false;
+    }
+    local_sequence_ = sequence + frames - 1;
+    return true;
 }
 
 void MqttProtocol::CloseAudioChannel() {
@@ -225,6 +248,9 @@ void MqttProtocol::CloseAudioChannel() {
         std::lock_guard<std::mutex> lock(channel_mutex_);
         udp_.reset();
     }
+    auto& stats = remote_window_.statistics();
+    ESP_LOGI(TAG, "Audio packets received: %lu, reordered: %lu, duplicated: %lu, too old: %lu, lost: %lu",
+        stats.received, stats.reordered, stats.duplicated, stats.too_old, stats.lost);
 
     std::string message = "{";
     message += "\"session_id\":\"" + session_id_ + "\",";
@@ -271,43 +297,47 @@ bool MqttProtocol::OpenAudioChannel() {
          * |type 1u|flags 1u|payload_len 2u|ssrc 4u|timestamp 4u|sequence 4u|
          * |payload payload_len|
          */
-        if (data.size() < sizeof(aes_nonce_)) {
+        auto datagram = (const uint8_t*)data.data();
+        if (data.size() < AUDIO_CRYPTO_HEADER_SIZE) {
             ESP_LOGE(TAG, "Invalid audio packet size: %u", data.size());
             return;
         }
-        if (data[0] != 0x01) {
-            ESP_LOGE(TAG, "Invalid audio packet type: %x", data[0]);
+        if (datagram[0] != AUDIO_CRYPTO_PACKET_TYPE) {
+            ESP_LOGE(TAG, "Invalid audio packet type: %x", datagram[0]);
             return;
         }
-        uint32_t timestamp = ntohl(*(uint32_t*)&data[8]);
-        uint32_t sequence = ntohl(*(uint32_t*)&data[12]);
-        if (sequence < remote_sequence_) {
-            ESP_LOGW(TAG, "Received audio packet with old sequence: %lu, expected: %lu", sequence, remote_sequence_);
+        uint32_t timestamp = AudioCrypto::ReadTimestamp(datagram);
+        uint32_t sequence = AudioCrypto::ReadSequence(datagram);
+        // Decrypted straight into a pooled payload, the header is copied to a stack counter block
+        auto payload = AudioPool::TakePayload();
+        payload.resize(data.size() - AUDIO_CRYPTO_HEADER_SIZE);
+        if (!crypto_.Decrypt(datagram, data.size(), payload.data())) {
+            AudioPool::RecyclePayload(std::move(payload));
             return;
         }
-        if (sequence != remote_sequence_ + 1) {
-            ESP_LOGW(TAG, "Received audio packet with wrong sequence: %lu, expected: %lu", sequence, remote_sequence_ + 1);
+
+        // Only a datagram that decrypted moves the window. Reordered packets are still handed over,
+        // the jitter buffer puts them back in order
+        uint32_t highest = remote_window_.highest();
+        auto result = remote_window_.Accept(sequence);
+        if (result == kSequenceDuplicated || result == kSequenceTooOld) {
+            ESP_LOGW(TAG, "Dropping %s audio packet: %lu, latest: %lu",
+                result == kSequenceDuplicated ? "duplicated" : "too old", sequence, highest);
+            AudioPool::RecyclePayload(std::move(payload));
+            return;
+        } else if (result == kSequenceReordered) {
+            ESP_LOGD(TAG, "Received reordered audio packet: %lu, latest: %lu", sequence, highest);
         }
 
-        size_t decrypted_size = data.size() - aes_nonce_.size();
-        size_t nc_off = 0;
-        uint8_t stream_block[16] = {0};
-        auto nonce = (uint8_t*)data.data();
-        auto encrypted = (uint8_t*)data.data() + aes_nonce_.size();
         auto packet = std::make_unique<AudioStreamPacket>();
         packet->sample_rate = server_sample_rate_;
         packet->frame_duration = server_frame_duration_;
         packet->timestamp = timestamp;
-        packet->payload.resize(decrypted_size);
-        int ret = mbedtls_aes_crypt_ctr(&aes_ctx_, decrypted_size, &nc_off, nonce, stream_block, encrypted, (uint8_t*)packet->payload.data());
-        if (ret != 0) {
-            ESP_LOGE(TAG, "Failed to decrypt audio data, ret: %d", ret);
-            return;
-        }
+        packet->sequence = sequence;
+        packet->payload = std::move(payload);
         if (on_incoming_audio_ != nullptr) {
             on_incoming_audio_(std::move(packet));
         }
-        remote_sequence_ = sequence;
         last_incoming_time_ = std::chrono::steady_clock::now();
     });
 
@@ -335,7 +365,8 @@ std::string MqttProtocol::GetHelloMessage() {
     cJSON_AddStringToObject(audio_params, "format", "opus");
     cJSON_AddNumberToObject(audio_params, "sample_rate", 16000);
     cJSON_AddNumberToObject(audio_params, "channels", 1);
-    cJSON_AddNumberToObject(audio_params, "frame_duration", OPUS_FRAME_DURATION_MS);
+    cJSON_AddNumberToObject(audio_params, "frame_duration", preferred_frame_duration_);
+    AddFrameAggregation(audio_params);
     cJSON_AddItemToObject(root, "audio_params", audio_params);
     auto json_str = cJSON_PrintUnformatted(root);
     std::string message(json_str);
@@ -359,6 +390,8 @@ void MqttProtocol::ParseServerHello(const cJSON* root) {
 
     // Get sample rate from hello message
     auto audio_params = cJSON_GetObjectItem(root, "audio_params");
+    ParseClientFrameDuration(audio_params);
+    ParseFrameAggregation(audio_params);
     if (cJSON_IsObject(audio_params)) {
         auto sample_rate = cJSON_GetObjectItem(audio_params, "sample_rate");
         if (cJSON_IsNumber(sample_rate)) {
@@ -382,11 +415,11 @@ void MqttProtocol::ParseServerHello(const cJSON* root) {
 
     // auto encryption = cJSON_GetObjectItem(udp, "encryption")->valuestring;
     // ESP_LOGI(TAG, "UDP server: %s, port: %d, encryption: %s", udp_server_.c_str(), udp_port_, encryption);
-    aes_nonce_ = DecodeHexString(nonce);
-    mbedtls_aes_init(&aes_ctx_);
-    mbedtls_aes_setkey_enc(&aes_ctx_, (const unsigned char*)DecodeHexString(key).c_str(), 128);
+    if (!crypto_.SetKey(DecodeHexString(key), DecodeHexString(nonce))) {
+        return;
+    }
     local_sequence_ = 0;
-    remote_sequence_ = 0;
+    remote_window_.Reset();
     xEventGroupSetBits(event_group_handle_, MQTT_PROTOCOL_SERVER_HELLO_EVENT);
 }
 
@@ -3,10 +3,11 @@
 
 
 #include "protocol.h"
+#include "sequence_window.h"
+#include "audio_crypto.h"
 #include <mqtt.h>
 #include <udp.h>
 #include <cJSON.h>
-#include <mbedtls/aes.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/event_groups.h>
 #include <esp_timer.h>
@@ -27,7 +28,8 @@ public:
     ~MqttProtocol();
 
     bool Start() override;
-    bool SendAudio(std::unique_ptr<AudioStreamPacket> packet) override;
+    bool SendAudio(AudioStreamPacket& packet) override;
+    size_t SendAudioBatch(AudioStreamPacket* const* packets, size_t count) override;
     bool OpenAudioChannel() override;
     void CloseAudioChannel() override;
     bool IsAudioChannelOpened() const override;
@@ -40,17 +42,18 @@ private:
     std::mutex channel_mutex_;
     std::unique_ptr<Mqtt> mqtt_;
     std::unique_ptr<Udp> udp_;
-    mbedtls_aes_context aes_ctx_;
-    std::string aes_nonce_;
+    AudioCrypto crypto_;
+    std::string datagram_;  // Transmit buffer, reused for every audio packet
     std::string udp_server_;
     int udp_port_;
     uint32_t local_sequence_;
-    uint32_t remote_sequence_;
+    SequenceWindow remote_window_;
     esp_timer_handle_t reconnect_timer_;
 
     bool StartMqttClient(bool report_error=false);
     void ParseServerHello(const cJSON* root);
     std::string DecodeHexString(const std::string& hex_string);
+    bool SendDatagram(const uint8_t* data, size_t size, const AudioStreamPacket& first, size_t frames);
 
     bool SendText(const std::string& text) override;
     std::string GetHelloMessage();
@@ -1,6 +1,8 @@
 #include "protocol.h"
 
 #include <esp_log.h>
+#include <algorithm>
+#include <cstring>
 
 #define TAG "Protocol"
 
@@ -32,6 +34,82 @@ void Protocol::OnDisconnected(std::function<void()> callback) {
     on_disconnected_ = callback;
 }
 
+void Protocol::SetPreferredFrameDuration(int frame_duration_ms) {
+    preferred_frame_duration_ = frame_duration_ms;
+}
+
+/* The hello proposes our frame duration, a server that cannot take it answers with uplink_frame_duration */
+void Protocol::ParseClientFrameDuration(const cJSON* audio_params) {
+    client_frame_duration_ = preferred_frame_duration_;
+    auto frame_duration = cJSON_GetObjectItem(audio_params, "uplink_frame_duration");
+    if (cJSON_IsNumber(frame_duration)) {
+        int value = frame_duration->valueint;
+        if (value == 20 || value == 40 || value == 60) {
+            client_frame_duration_ = value;
+        } else {
+            ESP_LOGW(TAG, "Ignoring unsupported uplink frame duration: %d", value);
+        }
+    }
+}
+
+/* The hello offers aggregated audio, a server that can unpack it answers with frames_per_packet */
+void Protocol::AddFrameAggregation(cJSON* audio_params) {
+#if CONFIG_AUDIO_FRAME_AGGREGATION
+    cJSON_AddNumberToObject(audio_params, "max_frames_per_packet", CONFIG_AUDIO_AGGREGATION_MAX_FRAMES);
+#endif
+}
+
+void Protocol::ParseFrameAggregation(const cJSON* audio_params) {
+    frames_per_packet_ = 1;
+#if CONFIG_AUDIO_FRAME_AGGREGATION
+    auto frames = cJSON_GetObjectItem(audio_params, "frames_per_packet");
+    if (cJSON_IsNumber(frames) && frames->valueint > 1) {
+        frames_per_packet_ = std::min(frames->valueint, CONFIG_AUDIO_AGGREGATION_MAX_FRAMES);
+        ESP_LOGI(TAG, "Sending up to %d audio frames per packet", frames_per_packet_);
+    }
+#endif
+}
+
+/*
+ * A packet only holds frames that follow each other: it ends before a frame that comes after
+ * suppressed silence or has another duration, since the server places the frames by the first one.
+ */
+size_t Protocol::PackFrames(AudioStreamPacket* const* packets, size_t count, size_t headroom) {
+    size_t frames = std::min<size_t>(count, frames_per_packet_);
+    size_t size = headroom;
+    size_t packed = 0;
+    for (; packed < frames; packed++) {
+        auto packet = packets[packed];
+        if (packed > 0 && (packet->skipped_frames > 0 || packet->frame_duration != packets[0]->frame_duration)) {
+            break;
+        }
+        size += AGGREGATED_FRAME_HEADER_SIZE + packet->opus_size();
+    }
+    if (packed == 1) {
+        return packed;
+    }
+
+    aggregate_buffer_.resize(size);
+    uint8_t* p = aggregate_buffer_.data() + headroom;
+    for (size_t i = 0; i < packed; i++) {
+        size_t opus_size = packets[i]->opus_size();
+        p[0] = opus_size >> 8;
+        p[1] = opus_size & 0xFF;
+        memcpy(p + AGGREGATED_FRAME_HEADER_SIZE, packets[i]->opus_data(), opus_size);
+        p += AGGREGATED_FRAME_HEADER_SIZE + opus_size;
+    }
+    return packed;
+}
+
+size_t Protocol::SendAudioBatch(AudioStreamPacket* const* packets, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (!SendAudio(*packets[i])) {
+            return i;
+        }
+    }
+    return count;
+}
+
 void Protocol::SetError(const std::string& message) {
     error_occurred_ = true;
     if (on_network_error_ != nullptr) {
@@ -4,19 +4,51 @@
 #include <cJSON.h>
 #include <string>
 #include <functional>
+#include <memory>
 #include <chrono>
 #include <vector>
 
+#include "audio_pool.h"
+#include "audio_latency.h"
+
+// Room the encoder leaves in front of each uplink frame, enough for the largest transport header (BinaryProtocol2)
+#define AUDIO_PACKET_HEADROOM 16
+
 struct AudioStreamPacket {
     int sample_rate = 0;
     int frame_duration = 0;
     uint32_t timestamp = 0;
+    uint32_t sequence = 0;  // 0 if the transport does not number its packets
+    uint32_t skipped_frames = 0;    // Uplink: frames suppressed as silence right before this one
+    AudioLatencyTrace trace;
     std::vector<uint8_t> payload;
+    size_t headroom = 0;    // Bytes in front of the Opus data in payload, free for a transport header
+
+    inline const uint8_t* opus_data() const { return payload.data() + headroom; }
+    inline size_t opus_size() const { return payload.size() - headroom; }
+
+    /*
+     * Returns where a header of the given size goes, right in front of the Opus data, so the
+     * transport frames the packet in place. The headroom is left as is, a retry writes it again.
+     * Only a packet encoded without enough headroom has its data moved.
+     */
+    uint8_t* PushHeader(size_t size) {
+        if (headroom < size) {
+            payload.insert(payload.begin(), size - headroom, 0);
+            headroom = size;
+        }
+        return payload.data() + headroom - size;
+    }
+
+    // Packets come from a slab and hand their payload storage back for the next frame
+    ~AudioStreamPacket() { AudioPool::RecyclePayload(std::move(payload)); }
+    static void* operator new(size_t size) { return AudioPool::AllocatePacket(size); }
+    static void operator delete(void* ptr) { AudioPool::FreePacket(ptr); }
 };
 
 struct BinaryProtocol2 {
     uint16_t version;
-    uint16_t type;          // Message type (0: OPUS, 1: JSON)
+    uint16_t type;          // Message type (0: OPUS, 1: JSON, 2: aggregated OPUS)
     uint32_t reserved;      // Reserved for future use
     uint32_t timestamp;     // Timestamp in milliseconds (used for server-side AEC)
     uint32_t payload_size;  // Payload size in bytes
@@ -30,6 +62,16 @@ struct BinaryProtocol3 {
     uint8_t payload[];
 } __attribute__((packed));
 
+/*
+ * Aggregated audio, used once the hello exchange agreed on frames_per_packet > 1: one binary message
+ * (type 2) or UDP datagram (flag 0x01) carries several consecutive Opus frames, each prefixed by its
+ * size: |size 2u|opus|size 2u|opus|...
+ * The timestamp and sequence are those of the first frame, the others follow it without a gap.
+ */
+#define BINARY_TYPE_AGGREGATED_OPUS 2
+#define UDP_FLAG_AGGREGATED_OPUS 0x01
+#define AGGREGATED_FRAME_HEADER_SIZE 2
+
 enum AbortReason {
     kAbortReasonNone,
     kAbortReasonWakeWordDetected
@@ -51,6 +93,14 @@ public:
     inline int server_frame_duration() const {
         return server_frame_duration_;
     }
+    // Uplink frame duration agreed in the last hello exchange
+    inline int client_frame_duration() const {
+        return client_frame_duration_;
+    }
+    // Uplink frames per packet agreed in the last hello exchange, 1 when they go one by one
+    inline int frames_per_packet() const {
+        return frames_per_packet_;
+    }
     inline const std::string& session_id() const {
         return session_id_;
     }
@@ -63,11 +113,20 @@ public:
     void OnConnected(std::function<void()> callback);
     void OnDisconnected(std::function<void()> callback);
 
+    // Uplink frame duration (20/40/60ms) proposed in the next hello, the server may ask for another one
+    void SetPreferredFrameDuration(int frame_duration_ms);
+
     virtual bool Start() = 0;
     virtual bool OpenAudioChannel() = 0;
+    // Hint that OpenAudioChannel() is probably coming soon, a transport may connect ahead of it
+    virtual void WarmUp() {}
     virtual void CloseAudioChannel() = 0;
     virtual bool IsAudioChannelOpened() const = 0;
-    virtual bool SendAudio(std::unique_ptr<AudioStreamPacket> packet) = 0;
+    // The packet stays with the caller, so a failed send can be retried
+    virtual bool SendAudio(AudioStreamPacket& packet) = 0;
+    // Sends the packets in order, returns how many were sent before the first failure.
+    // Transports that can carry several frames in one write override it.
+    virtual size_t SendAudioBatch(AudioStreamPacket* const* packets, size_t count);
     virtual void SendWakeWordDetected(const std::string& wake_word);
     virtual void SendStartListening(ListeningMode mode);
     virtual void SendStopListening();
@@ -85,12 +144,22 @@ protected:
 
     int server_sample_rate_ = 24000;
     int server_frame_duration_ = 60;
+    int preferred_frame_duration_ = 60;
+    int client_frame_duration_ = 60;
+    int frames_per_packet_ = 1;
+    std::vector<uint8_t> aggregate_buffer_;
     bool error_occurred_ = false;
     std::string session_id_;
     std::chrono::time_point<std::chrono::steady_clock> last_incoming_time_;
 
     virtual bool SendText(const std::string& text) = 0;
     virtual void SetError(const std::string& message);
+    void ParseClientFrameDuration(const cJSON* audio_params);
+    void AddFrameAggregation(cJSON* audio_params);
+    void ParseFrameAggregation(const cJSON* audio_params);
+    // Packs the leading frames into aggregate_buffer_ after headroom bytes and returns how many it took.
+    // A lone frame is left unpacked, it goes out as a plain one.
+    size_t PackFrames(AudioStreamPacket* const* packets, size_t count, size_t headroom);
     virtual bool IsTimeout() const;
 };
 
@@ -0,0 +1,48 @@
+#include "sequence_window.h"
+
+void SequenceWindow::Reset() {
+    started_ = false;
+    highest_ = 0;
+    seen_ = 0;
+    statistics_ = SequenceWindowStatistics();
+}
+
+SequenceWindowResult SequenceWindow::Accept(uint32_t sequence) {
+    statistics_.received++;
+    if (!started_) {
+        // Nothing before the first packet is expected, so the whole window counts as seen
+        started_ = true;
+        highest_ = sequence;
+        seen_ = ~0ULL;
+        return kSequenceNew;
+    }
+
+    int32_t delta = (int32_t)(sequence - highest_);
+    if (delta > 0) {
+        // The window slides forward, the sequences pushed out without arriving are lost
+        if (delta >= kWindowSize) {
+            statistics_.lost += (kWindowSize - __builtin_popcountll(seen_)) + (delta - kWindowSize);
+            seen_ = 1;
+        } else {
+            uint64_t leaving = seen_ >> (kWindowSize - delta);
+            statistics_.lost += delta - __builtin_popcountll(leaving);
+            seen_ = (seen_ << delta) | 1;
+        }
+        highest_ = sequence;
+        return kSequenceNew;
+    }
+
+    uint32_t offset = -delta;
+    if (offset >= kWindowSize) {
+        statistics_.too_old++;
+        return kSequenceTooOld;
+    }
+    uint64_t bit = 1ULL << offset;
+    if (seen_ & bit) {
+        statistics_.duplicated++;
+        return kSequenceDuplicated;
+    }
+    seen_ |= bit;
+    statistics_.reordered++;
+    return kSequenceReordered;
+}
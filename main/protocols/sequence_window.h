@@ -0,0 +1,54 @@
+#ifndef SEQUENCE_WINDOW_H
+#define SEQUENCE_WINDOW_H
+
+#include <cstdint>
+
+struct SequenceWindowStatistics {
+    uint32_t received = 0;
+    uint32_t reordered = 0;     // Accepted after a newer packet
+    uint32_t duplicated = 0;    // Seen before, dropped
+    uint32_t too_old = 0;       // Older than the window, dropped
+    uint32_t lost = 0;          // Left the window without arriving
+};
+
+enum SequenceWindowResult {
+    kSequenceNew,
+    kSequenceReordered,
+    kSequenceDuplicated,
+    kSequenceTooOld,
+};
+
+/*
+ * Sliding window over the last 64 sequence numbers of a stream, the bitmap of the IPsec window
+ * (RFC 4303) without its protection.
+ *
+ * A bitmap remembers which of them arrived. A packet older than the newest one is accepted if it
+ * is still inside the window and was not seen yet, so moderate reordering loses nothing, while a
+ * duplicate or a packet older than the window is dropped before it is decrypted. Putting the
+ * accepted packets back in order is left to the jitter buffer.
+ *
+ * This is not replay protection: the audio is AES-CTR without a MAC and the window slides before
+ * anything is authenticated, so a forged packet with a high sequence can push the genuine ones out
+ * as too old. It only filters duplicates and stale packets of a well-behaved network.
+ *
+ * Sequence numbers wrap around, only their distance counts. Only the receiving task touches it.
+ */
+class SequenceWindow {
+public:
+    void Reset();
+    // Marks the sequence as seen unless it is rejected (duplicated or too old)
+    SequenceWindowResult Accept(uint32_t sequence);
+
+    inline uint32_t highest() const { return highest_; }
+    const SequenceWindowStatistics& statistics() const { return statistics_; }
+
+private:
+    static constexpr int kWindowSize = 64;
+
+    bool started_ = false;
+    uint32_t highest_ = 0;
+    uint64_t seen_ = 0;     // Bit i set: sequence highest_ - i arrived
+    SequenceWindowStatistics statistics_;
+};
+
+#endif // SEQUENCE_WINDOW_H
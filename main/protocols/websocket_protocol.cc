@@ -3,6 +3,7 @@
 #include "system_info.h"
 #include "application.h"
 #include "settings.h"
+#include "network_metrics.h"
 
 #include <cstring>
 #include <cJSON.h>
@@ -17,6 +18,13 @@ WebsocketProtocol::WebsocketProtocol() {
 }
 
 WebsocketProtocol::~WebsocketProtocol() {
+    // A warm-up task still waiting on its connection has to finish before the members go away
+    xEventGroupSetBits(event_group_handle_, WEBSOCKET_PROTOCOL_ATTACHED_EVENT);
+    while (warm_up_running_) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    warm_websocket_.reset();
+    websocket_.reset();
     vEventGroupDelete(event_group_handle_);
 }
 
@@ -25,38 +33,74 @@ bool WebsocketProtocol::Start() {
     return true;
 }
 
-bool WebsocketProtocol::SendAudio(std::unique_ptr<AudioStreamPacket> packet) {
+bool WebsocketProtocol::SendAudio(AudioStreamPacket& packet) {
     if (websocket_ == nullptr || !websocket_->IsConnected()) {
         return false;
     }
 
+    // The header is written into the headroom in front of the Opus data, the frame goes out as one piece
+    size_t opus_size = packet.opus_size();
     if (version_ == 2) {
-        std::string serialized;
-        serialized.resize(sizeof(BinaryProtocol2) + packet->payload.size());
-        auto bp2 = (BinaryProtocol2*)serialized.data();
+        auto bp2 = (BinaryProtocol2*)packet.PushHeader(sizeof(BinaryProtocol2));
         bp2->version = htons(version_);
         bp2->type = 0;
         bp2->reserved = 0;
-        bp2->timestamp = htonl(packet->timestamp);
-        bp2->payload_size = htonl(packet->payload.size());
-        memcpy(bp2->payload, packet->payload.data(), packet->payload.size());
-
-        return websocket_->Send(serialized.data(), serialized.size(), true);
+        bp2->timestamp = htonl(packet.timestamp);
+        bp2->payload_size = htonl(opus_size);
+        return websocket_->Send((const char*)bp2, sizeof(BinaryProtocol2) + opus_size, true);
     } else if (version_ == 3) {
-        std::string serialized;
-        serialized.resize(sizeof(BinaryProtocol3) + packet->payload.size());
-        auto bp3 = (BinaryProtocol3*)serialized.data();
+        auto bp3 = (BinaryProtocol3*)packet.PushHeader(sizeof(BinaryProtocol3));
         bp3->type = 0;
         bp3->reserved = 0;
-        bp3->payload_size = htons(packet->payload.size());
-        memcpy(bp3->payload, packet->payload.data(), packet->payload.size());
-
-        return websocket_->Send(serialized.data(), serialized.size(), true);
+        bp3->payload_size = htons(opus_size);
+        return websocket_->Send((const char*)bp3, sizeof(BinaryProtocol3) + opus_size, true);
     } else {
-        return websocket_->Send(packet->payload.data(), packet->payload.size(), true);
+        return websocket_->Send((const char*)packet.opus_data(), opus_size, true);
     }
 }
 
+size_t WebsocketProtocol::SendAudioBatch(AudioStreamPacket* const* packets, size_t count) {
+    if (frames_per_packet_ <= 1 || version_ < 2) {
+        return Protocol::SendAudioBatch(packets, count);
+    }
+    if (websocket_ == nullptr || !websocket_->IsConnected()) {
+        return 0;
+    }
+
+    size_t header_size = version_ == 2 ? sizeof(BinaryProtocol2) : sizeof(BinaryProtocol3);
+    size_t sent = 0;
+    while (sent < count) {
+        size_t frames = PackFrames(packets + sent, count - sent, header_size);
+        if (frames == 1) {
+            if (!SendAudio(*packets[sent])) {
+                break;
+            }
+            sent++;
+            continue;
+        }
+
+        size_t payload_size = aggregate_buffer_.size() - header_size;
+        if (version_ == 2) {
+            auto bp2 = (BinaryProtocol2*)aggregate_buffer_.data();
+            bp2->version = htons(version_);
+            bp2->type = htons(BINARY_TYPE_AGGREGATED_OPUS);
+            bp2->reserved = 0;
+            bp2->timestamp = htonl(packets[sent]->timestamp);
+            bp2->payload_size = htonl(payload_size);
+        } else {
+            auto bp3 = (BinaryProtocol3*)aggregate_buffer_.data();
+            bp3->type = BINARY_TYPE_AGGREGATED_OPUS;
+            bp3->reserved = 0;
+            bp3->payload_size = htons(payload_size);
+        }
+        if (!websocket_->Send((const char*)aggregate_buffer_.data(), aggregate_buffer_.size(), true)) {
+            break;
+        }
+        sent += frames;
+    }
+    return sent;
+}
+
 bool WebsocketProtocol::SendText(const std::string& text) {
     if (websocket_ == nullptr || !websocket_->IsConnected()) {
         return false;
@@ -76,10 +120,105 @@ bool WebsocketProtocol::IsAudioChannelOpened() const {
 }
 
 void WebsocketProtocol::CloseAudioChannel() {
+    std::lock_guard<std::mutex> lock(connect_mutex_);
+    warm_websocket_.reset();
+    warm_ = false;
     websocket_.reset();
 }
 
+/*
+ * Connects in the background so the next OpenAudioChannel() only has to exchange the hello instead
+ * of going through DNS, TCP, TLS and the WebSocket upgrade. A connection nobody attaches to within
+ * the TTL is closed again, so an idle device does not hold a server connection for long.
+ */
+void WebsocketProtocol::WarmUp() {
+#if CONFIG_WEBSOCKET_WARM_CONNECTION
+    bool expected = false;
+    if (!warm_up_running_.compare_exchange_strong(expected, true)) {
+        return;
+    }
+    xEventGroupClearBits(event_group_handle_, WEBSOCKET_PROTOCOL_ATTACHED_EVENT);
+    auto ret = xTaskCreate([](void* arg) {
+        auto protocol = (WebsocketProtocol*)arg;
+        protocol->WarmUpTask();
+        protocol->warm_up_running_ = false;
+        vTaskDelete(NULL);
+    }, "ws_warm_up", 4096 * 2, this, 2, nullptr);
+    if (ret != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create warm-up task");
+        warm_up_running_ = false;
+    }
+#endif
+}
+
+void WebsocketProtocol::WarmUpTask() {
+#if CONFIG_WEBSOCKET_WARM_CONNECTION
+    {
+        std::lock_guard<std::mutex> lock(connect_mutex_);
+        if ((websocket_ != nullptr && websocket_->IsConnected()) || warm_websocket_ != nullptr) {
+            return;
+        }
+        ESP_LOGI(TAG, "Warming up the websocket connection");
+        warm_ = true;
+        warm_websocket_ = Connect(false);
+        if (warm_websocket_ == nullptr) {
+            warm_ = false;
+            return;
+        }
+    }
+
+    auto bits = xEventGroupWaitBits(event_group_handle_, WEBSOCKET_PROTOCOL_ATTACHED_EVENT, pdTRUE, pdFALSE,
+        pdMS_TO_TICKS(CONFIG_WEBSOCKET_WARM_TTL_SECONDS * 1000));
+    if (!(bits & WEBSOCKET_PROTOCOL_ATTACHED_EVENT)) {
+        std::lock_guard<std::mutex> lock(connect_mutex_);
+        if (warm_websocket_ != nullptr) {
+            ESP_LOGI(TAG, "Closing the unused warm connection");
+            warm_websocket_.reset();
+            warm_ = false;
+        }
+    }
+#endif
+}
+
 bool WebsocketProtocol::OpenAudioChannel() {
+    std::lock_guard<std::mutex> lock(connect_mutex_);
+    error_occurred_ = false;
+    if (warm_websocket_ != nullptr && warm_websocket_->IsConnected()) {
+        ESP_LOGI(TAG, "Attaching to the warm websocket connection");
+        websocket_ = std::move(warm_websocket_);
+    } else {
+        warm_websocket_.reset();
+        warm_ = false;
+        websocket_ = Connect(true);
+        if (websocket_ == nullptr) {
+            return false;
+        }
+    }
+    warm_ = false;
+    xEventGroupSetBits(event_group_handle_, WEBSOCKET_PROTOCOL_ATTACHED_EVENT);
+
+    // Send hello message to describe the client
+    auto message = GetHelloMessage();
+    if (!SendText(message)) {
+        return false;
+    }
+
+    // Wait for server hello
+    EventBits_t bits = xEventGroupWaitBits(event_group_handle_, WEBSOCKET_PROTOCOL_SERVER_HELLO_EVENT, pdTRUE, pdFALSE, pdMS_TO_TICKS(10000));
+    if (!(bits & WEBSOCKET_PROTOCOL_SERVER_HELLO_EVENT)) {
+        ESP_LOGE(TAG, "Failed to receive server hello");
+        SetError(Lang::Strings::SERVER_TIMEOUT);
+        return false;
+    }
+
+    if (on_audio_channel_opened_ != nullptr) {
+        on_audio_channel_opened_();
+    }
+
+    return true;
+}
+
+std::unique_ptr<WebSocket> WebsocketProtocol::Connect(bool report_error) {
     Settings settings("websocket", false);
     std::string url = settings.GetString("url");
     std::string token = settings.GetString("token");
@@ -88,13 +227,11 @@ bool WebsocketProtocol::OpenAudioChannel() {
         version_ = version;
     }
 
-    error_occurred_ = false;
-
     auto network = Board::GetInstance().GetNetwork();
-    websocket_ = network->CreateWebSocket(1);
-    if (websocket_ == nullptr) {
+    auto websocket = network->CreateWebSocket(1);
+    if (websocket == nullptr) {
         ESP_LOGE(TAG, "Failed to create websocket");
-        return false;
+        return nullptr;
     }
 
     if (!token.empty()) {
@@ -102,47 +239,55 @@ bool WebsocketProtocol::OpenAudioChannel() {
         if (token.find(" ") == std::string::npos) {
             token = "Bearer " + token;
         }
-        websocket_->SetHeader("Authorization", token.c_str());
+        websocket->SetHeader("Authorization", token.c_str());
     }
-    websocket_->SetHeader("Protocol-Version", std::to_string(version_).c_str());
-    websocket_->SetHeader("Device-Id", SystemInfo::GetMacAddress().c_str());
-    websocket_->SetHeader("Client-Id", Board::GetInstance().GetUuid().c_str());
+    websocket->SetHeader("Protocol-Version", std::to_string(version_).c_str());
+    websocket->SetHeader("Device-Id", SystemInfo::GetMacAddress().c_str());
+    websocket->SetHeader("Client-Id", Board::GetInstance().GetUuid().c_str());
 
-    websocket_->OnData([this](const char* data, size_t len, bool binary) {
+    websocket->OnData([this](const char* data, size_t len, bool binary) {
+        last_incoming_time_ = std::chrono::steady_clock::now();
         if (binary) {
             if (on_incoming_audio_ != nullptr) {
+                auto packet = std::make_unique<AudioStreamPacket>();
+                packet->sample_rate = server_sample_rate_;
+                packet->frame_duration = server_frame_duration_;
+                packet->payload = AudioPool::TakePayload();
+                /*
+                 * The header is read in place and only the Opus data is copied, once, into the pooled
+                 * payload: the transport reuses its buffer after this callback, while the packet waits
+                 * in the jitter buffer.
+                 */
+                const uint8_t* payload = (const uint8_t*)data;
+                size_t payload_size = len;
                 if (version_ == 2) {
-                    BinaryProtocol2* bp2 = (BinaryProtocol2*)data;
-                    bp2->version = ntohs(bp2->version);
-                    bp2->type = ntohs(bp2->type);
-                    bp2->timestamp = ntohl(bp2->timestamp);
-                    bp2->payload_size = ntohl(bp2->payload_size);
-                    auto payload = (uint8_t*)bp2->payload;
-                    on_incoming_audio_(std::make_unique<AudioStreamPacket>(AudioStreamPacket{
-                        .sample_rate = server_sample_rate_,
-                        .frame_duration = server_frame_duration_,
-                        .timestamp = bp2->timestamp,
-                        .payload = std::vector<uint8_t>(payload, payload + bp2->payload_size)
-                    }));
+                    auto bp2 = (const BinaryProtocol2*)data;
+                    if (len < sizeof(BinaryProtocol2)) {
+                        ESP_LOGW(TAG, "Dropping truncated audio frame: %u bytes", len);
+                        return;
+                    }
+                    packet->timestamp = ntohl(bp2->timestamp);
+                    payload = bp2->payload;
+                    payload_size = ntohl(bp2->payload_size);
+                    if (payload_size > len - sizeof(BinaryProtocol2)) {
+                        ESP_LOGW(TAG, "Dropping audio frame with payload size %u > %u", payload_size, len - sizeof(BinaryProtocol2));
+                        return;
+                    }
                 } else if (version_ == 3) {
-                    BinaryProtocol3* bp3 = (BinaryProtocol3*)data;
-                    bp3->type = bp3->type;
-                    bp3->payload_size = ntohs(bp3->payload_size);
-                    auto payload = (uint8_t*)bp3->payload;
-                    on_incoming_audio_(std::make_unique<AudioStreamPacket>(AudioStreamPacket{
-                        .sample_rate = server_sample_rate_,
-                        .frame_duration = server_frame_duration_,
-                        .timestamp = 0,
-                        .payload = std::vector<uint8_t>(payload, payload + bp3->payload_size)
-                    }));
-                } else {
-                    on_incoming_audio_(std::make_unique<AudioStreamPacket>(AudioStreamPacket{
-                        .sample_rate = server_sample_rate_,
-                        .frame_duration = server_frame_duration_,
-                        .timestamp = 0,
-                        .payload = std::vector<uint8_t>((uint8_t*)data, (uint8_t*)data + len)
-                    }));
+                    auto bp3 = (const BinaryProtocol3*)data;
+                    if (len < sizeof(BinaryProtocol3)) {
+                        ESP_LOGW(TAG, "Dropping truncated audio frame: %u bytes", len);
+                        return;
+                    }
+                    payload = bp3->payload;
+                    payload_size = ntohs(bp3->payload_size);
+                    if (payload_size > len - sizeof(BinaryProtocol3)) {
+                        ESP_LOGW(TAG, "Dropping audio frame with payload size %u > %u", payload_size, len - sizeof(BinaryProtocol3));
+                        return;
+                    }
                 }
+                packet->payload.assign(payload, payload + payload_size);
+                on_incoming_audio_(std::move(packet));
             }
         } else {
             // Parse JSON data
@@ -161,42 +306,28 @@ bool WebsocketProtocol::OpenAudioChannel() {
             }
             cJSON_Delete(root);
         }
-        last_incoming_time_ = std::chrono::steady_clock::now();
     });
 
-    websocket_->OnDisconnected([this]() {
+    websocket->OnDisconnected([this]() {
         ESP_LOGI(TAG, "Websocket disconnected");
+        // Losing a warm connection nobody attached to yet is not the end of a session
+        if (warm_) {
+            return;
+        }
         if (on_audio_channel_closed_ != nullptr) {
             on_audio_channel_closed_();
         }
     });
 
     ESP_LOGI(TAG, "Connecting to websocket server: %s with version: %d", url.c_str(), version_);
-    if (!websocket_->Connect(url.c_str())) {
+    if (!NetworkMetrics::GetInstance().ConnectWebSocket(*websocket, url)) {
         ESP_LOGE(TAG, "Failed to connect to websocket server");
-        SetError(Lang::Strings::SERVER_NOT_CONNECTED);
-        return false;
-    }
-
-    // Send hello message to describe the client
-    auto message = GetHelloMessage();
-    if (!SendText(message)) {
-        return false;
-    }
-
-    // Wait for server hello
-    EventBits_t bits = xEventGroupWaitBits(event_group_handle_, WEBSOCKET_PROTOCOL_SERVER_HELLO_EVENT, pdTRUE, pdFALSE, pdMS_TO_TICKS(10000));
-    if (!(bits & WEBSOCKET_PROTOCOL_SERVER_HELLO_EVENT)) {
-        ESP_LOGE(TAG, "Failed to receive server hello");
-        SetError(Lang::Strings::SERVER_TIMEOUT);
-        return false;
-    }
-
-    if (on_audio_channel_opened_ != nullptr) {
-        on_audio_channel_opened_();
+        if (report_error) {
+            SetError(Lang::Strings::SERVER_NOT_CONNECTED);
+        }
+        return nullptr;
     }
-
-    return true;
+    return websocket;
 }
 
 std::string WebsocketProtocol::GetHelloMessage() {
@@ -215,7 +346,11 @@ std::string WebsocketProtocol::GetHelloMessage() {
     cJSON_AddStringToObject(audio_params, "format", "opus");
     cJSON_AddNumberToObject(audio_params, "sample_rate", 16000);
     cJSON_AddNumberToObject(audio_params, "channels", 1);
-    cJSON_AddNumberToObject(audio_params, "frame_duration", OPUS_FRAME_DURATION_MS);
+    cJSON_AddNumberToObject(audio_params, "frame_duration", preferred_frame_duration_);
+    // Version 1 frames have no header to tell an aggregated message apart
+    if (version_ >= 2) {
+        AddFrameAggregation(audio_params);
+    }
     cJSON_AddItemToObject(root, "audio_params", audio_params);
     auto json_str = cJSON_PrintUnformatted(root);
     std::string message(json_str);
@@ -238,6 +373,8 @@ void WebsocketProtocol::ParseServerHello(const cJSON* root) {
     }
 
     auto audio_params = cJSON_GetObjectItem(root, "audio_params");
+    ParseClientFrameDuration(audio_params);
+    ParseFrameAggregation(audio_params);
     if (cJSON_IsObject(audio_params)) {
         auto sample_rate = cJSON_GetObjectItem(audio_params, "sample_rate");
         if (cJSON_IsNumber(sample_rate)) {
@@ -8,7 +8,11 @@
 #include <freertos/FreeRTOS.h>
 #include <freertos/event_groups.h>
 
+#include <atomic>
+#include <mutex>
+
 #define WEBSOCKET_PROTOCOL_SERVER_HELLO_EVENT (1 << 0)
+#define WEBSOCKET_PROTOCOL_ATTACHED_EVENT (1 << 1)
 
 class WebsocketProtocol : public Protocol {
 public:
@@ -16,8 +20,10 @@ public:
     ~WebsocketProtocol();
 
     bool Start() override;
-    bool SendAudio(std::unique_ptr<AudioStreamPacket> packet) override;
+    bool SendAudio(AudioStreamPacket& packet) override;
+    size_t SendAudioBatch(AudioStreamPacket* const* packets, size_t count) override;
     bool OpenAudioChannel() override;
+    void WarmUp() override;
     void CloseAudioChannel() override;
     bool IsAudioChannelOpened() const override;
 
@@ -25,7 +31,16 @@ private:
     EventGroupHandle_t event_group_handle_;
     std::unique_ptr<WebSocket> websocket_;
     int version_ = 1;
-
+    // Serializes connecting between OpenAudioChannel() and the warm-up task, guards warm_websocket_
+    std::mutex connect_mutex_;
+    // Connected ahead of time, moved into websocket_ once OpenAudioChannel() attaches to it, so the
+    // warm-up task never touches the connection the audio path reads without the lock
+    std::unique_ptr<WebSocket> warm_websocket_;
+    std::atomic<bool> warm_{false};
+    std::atomic<bool> warm_up_running_{false};
+
+    std::unique_ptr<WebSocket> Connect(bool report_error);
+    void WarmUpTask();
     void ParseServerHello(const cJSON* root);
     bool SendText(const std::string& text) override;
     std::string GetHelloMessage();
@@ -0,0 +1,107 @@
+#include "tls_session_cache.h"
+
+#include <esp_log.h>
+
+#define TAG "TlsSessionCache"
+
+#define MAX_CACHED_SESSIONS 8
+
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+static std::string KeyOf(const std::string& host, int port) {
+    return host + ":" + std::to_string(port);
+}
+
+TlsSessionCache::Session TlsSessionCache::Find(const std::string& host, int port) {
+    std::string key = KeyOf(host, port);
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& entry : entries_) {
+        if (entry.key == key) {
+            entry.last_used = ++use_counter_;
+            return entry.session;
+        }
+    }
+    return nullptr;
+}
+
+void TlsSessionCache::Store(const std::string& host, int port, esp_tls_t* tls) {
+    esp_tls_client_session_t* session = esp_tls_get_client_session(tls);
+    if (session == nullptr) {
+        ESP_LOGD(TAG, "No session to save for %s", host.c_str());
+        return;
+    }
+
+    std::string key = KeyOf(host, port);
+    // The replaced session is freed outside the lock, once nobody shares it anymore
+    Session replaced;
+    std::lock_guard<std::mutex> lock(mutex_);
+    Entry* slot = nullptr;
+    for (auto& entry : entries_) {
+        if (entry.key == key) {
+            slot = &entry;
+            break;
+        }
+    }
+    if (slot == nullptr) {
+        if (entries_.size() < MAX_CACHED_SESSIONS) {
+            entries_.emplace_back();
+            slot = &entries_.back();
+        } else {
+            slot = &entries_[0];
+            for (auto& entry : entries_) {
+                if (entry.last_used < slot->last_used) {
+                    slot = &entry;
+                }
+            }
+            statistics_.evicted++;
+        }
+        slot->key = key;
+    }
+    replaced = std::move(slot->session);
+    slot->session = Session(session, esp_tls_free_client_session);
+    slot->last_used = ++use_counter_;
+    statistics_.stored++;
+}
+
+void TlsSessionCache::Forget(const std::string& host, int port) {
+    std::string key = KeyOf(host, port);
+    Session forgotten;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = entries_.begin(); it != entries_.end(); it++) {
+        if (it->key == key) {
+            forgotten = std::move(it->session);
+            entries_.erase(it);
+            return;
+        }
+    }
+}
+#endif
+
+void TlsSessionCache::RecordHandshake(bool offered, bool success, uint32_t duration_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    statistics_.handshakes++;
+    if (offered) {
+        statistics_.offered++;
+    }
+    if (!success) {
+        statistics_.failures++;
+    } else if (offered) {
+        resumed_histogram_.Add(duration_us);
+    } else {
+        full_histogram_.Add(duration_us);
+    }
+}
+
+TlsSessionCacheStatistics TlsSessionCache::statistics() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    TlsSessionCacheStatistics stats = statistics_;
+    stats.full_p50_us = full_histogram_.Percentile(50);
+    stats.resumed_p50_us = resumed_histogram_.Percentile(50);
+    return stats;
+}
+
+void TlsSessionCache::Reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    statistics_ = TlsSessionCacheStatistics();
+    full_histogram_.Reset();
+    resumed_histogram_.Reset();
+}
@@ -0,0 +1,82 @@
+#ifndef TLS_SESSION_CACHE_H
+#define TLS_SESSION_CACHE_H
+
+#include <esp_tls.h>
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+
+#include "latency_histogram.h"
+
+struct TlsSessionCacheStatistics {
+    uint32_t handshakes = 0;
+    uint32_t failures = 0;
+    uint32_t offered = 0;           // Handshakes that offered a saved session, the server may still refuse it
+    uint32_t stored = 0;            // Sessions saved after a handshake
+    uint32_t evicted = 0;           // Sessions of the least recently used host dropped for another one
+    uint32_t full_p50_us = 0;       // Connect time without a saved session
+    uint32_t resumed_p50_us = 0;    // Connect time offering a saved session
+};
+
+/*
+ * Process-wide TLS client sessions, one per host:port, for the connections opened through
+ * TlsTransport.
+ *
+ * After a handshake the session (ticket or id) the server handed out is kept here, and the next
+ * connection to the same server offers it, so a server that accepts it skips the certificate
+ * exchange and the key agreement. A server may refuse it and fall back to a full handshake, the
+ * two connect time medians tell how often it worked. A session offered to a failed handshake is
+ * dropped. Needs CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS, without it only the connect times are kept.
+ *
+ * Only covers the HTTPS requests of the HttpPool on Wi-Fi boards: 4G boards and the websocket and
+ * MQTT connections do their own TLS and never come through here. The sessions are opaque esp-tls
+ * objects on the heap esp-tls allocates them from, not moved to PSRAM and not saved to NVS, so
+ * they live only until reboot.
+ */
+class TlsSessionCache {
+public:
+    static TlsSessionCache& GetInstance() {
+        static TlsSessionCache instance;
+        return instance;
+    }
+    // Delete copy constructor and assignment operator
+    TlsSessionCache(const TlsSessionCache&) = delete;
+    TlsSessionCache& operator=(const TlsSessionCache&) = delete;
+
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+    using Session = std::shared_ptr<esp_tls_client_session_t>;
+
+    // Shared, so the session stays valid during the handshake even if it is replaced meanwhile
+    Session Find(const std::string& host, int port);
+    // Saves the session of a connection that just finished its handshake
+    void Store(const std::string& host, int port, esp_tls_t* tls);
+    void Forget(const std::string& host, int port);
+#endif
+    void RecordHandshake(bool offered, bool success, uint32_t duration_us);
+
+    TlsSessionCacheStatistics statistics();
+    void Reset();
+
+private:
+    TlsSessionCache() = default;
+
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+    struct Entry {
+        std::string key;    // host:port
+        Session session;
+        uint32_t last_used;
+    };
+
+    std::vector<Entry> entries_;
+    uint32_t use_counter_ = 0;
+#endif
+    std::mutex mutex_;
+    TlsSessionCacheStatistics statistics_;
+    LatencyHistogram full_histogram_;
+    LatencyHistogram resumed_histogram_;
+};
+
+#endif // TLS_SESSION_CACHE_H
@@ -0,0 +1,94 @@
+#include "tls_transport.h"
+#include "tls_session_cache.h"
+
+#include <esp_log.h>
+#include <esp_crt_bundle.h>
+#include <esp_timer.h>
+
+#define TAG "TlsTransport"
+
+TlsTransport::~TlsTransport() {
+    Close();
+}
+
+bool TlsTransport::Connect(const std::string& host, int port, int timeout_ms) {
+    Close();
+    tls_ = esp_tls_init();
+    if (tls_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to allocate the TLS context");
+        return false;
+    }
+
+    auto& cache = TlsSessionCache::GetInstance();
+    esp_tls_cfg_t cfg = {};
+    cfg.crt_bundle_attach = esp_crt_bundle_attach;
+    cfg.timeout_ms = timeout_ms;
+    bool offered = false;
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+    // Held until the handshake is done, mbedtls copies it when the handshake starts
+    auto session = cache.Find(host, port);
+    cfg.client_session = session.get();
+    offered = session != nullptr;
+#endif
+
+    int64_t start = esp_timer_get_time();
+    bool success = esp_tls_conn_new_sync(host.c_str(), host.size(), port, &cfg, tls_) == 1;
+    cache.RecordHandshake(offered, success, esp_timer_get_time() - start);
+    if (!success) {
+        ESP_LOGE(TAG, "Failed to connect to %s:%d", host.c_str(), port);
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+        // Do not offer a session the server may have choked on again
+        if (offered) {
+            cache.Forget(host, port);
+        }
+#endif
+        Close();
+        return false;
+    }
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+    cache.Store(host, port, tls_);
+#endif
+    return true;
+}
+
+bool TlsTransport::Send(const char* data, size_t size) {
+    while (size > 0) {
+        // The socket has a send timeout, WANT_WRITE means it expired
+        ssize_t ret = esp_tls_conn_write(tls_, data, size);
+        if (ret <= 0) {
+            ESP_LOGE(TAG, "Failed to send: %d", (int)ret);
+            return false;
+        }
+        data += ret;
+        size -= ret;
+    }
+    return true;
+}
+
+int TlsTransport::Receive(char* buffer, size_t size) {
+    // The socket has a receive timeout, WANT_READ means it expired
+    ssize_t ret = esp_tls_conn_read(tls_, buffer, size);
+    if (ret < 0) {
+        ESP_LOGE(TAG, "Failed to receive: %d", (int)ret);
+        return -1;
+    }
+    return ret;
+}
+
+void TlsTransport::Close() {
+    if (tls_ != nullptr) {
+        esp_tls_conn_destroy(tls_);
+        tls_ = nullptr;
+    }
+}
+
+bool TlsTransport::IsIdleAlive() {
+    if (tls_ == nullptr || esp_tls_get_bytes_avail(tls_) > 0) {
+        return false;
+    }
+    int fd = -1;
+    if (esp_tls_get_conn_sockfd(tls_, &fd) != ESP_OK || fd < 0) {
+        return false;
+    }
+    return TcpTransport::IsSocketIdleAlive(fd);
+}
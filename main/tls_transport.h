@@ -0,0 +1,25 @@
+#ifndef TLS_TRANSPORT_H
+#define TLS_TRANSPORT_H
+
+#include "http_transport.h"
+
+#include <esp_tls.h>
+
+/* TLS over lwIP through esp-tls, the server certificate is checked against the certificate bundle */
+class TlsTransport : public HttpTransport {
+public:
+    TlsTransport() = default;
+    ~TlsTransport();
+
+    bool Connect(const std::string& host, int port, int timeout_ms) override;
+    bool Send(const char* data, size_t size) override;
+    int Receive(char* buffer, size_t size) override;
+    void Close() override;
+    bool connected() const override { return tls_ != nullptr; }
+    bool IsIdleAlive() override;
+
+private:
+    esp_tls_t* tls_ = nullptr;
+};
+
+#endif // TLS_TRANSPORT_H
@@ -9,6 +9,8 @@ HEADER_TEMPLATE = """// Auto-generated language config
 
 #include <string_view>
 
+#include "ogg_packet_index.h"
+
 #ifndef {lang_code_for_font}
     #define {lang_code_for_font}  // 預設語言
 #endif
@@ -25,6 +27,12 @@ namespace Lang {{
     // 音效资源 (en-US as fallback for missing audio files)
     namespace Sounds {{
 {sounds}
+
+        // 预编译的 Ogg 包索引，播放时无需解析 (以 data 为 nullptr 的项结尾)
+        inline constexpr OggPacketIndex PACKET_INDEX[] = {{
+{packet_index}
+            {{.data = nullptr, .packets = nullptr, .packet_count = 0, .sample_rate = 0}}
+        }};
     }}
 }}
 """
@@ -50,6 +58,74 @@ def get_sound_files(directory):
         return []
     return [f for f in os.listdir(directory) if f.endswith('.ogg')]
 
+def parse_ogg_packets(path):
+    """解析 Ogg/Opus 文件，返回 (采样率, [(偏移, 长度)])；有跨页的包时返回 None"""
+    with open(path, 'rb') as f:
+        data = f.read()
+
+    packets = []
+    pos = 0
+    while pos + 27 <= len(data):
+        if data[pos:pos + 4] != b'OggS':
+            pos += 1
+            continue
+        segment_count = data[pos + 26]
+        segments = data[pos + 27:pos + 27 + segment_count]
+        offset = pos + 27 + segment_count
+        if len(segments) < segment_count:
+            break
+        length = 0
+        if offset + sum(segments) > len(data):
+            # 文件被截断
+            return None
+        for lacing in segments:
+            length += lacing
+            if lacing < 255:
+                packets.append((offset, length))
+                offset += length
+                length = 0
+        if length > 0:
+            # 包跨越了页边界，在 flash 中不连续
+            return None
+        pos = offset
+
+    sample_rate = 16000
+    if packets:
+        offset, length = packets[0]
+        head = data[offset:offset + length]
+        if length >= 19 and head[:8] == b'OpusHead':
+            sample_rate = int.from_bytes(head[12:16], 'little')
+    # 跳过 OpusHead、OpusTags 以及空包
+    audio_packets = [p for p in packets[2:] if p[1] > 0]
+    if any(length > 0xFFFF for _, length in audio_packets):
+        return None
+    return sample_rate, audio_packets
+
+def generate_sound(base_name, path, sounds, packet_index):
+    """生成单个音效的常量及其包索引"""
+    sound = f'''
+        extern const char ogg_{base_name}_start[] asm("_binary_{base_name}_ogg_start");
+        extern const char ogg_{base_name}_end[] asm("_binary_{base_name}_ogg_end");
+        static const std::string_view OGG_{base_name.upper()} {{
+        static_cast<const char*>(ogg_{base_name}_start),
+        static_cast<size_t>(ogg_{base_name}_end - ogg_{base_name}_start)
+        }};'''
+
+    parsed = parse_ogg_packets(path)
+    if parsed is None or not parsed[1]:
+        print(f"Warning: {path} can not be indexed, it will be demuxed at runtime")
+    else:
+        sample_rate, packets = parsed
+        entries = ", ".join(f"{{{offset}, {length}}}" for offset, length in packets)
+        table = f"OGG_{base_name.upper()}_PACKETS"
+        sound += f'''
+        inline constexpr OggPacketEntry {table}[] = {{{entries}}};
+        static_assert({table}[{len(packets) - 1}].offset + {table}[{len(packets) - 1}].size <= {os.path.getsize(path)},
+            "Packet index of {base_name}.ogg is out of bounds");'''
+        packet_index.append(f"            {{.data = ogg_{base_name}_start, .packets = {table}, "
+                            f".packet_count = {len(packets)}, .sample_rate = {sample_rate}}},")
+    sounds.append(sound)
+
 def generate_header(lang_code, output_path):
     # 从输出路径推导项目结构
     # output_path 通常是 main/assets/lang_config.h
@@ -101,6 +177,7 @@ def generate_header(lang_code, output_path):
     # 生成字符串常量
     strings = []
     sounds = []
+    packet_index = []
     for key, value in merged_strings.items():
         value = value.replace('"', '\\"')
         strings.append(f'        constexpr const char* {key.upper()} = "{value}";')
@@ -138,34 +215,25 @@ def generate_header(lang_code, output_path):
         # 优先使用当前语言的音效，如果不存在则回退到 en-US
         if file in current_sounds:
             sound_lang = lang_code.replace('-', '_').lower()
+            sound_path = os.path.join(current_lang_dir, file)
         else:
             sound_lang = 'en_us'
-            
-        sounds.append(f'''
-        extern const char ogg_{base_name}_start[] asm("_binary_{base_name}_ogg_start");
-        extern const char ogg_{base_name}_end[] asm("_binary_{base_name}_ogg_end");
-        static const std::string_view OGG_{base_name.upper()} {{
-        static_cast<const char*>(ogg_{base_name}_start),
-        static_cast<size_t>(ogg_{base_name}_end - ogg_{base_name}_start)
-        }};''')
+            sound_path = os.path.join(base_lang_dir, file)
+
+        generate_sound(base_name, sound_path, sounds, packet_index)
     
     # 生成公共音效常量
     for file in sorted(common_sounds):
         base_name = os.path.splitext(file)[0]
-        sounds.append(f'''
-        extern const char ogg_{base_name}_start[] asm("_binary_{base_name}_ogg_start");
-        extern const char ogg_{base_name}_end[] asm("_binary_{base_name}_ogg_end");
-        static const std::string_view OGG_{base_name.upper()} {{
-        static_cast<const char*>(ogg_{base_name}_start),
-        static_cast<size_t>(ogg_{base_name}_end - ogg_{base_name}_start)
-        }};''')
+        generate_sound(base_name, os.path.join(common_dir, file), sounds, packet_index)
 
     # 填充模板
     content = HEADER_TEMPLATE.format(
         lang_code=lang_code,
         lang_code_for_font=lang_code.replace('-', '_').lower(),
         strings="\n".join(sorted(strings)),
-        sounds="\n".join(sorted(sounds))
+        sounds="\n".join(sorted(sounds)),
+        packet_index="\n".join(sorted(packet_index))
     )
 
     # 写入文件
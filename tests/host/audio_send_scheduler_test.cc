@@ -0,0 +1,229 @@
+#include "audio_send_scheduler.h"
+#include "host_test.h"
+
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// MQTT + UDP: the 16 byte audio header plus IPv4 and UDP
+static const size_t kUdpOverheadBytes = 16 + 28;
+// WebSocket: protocol 3 header, masked client frame header, TLS 1.2 AES-GCM record, TCP/IPv4
+static const size_t kWebsocketOverheadBytes = 4 + 6 + 29 + 40;
+
+/*
+ * A transport like MqttProtocol::SendAudioBatch(): a lone frame goes out as it is, consecutive
+ * frames are packed into one write. Records every write, and fails the next fail_writes of them.
+ */
+class FakeProtocol : public Protocol {
+public:
+    std::vector<std::vector<uint8_t>> writes;
+    std::vector<size_t> frames_per_write;
+    int fail_writes = 0;
+
+    explicit FakeProtocol(int frames_per_packet) { frames_per_packet_ = frames_per_packet; }
+
+    bool Start() override { return true; }
+    bool OpenAudioChannel() override { return true; }
+    void CloseAudioChannel() override {}
+    bool IsAudioChannelOpened() const override { return true; }
+
+    bool SendAudio(AudioStreamPacket& packet) override {
+        return Write(packet.opus_data(), packet.opus_size(), 1);
+    }
+
+    size_t SendAudioBatch(AudioStreamPacket* const* packets, size_t count) override {
+        if (frames_per_packet_ <= 1) {
+            return Protocol::SendAudioBatch(packets, count);
+        }
+        size_t sent = 0;
+        while (sent < count) {
+            size_t frames = PackFrames(packets + sent, count - sent, 0);
+            bool success = frames == 1 ? SendAudio(*packets[sent])
+                : Write(aggregate_buffer_.data(), aggregate_buffer_.size(), frames);
+            if (!success) {
+                break;
+            }
+            sent += frames;
+        }
+        return sent;
+    }
+
+protected:
+    bool SendText(const std::string& text) override { return true; }
+
+private:
+    bool Write(const uint8_t* data, size_t size, size_t frames) {
+        if (fail_writes > 0) {
+            fail_writes--;
+            return false;
+        }
+        writes.emplace_back(data, data + size);
+        frames_per_write.push_back(frames);
+        return true;
+    }
+};
+
+// An encoded frame whose Opus data is its number, repeated
+static std::unique_ptr<AudioStreamPacket> Frame(uint8_t number, size_t opus_size = 40, int frame_duration = 60) {
+    auto packet = std::make_unique<AudioStreamPacket>();
+    packet->frame_duration = frame_duration;
+    packet->payload = AudioPool::TakePayload();
+    packet->payload.assign(AUDIO_PACKET_HEADROOM + opus_size, number);
+    packet->headroom = AUDIO_PACKET_HEADROOM;
+    return packet;
+}
+
+static void TestAggregation() {
+    AudioLatencyTracker tracker;
+    AudioSendScheduler scheduler(tracker, 1000, 64, 8, 3, 1000);
+    FakeProtocol protocol(3);
+
+    // Frames wait until a whole packet is ready
+    scheduler.Push(Frame(1));
+    scheduler.Push(Frame(2));
+    CHECK(scheduler.Flush(protocol));
+    CHECK(protocol.writes.empty() && scheduler.FlushDelayMs() > 0);
+    CHECK(scheduler.statistics().held == 1);
+
+    scheduler.Push(Frame(3, 20));
+    CHECK(scheduler.Flush(protocol));
+    CHECK(scheduler.Empty() && scheduler.FlushDelayMs() == -1);
+    CHECK(protocol.writes.size() == 1 && protocol.frames_per_write[0] == 3);
+
+    // |size 2u|opus|size 2u|opus|...
+    auto& write = protocol.writes[0];
+    CHECK(write.size() == 3 * 2 + 40 + 40 + 20);
+    CHECK(write[0] == 0 && write[1] == 40 && write[2] == 1 && write[41] == 1);
+    CHECK(write[42] == 0 && write[43] == 40 && write[44] == 2);
+    CHECK(write[84] == 0 && write[85] == 20 && write[86] == 3 && write.back() == 3);
+    CHECK(scheduler.statistics().sent == 3 && scheduler.statistics().writes == 1);
+}
+
+static void TestBudget() {
+    AudioLatencyTracker tracker;
+    AudioSendScheduler scheduler(tracker, 1000, 64, 8, 3, 20);
+    FakeProtocol protocol(3);
+
+    scheduler.Push(Frame(1));
+    CHECK(scheduler.Flush(protocol));
+    CHECK(protocol.writes.empty());
+    int delay_ms = scheduler.FlushDelayMs();
+    CHECK(delay_ms > 0 && delay_ms <= 20);
+
+    // Once the oldest frame used up its budget, what is there goes out
+    std::this_thread::sleep_for(std::chrono::milliseconds(25));
+    CHECK(scheduler.FlushDelayMs() == 0);
+    CHECK(scheduler.Flush(protocol));
+    CHECK(protocol.writes.size() == 1 && protocol.frames_per_write[0] == 1);
+    CHECK(protocol.writes[0].size() == 40);
+}
+
+static void TestPacketBoundaries() {
+    AudioLatencyTracker tracker;
+    AudioSendScheduler scheduler(tracker, 1000, 64, 8, 3, 1000);
+    FakeProtocol protocol(3);
+
+    // A gap from suppressed silence and a change of frame duration both start a new packet
+    scheduler.Push(Frame(1));
+    scheduler.Push(Frame(2));
+    auto after_gap = Frame(3);
+    after_gap->skipped_frames = 5;
+    scheduler.Push(std::move(after_gap));
+    scheduler.Push(Frame(4));
+    scheduler.Push(Frame(5, 40, 20));
+    scheduler.Push(Frame(6, 40, 20));
+    CHECK(scheduler.Flush(protocol));
+    CHECK(scheduler.Empty());
+    CHECK((protocol.frames_per_write == std::vector<size_t>{2, 2, 2}));
+    CHECK(protocol.writes[1][2] == 3 && protocol.writes[2][2] == 5);
+}
+
+static void TestRetryAndDeadline() {
+    AudioLatencyTracker tracker;
+    AudioSendScheduler scheduler(tracker, 1000, 64, 8, 2, 0);
+    FakeProtocol protocol(1);
+
+    // A failed write keeps the frames for the next flush
+    protocol.fail_writes = 1;
+    scheduler.Push(Frame(1));
+    scheduler.Push(Frame(2));
+    CHECK(!scheduler.Flush(protocol));
+    CHECK(scheduler.Flush(protocol));
+    CHECK(protocol.writes.size() == 2 && protocol.writes[0][0] == 1);
+
+    // The oldest frame is given up on after max_retries, its successor carries the gap
+    protocol.fail_writes = 3;
+    scheduler.Push(Frame(3));
+    scheduler.Push(Frame(4));
+    CHECK(!scheduler.Flush(protocol));
+    CHECK(!scheduler.Flush(protocol));
+    CHECK(!scheduler.Flush(protocol));
+    CHECK(scheduler.statistics().abandoned == 1);
+    CHECK(scheduler.Flush(protocol));
+    CHECK(protocol.writes.size() == 3 && protocol.writes[2][0] == 4);
+
+    // Frames past their deadline are dropped before sending
+    AudioSendScheduler late(tracker, 10, 64, 8, 2, 0);
+    late.Push(Frame(5));
+    std::this_thread::sleep_for(std::chrono::milliseconds(15));
+    late.Push(Frame(6));
+    CHECK(late.Flush(protocol));
+    CHECK(late.statistics().expired == 1 && late.statistics().sent == 1);
+    CHECK(protocol.writes.back()[0] == 6);
+
+    // Beyond max_pending the oldest ones go
+    AudioSendScheduler full(tracker, 1000, 4, 8, 2, 0);
+    for (int i = 0; i < 6; i++) {
+        full.Push(Frame(i));
+    }
+    CHECK(full.statistics().overflowed == 2);
+}
+
+/*
+ * Packets/s and bytes/s on the wire for a minute of uplink at 16 kbps, by frames per packet. The
+ * scheduler is flushed after every frame, as the main loop does, only faster than real time, so
+ * every packet fills within the budget. Each write is counted with the per-packet overhead of the
+ * MQTT + UDP and the WebSocket transport; TCP acknowledgements and the AES-CTR setup per datagram
+ * are not counted.
+ */
+static void TestBandwidthBenchmark() {
+    for (int frame_duration_ms : {60, 20}) {
+        size_t opus_size = 16000 / 8 * frame_duration_ms / 1000;
+        int frames = 60000 / frame_duration_ms;
+        for (int frames_per_packet : {1, 2, 3}) {
+            AudioLatencyTracker tracker;
+            AudioSendScheduler scheduler(tracker, 1000, 64, 8, 3, 100);
+            FakeProtocol protocol(frames_per_packet);
+            int64_t start = NowNs();
+            for (int i = 0; i < frames; i++) {
+                scheduler.Push(Frame(i, opus_size, frame_duration_ms));
+                scheduler.Flush(protocol);
+            }
+            int64_t elapsed = NowNs() - start;
+            // The last frames of the minute go out alone once their budget runs out
+            std::this_thread::sleep_for(std::chrono::milliseconds(110));
+            scheduler.Flush(protocol);
+            CHECK(scheduler.Empty() && scheduler.statistics().sent == (uint32_t)frames);
+
+            size_t payload = 0;
+            for (auto& write : protocol.writes) {
+                payload += write.size();
+            }
+            size_t packets = protocol.writes.size();
+            printf("%d ms frames, %d per packet: %5.1f packets/s, %4zu B/s over UDP, %4zu B/s over WebSocket, "
+                "%lld ns per frame\n", frame_duration_ms, frames_per_packet, packets / 60.0,
+                (payload + packets * kUdpOverheadBytes) / 60, (payload + packets * kWebsocketOverheadBytes) / 60,
+                (long long)(elapsed / frames));
+        }
+    }
+}
+
+int main() {
+    TestAggregation();
+    TestBudget();
+    TestPacketBoundaries();
+    TestRetryAndDeadline();
+    TestBandwidthBenchmark();
+    return TestResult();
+}
@@ -0,0 +1,150 @@
+#include "pcm_kernels.h"
+#include "host_test.h"
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_CYCLE_COUNTER 1
+#endif
+
+/*
+ * Stand-in for OpusResampler, which wraps the libopus resampler and is not built on the host:
+ * the same interface, averaging each group of input samples. Both capture paths below use it,
+ * so the difference between them is the buffer handling around the resampler.
+ */
+class HostResampler {
+public:
+    void Configure(int input_sample_rate, int output_sample_rate) {
+        ratio_ = input_sample_rate / output_sample_rate;
+    }
+    int GetOutputSamples(int input_samples) const { return input_samples / ratio_; }
+    void Process(const int16_t* input, int input_samples, int16_t* output) {
+        for (int i = 0; i < input_samples / ratio_; i++) {
+            int32_t sum = 0;
+            for (int j = 0; j < ratio_; j++) {
+                sum += input[i * ratio_ + j];
+            }
+            output[i] = (int16_t)(sum / ratio_);
+        }
+    }
+
+private:
+    int ratio_ = 1;
+};
+
+// What the codec's InputData() hands over, the same samples on every call
+static void Capture(std::vector<int16_t>& buffer) {
+    static std::vector<int16_t> source = []() {
+        std::mt19937 random_engine(3);
+        std::vector<int16_t> samples(48000 * 2);
+        for (auto& sample : samples) {
+            sample = (int16_t)random_engine();
+        }
+        return samples;
+    }();
+    std::copy(source.begin(), source.begin() + buffer.size(), buffer.begin());
+}
+
+/* ReadAudioData() before the change: a new vector per step, scalar deinterleave and interleave */
+static __attribute__((noinline)) void ReadBefore(std::vector<int16_t>& data, int frames,
+    HostResampler& input_resampler, HostResampler& reference_resampler) {
+    data.resize(frames * 2);
+    Capture(data);
+    auto mic_channel = std::vector<int16_t>(data.size() / 2);
+    auto reference_channel = std::vector<int16_t>(data.size() / 2);
+    for (size_t i = 0, j = 0; i < mic_channel.size(); ++i, j += 2) {
+        mic_channel[i] = data[j];
+        reference_channel[i] = data[j + 1];
+    }
+    auto resampled_mic = std::vector<int16_t>(input_resampler.GetOutputSamples(mic_channel.size()));
+    auto resampled_reference = std::vector<int16_t>(reference_resampler.GetOutputSamples(reference_channel.size()));
+    input_resampler.Process(mic_channel.data(), mic_channel.size(), resampled_mic.data());
+    reference_resampler.Process(reference_channel.data(), reference_channel.size(), resampled_reference.data());
+    data.resize(resampled_mic.size() + resampled_reference.size());
+    for (size_t i = 0, j = 0; i < resampled_mic.size(); ++i, j += 2) {
+        data[j] = resampled_mic[i];
+        data[j + 1] = resampled_reference[i];
+    }
+}
+
+struct CaptureBuffers {
+    std::vector<int16_t> capture;
+    std::vector<int16_t> planar;
+    std::vector<int16_t> resampled;
+};
+
+/* ReadAudioData() now: persistent scratch buffers and the stereo kernels */
+static __attribute__((noinline)) void ReadAfter(std::vector<int16_t>& data, int frames, CaptureBuffers& buffers,
+    HostResampler& input_resampler, HostResampler& reference_resampler) {
+    buffers.capture.resize(frames * 2);
+    Capture(buffers.capture);
+    int output_frames = input_resampler.GetOutputSamples(frames);
+    buffers.planar.resize(frames * 2);
+    buffers.resampled.resize(output_frames * 2);
+    int16_t* mic = buffers.planar.data();
+    int16_t* reference = mic + frames;
+    int16_t* resampled_mic = buffers.resampled.data();
+    int16_t* resampled_reference = resampled_mic + output_frames;
+    PcmDeinterleaveStereo(buffers.capture.data(), mic, reference, frames);
+    input_resampler.Process(mic, frames, resampled_mic);
+    reference_resampler.Process(reference, frames, resampled_reference);
+    data.resize(output_frames * 2);
+    PcmInterleaveStereo(resampled_mic, resampled_reference, data.data(), output_frames);
+}
+
+static inline int64_t Cycles() {
+#if HAVE_CYCLE_COUNTER
+    return (int64_t)__rdtsc();
+#else
+    return NowNs();
+#endif
+}
+
+/*
+ * A 48 kHz stereo codec with reference input feeding 16 kHz: 60 ms frames for the encoder and the
+ * 512 sample chunks of the AFE. Both paths see the same samples, so their output must match.
+ */
+static void TestStereoCapture() {
+    for (int samples : {960, 512, 320}) {
+        int frames = samples * 3;
+        HostResampler before_mic, before_reference, after_mic, after_reference;
+        for (auto* resampler : {&before_mic, &before_reference, &after_mic, &after_reference}) {
+            resampler->Configure(48000, 16000);
+        }
+        CaptureBuffers buffers;
+        std::vector<int16_t> before, after;
+
+        const int rounds = 5000;
+        std::vector<int64_t> before_cycles, after_cycles;
+        for (int i = 0; i < rounds; i++) {
+            // Persistent output, as AudioInputTask keeps it now. The old task made a new one per frame.
+            std::vector<int16_t> fresh;
+            int64_t start = Cycles();
+            ReadBefore(fresh, frames, before_mic, before_reference);
+            int64_t middle = Cycles();
+            ReadAfter(after, frames, buffers, after_mic, after_reference);
+            int64_t end = Cycles();
+            before_cycles.push_back(middle - start);
+            after_cycles.push_back(end - middle);
+            before = std::move(fresh);
+        }
+        CHECK(before == after);
+        CHECK(after.size() == (size_t)samples * 2);
+        printf("%d samples at 16 kHz from 48 kHz stereo: p50 before %lld, after %lld %s per frame\n", samples,
+            (long long)Median(before_cycles), (long long)Median(after_cycles),
+#if HAVE_CYCLE_COUNTER
+            "TSC cycles"
+#else
+            "ns"
+#endif
+        );
+    }
+}
+
+int main() {
+    TestStereoCapture();
+    return TestResult();
+}
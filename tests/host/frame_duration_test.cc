@@ -0,0 +1,122 @@
+#include "pcm_ring.h"
+#include "spsc_queue.h"
+#include "audio_task.h"
+#include "protocol.h"
+#include "host_test.h"
+
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+static const int kSampleRate = 16000;
+// The AFE hands out 512 sample chunks, one every 32 ms
+static const size_t kChunkSamples = 512;
+// MQTT + UDP: the 16 byte audio header plus IPv4 and UDP
+static const int kUdpOverheadBytes = 16 + 28;
+
+struct FramingDelay {
+    double average_ms = 0;
+    double max_ms = 0;
+};
+
+/*
+ * How long captured audio waits for its frame to fill, the part of the mouth-to-wire latency that
+ * the frame duration sets. Chunks arrive when their last sample is captured, a frame leaves with
+ * the chunk that completes it. Simulated over a minute of audio through the PcmRing framer the
+ * audio processor uses.
+ */
+static FramingDelay MeasureFramingDelay(int frame_duration_ms) {
+    size_t frame_samples = kSampleRate * frame_duration_ms / 1000;
+    PcmRing ring(frame_samples + kChunkSamples);
+    std::vector<int16_t> chunk(kChunkSamples);
+    std::vector<int16_t> frame;
+    size_t captured = 0;
+    size_t framed = 0;
+    double total_ms = 0;
+    FramingDelay delay;
+    while (captured < (size_t)kSampleRate * 60) {
+        ring.Push(chunk.data(), chunk.size());
+        captured += kChunkSamples;
+        double now_ms = captured * 1000.0 / kSampleRate;
+        while (ring.PopFrame(frame, frame_samples)) {
+            for (size_t i = 0; i < frame_samples; i++) {
+                total_ms += now_ms - (framed + i) * 1000.0 / kSampleRate;
+            }
+            delay.max_ms = std::max(delay.max_ms, now_ms - framed * 1000.0 / kSampleRate);
+            framed += frame_samples;
+        }
+    }
+    delay.average_ms = total_ms / framed;
+    return delay;
+}
+
+/*
+ * The per-frame work around the encoder, for a minute of audio: a pooled AudioTask cut from the
+ * ring, the encode queue, a pooled packet of the size a 16 kbps frame encodes to, the send queue.
+ * libopus is not built on the host, so the encoder itself is not part of it.
+ */
+static int64_t MeasurePipelineUs(int frame_duration_ms) {
+    size_t frame_samples = kSampleRate * frame_duration_ms / 1000;
+    size_t opus_bytes = 16000 / 8 * frame_duration_ms / 1000;
+    PcmRing ring(frame_samples + kChunkSamples);
+    SpscQueue<std::unique_ptr<AudioTask>> encode_queue(2);
+    SpscQueue<std::unique_ptr<AudioStreamPacket>> send_queue(2);
+    std::vector<int16_t> chunk(kChunkSamples);
+    size_t frames = 0;
+
+    int64_t start = NowUs();
+    for (size_t captured = 0; captured < (size_t)kSampleRate * 60; captured += kChunkSamples) {
+        ring.Push(chunk.data(), chunk.size());
+        while (ring.size() >= frame_samples) {
+            auto task = std::make_unique<AudioTask>();
+            task->type = kAudioTaskTypeEncodeToSendQueue;
+            task->pcm = AudioPool::TakePcm();
+            ring.PopFrame(task->pcm, frame_samples);
+            encode_queue.Push(std::move(task));
+
+            encode_queue.Pop(task);
+            auto packet = std::make_unique<AudioStreamPacket>();
+            packet->frame_duration = frame_duration_ms;
+            packet->payload = AudioPool::TakePayload();
+            packet->payload.resize(AUDIO_PACKET_HEADROOM + opus_bytes);
+            packet->headroom = AUDIO_PACKET_HEADROOM;
+            send_queue.Push(std::move(packet));
+            task.reset();
+
+            send_queue.Pop(packet);
+            frames++;
+        }
+    }
+    int64_t elapsed = NowUs() - start;
+    CHECK(frames == (size_t)kSampleRate * 60 / frame_samples);
+    return elapsed;
+}
+
+static void TestFramingDelay() {
+    auto delay_20 = MeasureFramingDelay(20);
+    auto delay_60 = MeasureFramingDelay(60);
+    // Every sample waits at least for the rest of its chunk, and at most for a chunk plus a frame
+    CHECK(delay_20.average_ms > 0 && delay_20.average_ms < delay_60.average_ms);
+    CHECK(delay_60.max_ms <= 60 + 32);
+}
+
+static void TestLatencyVersusCost() {
+    for (int frame_duration_ms : {20, 40, 60}) {
+        auto delay = MeasureFramingDelay(frame_duration_ms);
+        std::vector<int64_t> times;
+        for (int round = 0; round < 5; round++) {
+            times.push_back(MeasurePipelineUs(frame_duration_ms));
+        }
+        double packets_per_second = 1000.0 / frame_duration_ms;
+        printf("%d ms frames: framing delay average %.1f ms, max %.1f ms; %.1f packets/s, "
+            "%.0f B/s UDP overhead; host pipeline %lld us per minute of audio\n", frame_duration_ms,
+            delay.average_ms, delay.max_ms, packets_per_second, packets_per_second * kUdpOverheadBytes,
+            (long long)Median(times));
+    }
+}
+
+int main() {
+    TestFramingDelay();
+    TestLatencyVersusCost();
+    return TestResult();
+}
@@ -0,0 +1,44 @@
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// Shared by the host tests: a failing CHECK is printed and counted, main() returns TestResult()
+static int failures = 0;
+
+#define CHECK(condition) do { \
+        if (!(condition)) { \
+            printf("%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while (0)
+
+static inline int TestResult() {
+    if (failures > 0) {
+        printf("%d failures\n", failures);
+        return 1;
+    }
+    printf("All tests passed\n");
+    return 0;
+}
+
+static inline int64_t NowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static inline int64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static inline int64_t Median(std::vector<int64_t> values) {
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+#endif // HOST_TEST_H
@@ -0,0 +1,391 @@
+#include "http_connection.h"
+#include "host_test.h"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+// Time the stand-in server spends on every new connection, in place of the TCP and TLS setup
+#define SETUP_DELAY_MS 40
+
+struct ReceivedRequest {
+    std::string method;
+    std::string path;
+    std::map<std::string, std::string> headers;
+    std::string body;
+};
+
+/*
+ * Local HTTP/1.1 server with a thread per connection. It counts accepted connections and answers
+ * by path:
+ *   /keep       Content-Length body, connection kept
+ *   /chunked    chunked body, connection kept
+ *   /close      Content-Length body with Connection: close
+ *   /big        body larger than a receive buffer
+ *   /huge       announces a body of exabytes, sends a few bytes and closes
+ *   /echo       the request body back
+ *   /hangup     answers, then closes the connection while it is idle
+ *   /vanish     closes without answering when it is not the first request of the connection
+ */
+class StandInServer {
+public:
+    StandInServer() {
+        listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+        int on = 1;
+        setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        bind(listen_fd_, (sockaddr*)&addr, sizeof(addr));
+        listen(listen_fd_, 8);
+        socklen_t len = sizeof(addr);
+        getsockname(listen_fd_, (sockaddr*)&addr, &len);
+        port_ = ntohs(addr.sin_port);
+        accept_thread_ = std::thread([this]() { AcceptLoop(); });
+    }
+
+    ~StandInServer() {
+        stopping_ = true;
+        shutdown(listen_fd_, SHUT_RDWR);
+        close(listen_fd_);
+        accept_thread_.join();
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (int fd : connections_) {
+            shutdown(fd, SHUT_RDWR);
+        }
+        for (auto& thread : threads_) {
+            thread.detach();
+        }
+    }
+
+    int port() const { return port_; }
+    int accepts() const { return accepts_; }
+
+    ReceivedRequest last_request() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return last_request_;
+    }
+
+private:
+    int listen_fd_;
+    int port_;
+    std::atomic<int> accepts_{0};
+    std::atomic<bool> stopping_{false};
+    std::thread accept_thread_;
+    std::mutex mutex_;
+    std::vector<std::thread> threads_;
+    std::vector<int> connections_;
+    ReceivedRequest last_request_;
+
+    void AcceptLoop() {
+        while (!stopping_) {
+            int fd = accept(listen_fd_, nullptr, nullptr);
+            if (fd < 0) {
+                return;
+            }
+            accepts_++;
+            std::lock_guard<std::mutex> lock(mutex_);
+            connections_.push_back(fd);
+            threads_.emplace_back([this, fd]() { Serve(fd); });
+        }
+    }
+
+    static bool ReadRequest(int fd, std::string& buffer, ReceivedRequest& request) {
+        size_t end;
+        while ((end = buffer.find("\r\n\r\n")) == std::string::npos) {
+            char data[1024];
+            int ret = recv(fd, data, sizeof(data), 0);
+            if (ret <= 0) {
+                return false;
+            }
+            buffer.append(data, ret);
+        }
+        std::string head = buffer.substr(0, end);
+        buffer.erase(0, end + 4);
+
+        size_t line_end = head.find("\r\n");
+        std::string request_line = head.substr(0, line_end);
+        size_t space = request_line.find(' ');
+        request.method = request_line.substr(0, space);
+        request.path = request_line.substr(space + 1, request_line.find(' ', space + 1) - space - 1);
+        request.headers.clear();
+        while (line_end != std::string::npos) {
+            size_t start = line_end + 2;
+            line_end = head.find("\r\n", start);
+            std::string line = head.substr(start, line_end == std::string::npos ? std::string::npos : line_end - start);
+            size_t colon = line.find(':');
+            if (colon != std::string::npos) {
+                request.headers[line.substr(0, colon)] = line.substr(colon + 2);
+            }
+        }
+
+        size_t length = 0;
+        if (request.headers.count("Content-Length")) {
+            length = std::stoul(request.headers["Content-Length"]);
+        }
+        while (buffer.size() < length) {
+            char data[1024];
+            int ret = recv(fd, data, sizeof(data), 0);
+            if (ret <= 0) {
+                return false;
+            }
+            buffer.append(data, ret);
+        }
+        request.body = buffer.substr(0, length);
+        buffer.erase(0, length);
+        return true;
+    }
+
+    static void SendAll(int fd, const std::string& data) {
+        size_t sent = 0;
+        while (sent < data.size()) {
+            int ret = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (ret <= 0) {
+                return;
+            }
+            sent += ret;
+        }
+    }
+
+    static std::string Response(const std::string& body, const std::string& extra_headers = "") {
+        return "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\n" + extra_headers +
+            "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+    }
+
+    void Serve(int fd) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(SETUP_DELAY_MS));
+        std::string buffer;
+        ReceivedRequest request;
+        int requests = 0;
+        while (ReadRequest(fd, buffer, request)) {
+            requests++;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                last_request_ = request;
+            }
+            if (request.path == "/keep") {
+                SendAll(fd, Response("hello"));
+            } else if (request.path == "/chunked") {
+                SendAll(fd, "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+                    "5;name=value\r\nhello\r\n7\r\n, world\r\n0\r\nTrailer: yes\r\n\r\n");
+            } else if (request.path == "/close") {
+                SendAll(fd, Response("bye", "Connection: close\r\n"));
+                break;
+            } else if (request.path == "/big") {
+                SendAll(fd, Response(std::string(5000, 'x')));
+            } else if (request.path == "/huge") {
+                SendAll(fd, "HTTP/1.1 200 OK\r\nContent-Length: 9000000000000000000\r\n\r\nhello");
+                break;
+            } else if (request.path == "/echo") {
+                SendAll(fd, Response(request.body));
+            } else if (request.path == "/hangup") {
+                SendAll(fd, Response("hello"));
+                break;
+            } else if (request.path == "/vanish") {
+                if (requests > 1) {
+                    break;
+                }
+                SendAll(fd, Response("hello"));
+            } else {
+                SendAll(fd, "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n");
+            }
+        }
+        close(fd);
+    }
+};
+
+static std::unique_ptr<HttpConnection> NewConnection(StandInServer& server) {
+    return std::make_unique<HttpConnection>(std::make_unique<TcpTransport>(), "127.0.0.1", server.port(), 2000);
+}
+
+static void TestParseUrl() {
+    bool tls;
+    std::string host;
+    int port;
+    std::string path;
+    CHECK(HttpConnection::ParseUrl("https://api.example.com/v1?q=1#top", tls, host, port, path));
+    CHECK(tls && host == "api.example.com" && port == 443 && path == "/v1?q=1");
+    CHECK(HttpConnection::ParseUrl("http://localhost:8080", tls, host, port, path));
+    CHECK(!tls && host == "localhost" && port == 8080 && path == "/");
+    CHECK(HttpConnection::ParseUrl("https://api.duckduckgo.com/?q=a&format=json", tls, host, port, path));
+    CHECK(host == "api.duckduckgo.com" && path == "/?q=a&format=json");
+    CHECK(!HttpConnection::ParseUrl("ftp://example.com/", tls, host, port, path));
+    CHECK(!HttpConnection::ParseUrl("example.com/", tls, host, port, path));
+}
+
+// Requests in a row share one connection, which skips the setup every fresh connection pays
+static void TestReuseSavesSetup() {
+    StandInServer server;
+    const int requests = 5;
+
+    std::vector<int64_t> fresh;
+    for (int i = 0; i < requests; i++) {
+        auto connection = NewConnection(server);
+        int64_t start = NowUs();
+        CHECK(connection->Open("GET", "/keep"));
+        CHECK(connection->ReadAll() == "hello");
+        fresh.push_back(NowUs() - start);
+        CHECK(!connection->reused());
+    }
+    CHECK(server.accepts() == requests);
+
+    auto connection = NewConnection(server);
+    std::vector<int64_t> reused;
+    for (int i = 0; i < requests; i++) {
+        int64_t start = NowUs();
+        CHECK(connection->Open("GET", "/keep"));
+        CHECK(connection->status_code() == 200);
+        CHECK(connection->ReadAll() == "hello");
+        int64_t elapsed = NowUs() - start;
+        CHECK(connection->reusable());
+        CHECK(connection->reused() == (i > 0));
+        if (i > 0) {
+            reused.push_back(elapsed);
+        }
+    }
+    CHECK(server.accepts() == requests + 1);
+    CHECK(connection->connects() == 1);
+
+    int64_t fresh_p50 = Median(fresh);
+    int64_t reused_p50 = Median(reused);
+    printf("fresh connection p50 %lld us, reused connection p50 %lld us\n", (long long)fresh_p50, (long long)reused_p50);
+    CHECK(fresh_p50 >= SETUP_DELAY_MS * 1000);
+    CHECK(reused_p50 < SETUP_DELAY_MS * 1000 / 2);
+}
+
+// Headers and content of one request never leak into the next one on the same connection
+static void TestHeadersArePerRequest() {
+    StandInServer server;
+    auto connection = NewConnection(server);
+
+    connection->SetHeader("Content-Type", "application/json");
+    connection->SetHeader("apiKey", "secret");
+    connection->SetContent("{\"limit\":5}");
+    CHECK(connection->Open("POST", "/echo"));
+    CHECK(connection->ReadAll() == "{\"limit\":5}");
+    auto request = server.last_request();
+    CHECK(request.method == "POST");
+    CHECK(request.headers["apiKey"] == "secret");
+    CHECK(request.headers["Content-Length"] == "11");
+
+    connection->SetHeader("Accept", "application/json");
+    CHECK(connection->Open("GET", "/keep"));
+    CHECK(connection->ReadAll() == "hello");
+    CHECK(connection->reused());
+    request = server.last_request();
+    CHECK(request.method == "GET");
+    CHECK(request.headers.count("apiKey") == 0);
+    CHECK(request.headers.count("Content-Type") == 0);
+    CHECK(request.headers.count("Content-Length") == 0);
+    CHECK(request.headers["Accept"] == "application/json");
+    CHECK(request.body.empty());
+}
+
+static void TestConnectionClose() {
+    StandInServer server;
+    auto connection = NewConnection(server);
+    CHECK(connection->Open("GET", "/close"));
+    CHECK(connection->ReadAll() == "bye");
+    CHECK(!connection->reusable());
+
+    CHECK(connection->Open("GET", "/keep"));
+    CHECK(!connection->reused());
+    CHECK(connection->ReadAll() == "hello");
+    CHECK(server.accepts() == 2);
+}
+
+static void TestUnreadBodyIsNotKept() {
+    StandInServer server;
+    auto connection = NewConnection(server);
+    CHECK(connection->Open("GET", "/big"));
+    char buffer[100];
+    CHECK(connection->Read(buffer, sizeof(buffer)) == sizeof(buffer));
+    CHECK(!connection->body_complete());
+    CHECK(!connection->reusable());
+
+    CHECK(connection->Open("GET", "/big"));
+    CHECK(!connection->reused());
+    CHECK(connection->ReadAll().size() == 5000);
+    CHECK(connection->reusable());
+    CHECK(server.accepts() == 2);
+}
+
+// Only what arrives is allocated, not what the Content-Length claims
+static void TestHugeContentLength() {
+    StandInServer server;
+    auto connection = NewConnection(server);
+    CHECK(connection->Open("GET", "/huge"));
+    CHECK(connection->body_length() == 9000000000000000000);
+    CHECK(connection->ReadAll() == "hello");
+    CHECK(!connection->body_complete());
+    CHECK(!connection->reusable());
+}
+
+static void TestChunkedBody() {
+    StandInServer server;
+    auto connection = NewConnection(server);
+    CHECK(connection->Open("GET", "/chunked"));
+    CHECK(connection->body_length() == -1);
+    CHECK(connection->ReadAll() == "hello, world");
+    CHECK(connection->reusable());
+
+    CHECK(connection->Open("GET", "/keep"));
+    CHECK(connection->reused());
+    CHECK(connection->ReadAll() == "hello");
+    CHECK(server.accepts() == 1);
+}
+
+// The server closed the kept connection while it was idle, it is noticed before sending
+static void TestIdleConnectionClosedByServer() {
+    StandInServer server;
+    auto connection = NewConnection(server);
+    CHECK(connection->Open("GET", "/hangup"));
+    CHECK(connection->ReadAll() == "hello");
+    CHECK(connection->reusable());
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    CHECK(connection->Open("GET", "/keep"));
+    CHECK(!connection->reused());
+    CHECK(connection->ReadAll() == "hello");
+    CHECK(server.accepts() == 2);
+}
+
+// The server dropped the kept connection on receiving the request, it is sent again on a new one
+static void TestRequestRetriedOnNewConnection() {
+    StandInServer server;
+    auto connection = NewConnection(server);
+    CHECK(connection->Open("GET", "/vanish"));
+    CHECK(connection->ReadAll() == "hello");
+
+    CHECK(connection->Open("GET", "/vanish"));
+    CHECK(!connection->reused());
+    CHECK(connection->status_code() == 200);
+    CHECK(connection->ReadAll() == "hello");
+    CHECK(server.accepts() == 2);
+}
+
+int main() {
+    TestParseUrl();
+    TestReuseSavesSetup();
+    TestHeadersArePerRequest();
+    TestConnectionClose();
+    TestUnreadBodyIsNotKept();
+    TestHugeContentLength();
+    TestChunkedBody();
+    TestIdleConnectionClosedByServer();
+    TestRequestRetriedOnNewConnection();
+    return TestResult();
+}
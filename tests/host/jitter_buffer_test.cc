@@ -0,0 +1,118 @@
+#include "jitter_buffer.h"
+#include "host_test.h"
+
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+static const int64_t kFrameUs = 60 * 1000;
+
+static std::unique_ptr<AudioStreamPacket> Packet(uint32_t sequence) {
+    auto packet = std::make_unique<AudioStreamPacket>();
+    packet->sequence = sequence;
+    packet->frame_duration = 60;
+    packet->timestamp = sequence;
+    return packet;
+}
+
+// Puts the sequences one frame apart, as a steady sender would
+static int64_t PutAll(JitterBuffer& buffer, const std::vector<uint32_t>& sequences, int64_t now_us) {
+    for (auto sequence : sequences) {
+        buffer.Put(Packet(sequence), now_us);
+        now_us += kFrameUs;
+    }
+    return now_us;
+}
+
+// Plays until the buffer has nothing more to give, lost packets are recorded as 0
+static std::vector<uint32_t> PlayAll(JitterBuffer& buffer, int64_t now_us) {
+    std::vector<uint32_t> played;
+    for (int i = 0; i < 100 && !buffer.Empty(); i++) {
+        std::unique_ptr<AudioStreamPacket> packet;
+        auto result = buffer.Get(packet, now_us);
+        if (result == kJitterBufferPacketReady) {
+            played.push_back(packet->sequence);
+        } else if (result == kJitterBufferPacketLost) {
+            played.push_back(0);
+        }
+        now_us += kFrameUs;
+    }
+    return played;
+}
+
+static void TestReorderAndLate() {
+    JitterBuffer buffer(16, 600);
+    int64_t now = PutAll(buffer, {10, 12, 11, 13}, 0);
+    CHECK(PlayAll(buffer, now) == std::vector<uint32_t>({10, 11, 12, 13}));
+
+    // Behind the playback position: late, and a second copy is a duplicate
+    CHECK(!buffer.Put(Packet(12), now));
+    CHECK(buffer.Put(Packet(14), now));
+    CHECK(!buffer.Put(Packet(14), now));
+    auto& stats = buffer.statistics();
+    CHECK(stats.late == 1 && stats.duplicated == 1 && stats.lost == 0 && stats.dropped == 0);
+}
+
+static void TestMissingPacketConcealed() {
+    JitterBuffer buffer(16, 600);
+    int64_t now = PutAll(buffer, {1, 2, 4, 5}, 0);
+    CHECK(PlayAll(buffer, now) == std::vector<uint32_t>({1, 2, 0, 4, 5}));
+    CHECK(buffer.statistics().lost == 1 && buffer.statistics().concealed == 1);
+}
+
+static void TestUnsequencedFifo() {
+    JitterBuffer buffer(16, 600);
+    for (int i = 0; i < 5; i++) {
+        CHECK(buffer.Put(Packet(0), 0));
+    }
+    CHECK(PlayAll(buffer, 0) == std::vector<uint32_t>({1, 2, 3, 4, 5}));
+}
+
+/*
+ * A new session (MQTT reconnect, server restart) numbering its packets a few below where the old
+ * one stopped. Without a reset they are taken for late packets, after Reset() they start the stream.
+ */
+static void TestRestartedStream() {
+    JitterBuffer buffer(16, 600);
+    int64_t now = PutAll(buffer, {100, 101, 102, 103}, 0);
+    PlayAll(buffer, now);
+
+    CHECK(!buffer.Put(Packet(95), now));
+    CHECK(buffer.statistics().late == 1);
+
+    buffer.Reset();
+    now = PutAll(buffer, {95, 96, 97}, now);
+    CHECK(PlayAll(buffer, now) == std::vector<uint32_t>({95, 96, 97}));
+    CHECK(buffer.statistics().late == 1);
+    CHECK(buffer.statistics().lost == 0);
+}
+
+// Jumping ahead by more than the capacity gives up the oldest slots: received ones are dropped, empty ones lost
+static void TestSkipCounts() {
+    JitterBuffer buffer(16, 600);
+    int64_t now = PutAll(buffer, {1, 2, 3}, 0);
+
+    // 17 needs slot 1: packet 1 is dropped
+    CHECK(buffer.Put(Packet(17), now));
+    CHECK(buffer.statistics().dropped == 1 && buffer.statistics().lost == 0);
+
+    // 20 needs slots 2 to 4: packets 2 and 3 are dropped, 4 never came
+    CHECK(buffer.Put(Packet(20), now));
+    CHECK(buffer.statistics().dropped == 3 && buffer.statistics().lost == 1);
+    CHECK(buffer.Size() == 2);
+
+    // The gap from 5 to 16 is concealed on playback, and counted lost there
+    auto played = PlayAll(buffer, now);
+    CHECK(played.size() == 16);
+    CHECK(played[12] == 17 && played[15] == 20);
+    CHECK(buffer.statistics().lost == 1 + 14 && buffer.statistics().dropped == 3);
+}
+
+int main() {
+    TestReorderAndLate();
+    TestMissingPacketConcealed();
+    TestUnsequencedFifo();
+    TestRestartedStream();
+    TestSkipCounts();
+    return TestResult();
+}
@@ -0,0 +1,82 @@
+#include "latency_histogram.h"
+#include "audio_latency.h"
+#include "host_test.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+// A percentile is the middle of its bucket, an eighth of the value wide at most
+static bool Near(uint32_t reported, uint32_t value) {
+    return std::abs((int64_t)reported - (int64_t)value) <= value / 8 + 8;
+}
+
+static void TestSingleValues() {
+    for (uint32_t us : {0u, 5u, 40u, 64u, 100u, 999u, 4096u, 65537u, 1000000u, 7000000u}) {
+        LatencyHistogram histogram;
+        histogram.Add(us);
+        CHECK(histogram.count() == 1 && histogram.max() == us);
+        // Never above the largest value seen
+        CHECK(histogram.Percentile(50) <= us);
+        CHECK(Near(histogram.Percentile(50), us));
+        CHECK(histogram.Percentile(99) == histogram.Percentile(50));
+    }
+
+    // Beyond ~8 s everything lands in the last bucket, only the maximum stays exact
+    LatencyHistogram histogram;
+    histogram.Add(60000000);
+    CHECK(histogram.Percentile(50) > 7000000 && histogram.Percentile(50) < 60000000);
+    CHECK(histogram.max() == 60000000);
+}
+
+static void TestDistribution() {
+    LatencyHistogram histogram;
+    CHECK(histogram.Percentile(50) == 0);
+    // 1 to 1000 ms, one of each
+    for (uint32_t ms = 1; ms <= 1000; ms++) {
+        histogram.Add(ms * 1000);
+    }
+    CHECK(histogram.count() == 1000 && histogram.max() == 1000000);
+    CHECK(Near(histogram.Percentile(50), 500000));
+    CHECK(Near(histogram.Percentile(95), 950000));
+    CHECK(Near(histogram.Percentile(99), 990000));
+    CHECK(Near(histogram.Percentile(100), 1000000) && histogram.Percentile(100) <= histogram.max());
+
+    histogram.Reset();
+    CHECK(histogram.count() == 0 && histogram.max() == 0 && histogram.Percentile(99) == 0);
+}
+
+/*
+ * The wake_to_open stage, as Application records it: detection to channel open, measured on the
+ * 32-bit microsecond clock, which may wrap in between. A detection time of 0 is not traced.
+ */
+static void TestWakeToOpen() {
+    AudioLatencyTracker tracker;
+    tracker.TraceWakeToOpen(0, 500000);
+    CHECK(tracker.GetStatistics(kLatencyStageWakeToOpen).count == 0);
+
+    // A warm connection is attached within tens of milliseconds, a cold one needs the handshakes
+    for (int i = 0; i < 90; i++) {
+        tracker.TraceWakeToOpen(1000000, 1000000 + 40000 + i * 100);
+    }
+    for (int i = 0; i < 10; i++) {
+        tracker.TraceWakeToOpen(0xFFFFFF00u, 0xFFFFFF00u + 900000 + i * 10000);
+    }
+    auto stats = tracker.GetStatistics(kLatencyStageWakeToOpen);
+    CHECK(stats.count == 100);
+    CHECK(Near(stats.p50_us, 44500));
+    CHECK(Near(stats.p95_us, 940000));
+    CHECK(stats.max_us == 990000 && stats.p99_us <= stats.max_us);
+    CHECK(tracker.GetStatistics(kLatencyStageUplink).count == 0);
+    CHECK(AudioLatencyTracker::StageName(kLatencyStageWakeToOpen) == std::string("wake_to_open"));
+
+    tracker.Reset();
+    CHECK(tracker.GetStatistics(kLatencyStageWakeToOpen).count == 0);
+}
+
+int main() {
+    TestSingleValues();
+    TestDistribution();
+    TestWakeToOpen();
+    return TestResult();
+}
@@ -0,0 +1,166 @@
+#include "ogg_demuxer.h"
+#include "host_test.h"
+#include "ogg_test_stream.h"
+
+#include <cstdio>
+#include <vector>
+
+// Start of every page in the stream
+static std::vector<size_t> PageOffsets(const std::vector<uint8_t>& stream) {
+    std::vector<size_t> offsets;
+    size_t pos = 0;
+    while (pos + 27 <= stream.size()) {
+        offsets.push_back(pos);
+        size_t count = stream[pos + 26];
+        size_t page_size = 27 + count;
+        for (size_t i = 0; i < count; i++) {
+            page_size += stream[pos + 27 + i];
+        }
+        pos += page_size;
+    }
+    return offsets;
+}
+
+// Feeds the stream in chunks of chunk_size bytes and collects the packets handed out
+static std::vector<Packet> Demux(OggDemuxer& demuxer, const std::vector<uint8_t>& stream, size_t chunk_size) {
+    std::vector<Packet> received;
+    for (size_t pos = 0; pos < stream.size(); pos += chunk_size) {
+        size_t n = std::min(chunk_size, stream.size() - pos);
+        demuxer.Feed(stream.data() + pos, n, [&received](const uint8_t* data, size_t size) {
+            received.emplace_back(data, data + size);
+            return true;
+        });
+    }
+    return received;
+}
+
+static void TestHeadersSkipped() {
+    std::vector<Packet> audio = {AudioPacket(1, 60), AudioPacket(2, 80), AudioPacket(3, 1)};
+    OggDemuxer demuxer;
+    auto received = Demux(demuxer, MakeStream(WithHeaders(audio, 24000)), 4096);
+    CHECK(received == audio);
+    CHECK(demuxer.sample_rate() == 24000);
+    CHECK(demuxer.channels() == 1);
+}
+
+// Every chunk size from a single byte up splits the pages at every possible place
+static void TestPageSplitAcrossFeeds() {
+    std::vector<Packet> audio;
+    for (int i = 0; i < 20; i++) {
+        audio.push_back(AudioPacket(i, 20 + i * 7));
+    }
+    auto stream = MakeStream(WithHeaders(audio), 6);
+    for (size_t chunk_size = 1; chunk_size <= 64; chunk_size++) {
+        OggDemuxer demuxer;
+        auto received = Demux(demuxer, stream, chunk_size);
+        if (received != audio) {
+            printf("chunk size %zu: %zu packets received\n", chunk_size, received.size());
+            failures++;
+        }
+    }
+}
+
+static void TestPacketContinuedAcrossPages() {
+    // 255 * 2 ends with a zero lacing value, 600 spans three pages of two segments
+    std::vector<Packet> audio = {AudioPacket(1, 510), AudioPacket(2, 600), AudioPacket(3, 40)};
+    auto stream = MakeStream(WithHeaders(audio), 2);
+    for (size_t chunk_size : {1, 100, 4096}) {
+        OggDemuxer demuxer;
+        CHECK(Demux(demuxer, stream, chunk_size) == audio);
+    }
+}
+
+static void TestGarbageAndTruncation() {
+    std::vector<Packet> audio = {AudioPacket(1, 50), AudioPacket(2, 50), AudioPacket(3, 50)};
+    auto stream = MakeStream(WithHeaders(audio), 1);
+
+    // Garbage and partial capture patterns before the first page
+    std::vector<uint8_t> noisy = {'x', 'O', 'g', 'O', 'O', 'g', 'g', 'x', 'O', 'g', 'g'};
+    noisy.insert(noisy.end(), stream.begin(), stream.end());
+    OggDemuxer demuxer;
+    CHECK(Demux(demuxer, noisy, 3) == audio);
+
+    // Cut in the middle of the last page, the packets before it still come out
+    std::vector<uint8_t> truncated(stream.begin(), stream.end() - 20);
+    OggDemuxer truncated_demuxer;
+    auto received = Demux(truncated_demuxer, truncated, 7);
+    CHECK(received.size() == 2);
+    CHECK(received[0] == audio[0] && received[1] == audio[1]);
+
+    // Losing the start of a packet skips the rest of it on the continued page
+    std::vector<Packet> long_audio = {AudioPacket(1, 700), AudioPacket(2, 30)};
+    auto long_stream = MakeStream(WithHeaders(long_audio), 2);
+    auto pages = PageOffsets(long_stream);
+    // Lacing 19 20 | 255 255 | 190 30: drop the page with the start of the long packet
+    CHECK(pages.size() == 3);
+    std::vector<uint8_t> joined(long_stream.begin(), long_stream.begin() + pages[1]);
+    joined.insert(joined.end(), long_stream.begin() + pages[2], long_stream.end());
+    OggDemuxer joined_demuxer;
+    auto joined_received = Demux(joined_demuxer, joined, 5);
+    CHECK(joined_received.size() == 1 && joined_received[0] == long_audio[1]);
+}
+
+static void TestStopAndReset() {
+    std::vector<Packet> audio = {AudioPacket(1, 50), AudioPacket(2, 50), AudioPacket(3, 50)};
+    auto stream = MakeStream(WithHeaders(audio));
+
+    OggDemuxer demuxer;
+    int count = 0;
+    bool result = demuxer.Feed(stream.data(), stream.size(), [&count](const uint8_t*, size_t) {
+        return ++count < 2;
+    });
+    CHECK(!result);
+    CHECK(count == 2);
+
+    // A new stream after Reset(), with a different sample rate, starting from scratch
+    demuxer.Reset();
+    auto received = Demux(demuxer, MakeStream(WithHeaders(audio, 16000)), 33);
+    CHECK(received == audio);
+    CHECK(demuxer.sample_rate() == 16000);
+
+    // Reset() in the middle of a page drops the half-read page
+    demuxer.Reset();
+    demuxer.Feed(stream.data(), stream.size() / 2, [](const uint8_t*, size_t) { return true; });
+    demuxer.Reset();
+    CHECK(Demux(demuxer, stream, 64) == audio);
+}
+
+// Demuxes a minute of 60 ms packets fed in 512 byte chunks, as the sound task reads them
+static void TestThroughput() {
+    std::vector<Packet> audio;
+    for (int i = 0; i < 1000; i++) {
+        audio.push_back(AudioPacket(i, 120 + i % 60));
+    }
+    auto stream = MakeStream(WithHeaders(audio), 64);
+
+    std::vector<int64_t> times;
+    for (int round = 0; round < 20; round++) {
+        OggDemuxer demuxer;
+        size_t packets = 0;
+        size_t bytes = 0;
+        int64_t start = NowUs();
+        for (size_t pos = 0; pos < stream.size(); pos += 512) {
+            size_t n = std::min<size_t>(512, stream.size() - pos);
+            demuxer.Feed(stream.data() + pos, n, [&packets, &bytes](const uint8_t*, size_t size) {
+                packets++;
+                bytes += size;
+                return true;
+            });
+        }
+        times.push_back(NowUs() - start);
+        CHECK(packets == audio.size());
+    }
+    int64_t p50 = std::max<int64_t>(Median(times), 1);
+    printf("demuxed %zu bytes, %zu packets: p50 %lld us, %.1f MB/s, %.0f ns per packet\n", stream.size(),
+        audio.size(), (long long)p50, stream.size() / (double)p50, p50 * 1000.0 / audio.size());
+}
+
+int main() {
+    TestHeadersSkipped();
+    TestPageSplitAcrossFeeds();
+    TestPacketContinuedAcrossPages();
+    TestGarbageAndTruncation();
+    TestStopAndReset();
+    TestThroughput();
+    return TestResult();
+}
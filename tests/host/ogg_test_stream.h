@@ -0,0 +1,85 @@
+#ifndef OGG_TEST_STREAM_H
+#define OGG_TEST_STREAM_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Builds Ogg/Opus streams for the host tests of the demuxer and the sound sources
+using Packet = std::vector<uint8_t>;
+
+static Packet OpusHead(int sample_rate) {
+    Packet head = {'O', 'p', 'u', 's', 'H', 'e', 'a', 'd', 1, 1, 0x38, 0x01};
+    for (int i = 0; i < 4; i++) {
+        head.push_back((sample_rate >> (8 * i)) & 0xFF);
+    }
+    head.insert(head.end(), {0, 0, 0});
+    return head;
+}
+
+static Packet OpusTags() {
+    Packet tags = {'O', 'p', 'u', 's', 'T', 'a', 'g', 's', 4, 0, 0, 0, 't', 'e', 's', 't', 0, 0, 0, 0};
+    return tags;
+}
+
+// Audio packet whose bytes tell its number and position apart
+static Packet AudioPacket(int number, size_t size) {
+    Packet packet(size);
+    for (size_t i = 0; i < size; i++) {
+        packet[i] = (uint8_t)(number * 31 + i);
+    }
+    return packet;
+}
+
+/*
+ * Lays the packets out in Ogg pages of at most max_segments lacing values each. A packet that does
+ * not fit continues on the next page, which is then flagged as continued. The CRC is left zero, the
+ * demuxer does not check it.
+ */
+static std::vector<uint8_t> MakeStream(const std::vector<Packet>& packets, size_t max_segments = 255) {
+    std::vector<uint8_t> lacing;
+    std::vector<uint8_t> body;
+    for (auto& packet : packets) {
+        size_t size = packet.size();
+        while (size >= 255) {
+            lacing.push_back(255);
+            size -= 255;
+        }
+        lacing.push_back(size);
+        body.insert(body.end(), packet.begin(), packet.end());
+    }
+
+    std::vector<uint8_t> stream;
+    size_t segment = 0;
+    size_t offset = 0;
+    uint32_t page_sequence = 0;
+    bool continued = false;
+    while (segment < lacing.size()) {
+        size_t count = std::min(max_segments, lacing.size() - segment);
+        size_t page_size = 0;
+        for (size_t i = 0; i < count; i++) {
+            page_size += lacing[segment + i];
+        }
+        uint8_t header[27] = {'O', 'g', 'g', 'S', 0};
+        header[5] = (continued ? 0x01 : 0) | (page_sequence == 0 ? 0x02 : 0);
+        memcpy(header + 18, &page_sequence, 4);
+        header[26] = count;
+        stream.insert(stream.end(), header, header + sizeof(header));
+        stream.insert(stream.end(), lacing.begin() + segment, lacing.begin() + segment + count);
+        stream.insert(stream.end(), body.begin() + offset, body.begin() + offset + page_size);
+        continued = lacing[segment + count - 1] == 255;
+        segment += count;
+        offset += page_size;
+        page_sequence++;
+    }
+    return stream;
+}
+
+static std::vector<Packet> WithHeaders(const std::vector<Packet>& audio, int sample_rate = 24000) {
+    std::vector<Packet> packets = {OpusHead(sample_rate), OpusTags()};
+    packets.insert(packets.end(), audio.begin(), audio.end());
+    return packets;
+}
+
+#endif // OGG_TEST_STREAM_H
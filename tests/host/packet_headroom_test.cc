@@ -0,0 +1,133 @@
+#include "protocol.h"
+#include "host_test.h"
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+// Counts heap allocations, the pools and the framing should not make any once warmed up
+static std::atomic<size_t> allocations{0};
+
+void* operator new(size_t size) {
+    allocations++;
+    void* ptr = malloc(size);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    free(ptr);
+}
+
+// A packet as the encoder leaves it: headroom, then the Opus data
+static std::unique_ptr<AudioStreamPacket> EncodedPacket(size_t headroom, size_t opus_size) {
+    auto packet = std::make_unique<AudioStreamPacket>();
+    packet->payload = AudioPool::TakePayload();
+    packet->payload.resize(headroom + opus_size);
+    for (size_t i = 0; i < opus_size; i++) {
+        packet->payload[headroom + i] = (uint8_t)i;
+    }
+    packet->headroom = headroom;
+    return packet;
+}
+
+static void TestPushHeader() {
+    auto packet = EncodedPacket(AUDIO_PACKET_HEADROOM, 100);
+    const uint8_t* storage = packet->payload.data();
+    uint8_t* header = packet->PushHeader(sizeof(BinaryProtocol3));
+    CHECK(header == storage + AUDIO_PACKET_HEADROOM - sizeof(BinaryProtocol3));
+    CHECK(packet->opus_size() == 100 && packet->opus_data()[99] == 99);
+    // A retry frames the packet again at the same place
+    CHECK(packet->PushHeader(sizeof(BinaryProtocol3)) == header);
+    CHECK(packet->PushHeader(sizeof(BinaryProtocol2)) == storage + AUDIO_PACKET_HEADROOM - sizeof(BinaryProtocol2));
+
+    // Without headroom, e.g. the wake word frames, the data moves once
+    auto bare = EncodedPacket(0, 100);
+    header = bare->PushHeader(sizeof(BinaryProtocol3));
+    CHECK(bare->headroom == sizeof(BinaryProtocol3) && header == bare->payload.data());
+    CHECK(bare->opus_size() == 100 && bare->opus_data()[0] == 0 && bare->opus_data()[99] == 99);
+    CHECK(bare->PushHeader(sizeof(BinaryProtocol3)) == header);
+}
+
+// Stands for websocket_->Send(), which reads the frame into its TLS record
+static uint32_t sent_checksum = 0;
+
+static void Send(const char* data, size_t size) {
+    sent_checksum += (uint8_t)data[0] + (uint8_t)data[size - 1] + size;
+}
+
+/* WebsocketProtocol::SendAudio() before, protocol version 3: a new string and a copy of the Opus data */
+static size_t SendCopied(AudioStreamPacket& packet) {
+    std::string serialized;
+    serialized.resize(sizeof(BinaryProtocol3) + packet.payload.size());
+    auto bp3 = (BinaryProtocol3*)serialized.data();
+    bp3->type = 0;
+    bp3->reserved = 0;
+    bp3->payload_size = htons(packet.payload.size());
+    memcpy(bp3->payload, packet.payload.data(), packet.payload.size());
+    Send(serialized.data(), serialized.size());
+    return packet.payload.size();
+}
+
+/* Now: the header goes into the headroom, the frame is sent from the packet */
+static size_t SendInPlace(AudioStreamPacket& packet) {
+    size_t opus_size = packet.opus_size();
+    auto bp3 = (BinaryProtocol3*)packet.PushHeader(sizeof(BinaryProtocol3));
+    bp3->type = 0;
+    bp3->reserved = 0;
+    bp3->payload_size = htons(opus_size);
+    Send((const char*)bp3, sizeof(BinaryProtocol3) + opus_size);
+    return 0;
+}
+
+/*
+ * A minute of uplink at the 24 kbps ceiling through each send path: bytes copied and heap
+ * allocations per second of audio, after a warm-up that fills the pools.
+ */
+static void TestSendBenchmark() {
+    for (int frame_duration_ms : {60, 20}) {
+        size_t opus_size = 24000 / 8 * frame_duration_ms / 1000;
+        int frames = 60000 / frame_duration_ms;
+        for (int in_place = 0; in_place <= 1; in_place++) {
+            size_t headroom = in_place ? AUDIO_PACKET_HEADROOM : 0;
+            for (int i = 0; i < 10; i++) {
+                auto packet = EncodedPacket(headroom, opus_size);
+                in_place ? SendInPlace(*packet) : SendCopied(*packet);
+            }
+
+            size_t copied = 0;
+            size_t allocations_start = allocations;
+            int64_t start = NowNs();
+            for (int i = 0; i < frames; i++) {
+                auto packet = EncodedPacket(headroom, opus_size);
+                copied += in_place ? SendInPlace(*packet) : SendCopied(*packet);
+            }
+            int64_t elapsed = NowNs() - start;
+            size_t allocated = allocations - allocations_start;
+            if (in_place) {
+                CHECK(copied == 0 && allocated == 0);
+            }
+            printf("%d ms frames, %-8s: %5zu bytes copied and %4.1f allocations per second of audio, %lld ns per frame\n",
+                frame_duration_ms, in_place ? "in place" : "copied", copied / 60, allocated / 60.0,
+                (long long)(elapsed / frames));
+        }
+    }
+}
+
+int main() {
+    TestPushHeader();
+    TestSendBenchmark();
+    return TestResult();
+}
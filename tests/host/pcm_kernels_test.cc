@@ -0,0 +1,225 @@
+#include "pcm_kernels.h"
+#include "host_test.h"
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+/*
+ * The scalar loops the kernels replaced, copied from NoAudioCodec, AudioService and CustomWakeWord.
+ * Kept out of line like the kernels, so the benchmark does not inline one side only.
+ */
+#define BASELINE static __attribute__((noinline))
+
+BASELINE void BaselineWrite(const int16_t* data, int32_t* buffer, int samples, int output_volume) {
+    int32_t volume_factor = pow(double(output_volume) / 100.0, 2) * 65536;
+    for (int i = 0; i < samples; i++) {
+        int64_t temp = int64_t(data[i]) * volume_factor;
+        if (temp > INT32_MAX) {
+            buffer[i] = INT32_MAX;
+        } else if (temp < INT32_MIN) {
+            buffer[i] = INT32_MIN;
+        } else {
+            buffer[i] = static_cast<int32_t>(temp);
+        }
+    }
+}
+
+BASELINE void BaselineRead(const int32_t* bit32_buffer, int16_t* dest, int samples) {
+    for (int i = 0; i < samples; i++) {
+        int32_t value = bit32_buffer[i] >> 12;
+        dest[i] = (value > INT16_MAX) ? INT16_MAX : (value < -INT16_MAX) ? -INT16_MAX : (int16_t)value;
+    }
+}
+
+BASELINE void BaselinePdmGain(int16_t* dest, int samples, float input_gain) {
+    int gain_factor = (int)input_gain;
+    for (int i = 0; i < samples; i++) {
+        int32_t amplified = dest[i] * gain_factor;
+        dest[i] = (amplified > INT16_MAX) ? INT16_MAX : (amplified < -INT16_MAX) ? -INT16_MAX : (int16_t)amplified;
+    }
+}
+
+BASELINE void BaselineDeinterleave(const int16_t* input, int16_t* left, int16_t* right, size_t frames) {
+    for (size_t i = 0; i < frames; i++) {
+        left[i] = input[i * 2];
+        right[i] = input[i * 2 + 1];
+    }
+}
+
+BASELINE void BaselineInterleave(const int16_t* left, const int16_t* right, int16_t* output, size_t frames) {
+    for (size_t i = 0; i < frames; i++) {
+        output[i * 2] = left[i];
+        output[i * 2 + 1] = right[i];
+    }
+}
+
+BASELINE void BaselineExtractLeft(const int16_t* data, int16_t* mono, size_t frames) {
+    for (size_t i = 0, j = 0; i < frames; ++i, j += 2) {
+        mono[i] = data[j];
+    }
+}
+
+static std::mt19937 random_engine(2024);
+
+// Random samples with the extremes mixed in
+static std::vector<int16_t> Samples16(size_t count) {
+    std::vector<int16_t> samples(count);
+    for (size_t i = 0; i < count; i++) {
+        switch (random_engine() % 8) {
+        case 0: samples[i] = INT16_MAX; break;
+        case 1: samples[i] = INT16_MIN; break;
+        case 2: samples[i] = -INT16_MAX; break;
+        default: samples[i] = (int16_t)random_engine(); break;
+        }
+    }
+    return samples;
+}
+
+static std::vector<int32_t> Samples32(size_t count) {
+    std::vector<int32_t> samples(count);
+    for (size_t i = 0; i < count; i++) {
+        switch (random_engine() % 8) {
+        case 0: samples[i] = INT32_MAX; break;
+        case 1: samples[i] = INT32_MIN; break;
+        case 2: samples[i] = (int32_t)INT16_MAX << 12; break;
+        case 3: samples[i] = -((int32_t)INT16_MAX << 12) - 1; break;
+        default: samples[i] = (int32_t)random_engine(); break;
+        }
+    }
+    return samples;
+}
+
+// Odd lengths leave a tail after the unrolled blocks of four
+static const size_t kLengths[] = {0, 1, 2, 3, 4, 5, 7, 9, 160, 321, 961};
+
+static void TestPcmToI2s32() {
+    for (size_t length : kLengths) {
+        auto input = Samples16(length);
+        for (int volume = 0; volume <= 100; volume++) {
+            std::vector<int32_t> expected(length), actual(length);
+            BaselineWrite(input.data(), expected.data(), length, volume);
+            PcmToI2s32(input.data(), actual.data(), length, PcmVolumeToGainQ16(volume));
+            if (expected != actual) {
+                printf("PcmToI2s32: length %zu, volume %d differs\n", length, volume);
+                failures++;
+            }
+        }
+    }
+    CHECK(PcmVolumeToGainQ16(-5) == 0);
+    CHECK(PcmVolumeToGainQ16(150) == 1 << 16);
+}
+
+static void TestI2s32ToPcm() {
+    for (size_t length : kLengths) {
+        auto input = Samples32(length);
+        std::vector<int16_t> expected(length), actual(length);
+        BaselineRead(input.data(), expected.data(), length);
+        I2s32ToPcm(input.data(), actual.data(), length, 12);
+        CHECK(expected == actual);
+    }
+}
+
+static void TestPcmApplyGain() {
+    for (size_t length : kLengths) {
+        auto input = Samples16(length);
+        for (int gain : {1, 2, 3, 8, 31, 100}) {
+            auto expected = input;
+            auto actual = input;
+            BaselinePdmGain(expected.data(), length, (float)gain);
+            PcmApplyGainQ16(actual.data(), length, gain << 16);
+            if (expected != actual) {
+                printf("PcmApplyGainQ16: length %zu, gain %d differs\n", length, gain);
+                failures++;
+            }
+        }
+    }
+    // Fractional gains scale instead of truncating to a whole gain, as the old loop did
+    int16_t half[] = {1000, -1000, INT16_MAX, INT16_MIN};
+    PcmApplyGainQ16(half, 4, 1 << 15);
+    CHECK(half[0] == 500 && half[1] == -500 && half[2] == 16383 && half[3] == -16384);
+}
+
+static void TestStereo() {
+    for (size_t frames : kLengths) {
+        auto input = Samples16(frames * 2);
+        std::vector<int16_t> expected_left(frames), expected_right(frames), left(frames), right(frames);
+        BaselineDeinterleave(input.data(), expected_left.data(), expected_right.data(), frames);
+        PcmDeinterleaveStereo(input.data(), left.data(), right.data(), frames);
+        CHECK(left == expected_left && right == expected_right);
+
+        std::vector<int16_t> expected(frames * 2), output(frames * 2);
+        BaselineInterleave(left.data(), right.data(), expected.data(), frames);
+        PcmInterleaveStereo(left.data(), right.data(), output.data(), frames);
+        CHECK(output == expected);
+        CHECK(output == input);
+
+        std::vector<int16_t> expected_mono(frames), mono(frames);
+        BaselineExtractLeft(input.data(), expected_mono.data(), frames);
+        PcmExtractChannel(input.data(), mono.data(), frames, 2, 0);
+        CHECK(mono == expected_mono);
+        PcmExtractChannel(input.data(), mono.data(), frames, 2, 1);
+        CHECK(mono == expected_right);
+    }
+}
+
+// Time of a 60 ms frame at 16 kHz through the old code and the kernel, the best of many runs
+template <typename Baseline, typename Kernel>
+static void Compare(const char* name, Baseline baseline, Kernel kernel) {
+    const int rounds = 2000;
+    int64_t best_baseline = INT64_MAX;
+    int64_t best_kernel = INT64_MAX;
+    for (int i = 0; i < rounds; i++) {
+        int64_t start = NowNs();
+        baseline();
+        int64_t middle = NowNs();
+        kernel();
+        int64_t end = NowNs();
+        best_baseline = std::min(best_baseline, middle - start);
+        best_kernel = std::min(best_kernel, end - middle);
+    }
+    printf("%-12s old code %6lld ns, kernel %6lld ns per 960 samples\n", name, (long long)best_baseline,
+        (long long)best_kernel);
+}
+
+static void TestBenchmark() {
+    const size_t samples = 960;
+    auto pcm = Samples16(samples);
+    auto i2s = Samples32(samples);
+    std::vector<int32_t> out32(samples);
+    std::vector<int16_t> out16(samples), left(samples / 2), right(samples / 2);
+
+    // The old Write() and Read() allocated their I2S buffer on every call, the codec now keeps it
+    Compare("write",
+        [&]() {
+            std::vector<int32_t> buffer(samples);
+            BaselineWrite(pcm.data(), buffer.data(), samples, 70);
+            out32[0] = buffer[0];
+        },
+        [&]() { PcmToI2s32(pcm.data(), out32.data(), samples, PcmVolumeToGainQ16(70)); });
+    Compare("read",
+        [&]() {
+            std::vector<int32_t> buffer(i2s);
+            BaselineRead(buffer.data(), out16.data(), samples);
+        },
+        [&]() { I2s32ToPcm(i2s.data(), out16.data(), samples, 12); });
+    Compare("pdm gain",
+        [&]() { BaselinePdmGain(out16.data(), samples, 2.0f); },
+        [&]() { PcmApplyGainQ16(out16.data(), samples, 2 << 16); });
+    Compare("deinterleave",
+        [&]() { BaselineDeinterleave(pcm.data(), left.data(), right.data(), samples / 2); },
+        [&]() { PcmDeinterleaveStereo(pcm.data(), left.data(), right.data(), samples / 2); });
+    Compare("interleave",
+        [&]() { BaselineInterleave(left.data(), right.data(), out16.data(), samples / 2); },
+        [&]() { PcmInterleaveStereo(left.data(), right.data(), out16.data(), samples / 2); });
+}
+
+int main() {
+    TestPcmToI2s32();
+    TestI2s32ToPcm();
+    TestPcmApplyGain();
+    TestStereo();
+    TestBenchmark();
+    return TestResult();
+}
@@ -0,0 +1,214 @@
+#include "pcm_ring.h"
+#include "host_test.h"
+
+#include <cstdio>
+#include <deque>
+#include <random>
+#include <vector>
+
+// Samples numbered from first, so any misplaced or missing sample shows
+static std::vector<int16_t> Ramp(int first, size_t count) {
+    std::vector<int16_t> samples(count);
+    for (size_t i = 0; i < count; i++) {
+        samples[i] = (int16_t)(first + i);
+    }
+    return samples;
+}
+
+static void TestWrapAround() {
+    PcmRing ring(8);
+    auto first = Ramp(0, 6);
+    CHECK(ring.Push(first.data(), first.size()) == 0);
+    int16_t out[8];
+    CHECK(ring.Pop(out, 5) == 5);
+    CHECK(out[0] == 0 && out[4] == 4);
+
+    // Head at 5: the push wraps from index 6 to 1
+    auto second = Ramp(6, 4);
+    CHECK(ring.Push(second.data(), second.size()) == 0);
+    CHECK(ring.size() == 5);
+
+    PcmSpan span_first, span_second;
+    ring.Peek(5, span_first, span_second);
+    CHECK(span_first.size == 3 && span_second.size == 2);
+    CHECK(span_first.data[0] == 5 && span_second.data[0] == 8);
+
+    // The read wraps as well
+    CHECK(ring.Pop(out, 8) == 5);
+    for (int i = 0; i < 5; i++) {
+        CHECK(out[i] == 5 + i);
+    }
+    CHECK(ring.empty());
+}
+
+static void TestOverrunDropsOldest() {
+    PcmRing ring(8);
+    auto samples = Ramp(0, 6);
+    ring.Push(samples.data(), samples.size());
+    auto more = Ramp(6, 5);
+    CHECK(ring.Push(more.data(), more.size()) == 3);
+    CHECK(ring.size() == 8);
+    int16_t out[8];
+    ring.Pop(out, 8);
+    CHECK(out[0] == 3 && out[7] == 10);
+
+    // A push larger than the ring keeps only its newest samples
+    ring.Push(samples.data(), 2);
+    auto huge = Ramp(100, 20);
+    CHECK(ring.Push(huge.data(), huge.size()) == 2 + 12);
+    CHECK(ring.size() == 8);
+    ring.Pop(out, 8);
+    CHECK(out[0] == 112 && out[7] == 119);
+
+    PcmRing unallocated;
+    CHECK(unallocated.Push(samples.data(), samples.size()) == samples.size());
+}
+
+static void TestSnapshot() {
+    PcmRing ring(10);
+    std::vector<int16_t> snapshot;
+    ring.Snapshot(snapshot, 4);
+    CHECK(snapshot.empty());
+
+    auto samples = Ramp(0, 7);
+    ring.Push(samples.data(), samples.size());
+    ring.Consume(5);
+    auto more = Ramp(7, 6);
+    ring.Push(more.data(), more.size());    // 5..12, stored across the end of the buffer
+
+    ring.Snapshot(snapshot, 4);
+    CHECK(snapshot == Ramp(9, 4));
+    // Asking for more than is buffered gives what there is, without removing anything
+    ring.Snapshot(snapshot, 100);
+    CHECK(snapshot == Ramp(5, 8));
+    CHECK(ring.size() == 8);
+}
+
+/*
+ * The wake word pre-roll ring as WakeWordPreroll sizes it: 2 s of 60 ms frames at 16 kHz. With the
+ * encoder stalled for 5 s of 512 sample chunks it holds exactly the newest window, and moving it
+ * into a ring framed for 20 ms, as SetFrameDuration() does, keeps the newest 2 s again.
+ */
+static void TestPrerollWindow() {
+    const size_t sample_rate = 16000;
+    const size_t window_ms = 2000;
+    size_t frame_samples = sample_rate * 60 / 1000;
+    PcmRing ring(window_ms / 60 * frame_samples);
+    CHECK(ring.capacity() == 31680);
+
+    size_t pushed = 0;
+    while (pushed < sample_rate * 5) {
+        auto chunk = Ramp(pushed, 512);
+        ring.Push(chunk.data(), chunk.size());
+        pushed += chunk.size();
+    }
+    std::vector<int16_t> pending;
+    ring.Snapshot(pending, ring.size());
+    CHECK(pending.size() == ring.capacity());
+    CHECK(pending.back() == (int16_t)(pushed - 1));
+    CHECK(pending.front() == (int16_t)(pushed - ring.capacity()));
+
+    frame_samples = sample_rate * 20 / 1000;
+    PcmRing resized(window_ms / 20 * frame_samples);
+    resized.Push(pending.data(), pending.size());
+    CHECK(resized.size() == pending.size());
+    std::vector<int16_t> frame;
+    size_t frames = 0;
+    while (resized.PopFrame(frame, frame_samples)) {
+        frames++;
+    }
+    CHECK(frames == pending.size() / frame_samples);
+    CHECK(resized.size() == pending.size() % frame_samples);
+}
+
+// Random pushes, pops and snapshots against a std::deque holding at most the capacity
+static void TestAgainstReference() {
+    std::mt19937 random(12345);
+    const size_t capacity = 37;
+    PcmRing ring(capacity);
+    std::deque<int16_t> reference;
+    int next = 0;
+    for (int step = 0; step < 20000; step++) {
+        int action = random() % 3;
+        size_t count = random() % 50;
+        if (action == 0) {
+            auto samples = Ramp(next, count);
+            next += count;
+            size_t dropped = ring.Push(samples.data(), samples.size());
+            size_t expected_dropped = 0;
+            for (auto sample : samples) {
+                if (reference.size() == capacity) {
+                    reference.pop_front();
+                    expected_dropped++;
+                }
+                reference.push_back(sample);
+            }
+            CHECK(dropped == expected_dropped);
+        } else if (action == 1) {
+            std::vector<int16_t> out(count);
+            size_t popped = ring.Pop(out.data(), count);
+            CHECK(popped == std::min(count, reference.size()));
+            for (size_t i = 0; i < popped; i++) {
+                CHECK(out[i] == reference.front());
+                reference.pop_front();
+            }
+        } else {
+            std::vector<int16_t> snapshot;
+            ring.Snapshot(snapshot, count);
+            size_t expected = std::min(count, reference.size());
+            CHECK(snapshot.size() == expected);
+            CHECK(std::equal(snapshot.begin(), snapshot.end(), reference.end() - expected));
+        }
+        CHECK(ring.size() == reference.size());
+    }
+}
+
+// AFE fetches of 512 samples cut into 60 ms frames, the framing the ring replaced and the ring
+static void TestFramingBenchmark() {
+    const size_t fetch_samples = 512;
+    const size_t frame_samples = 960;
+    const int fetches = 100000;
+    auto fetch = Ramp(0, fetch_samples);
+    size_t frames = 0;
+    int64_t checksum = 0;
+
+    int64_t start = NowNs();
+    std::vector<int16_t> buffer;
+    buffer.reserve(frame_samples);
+    for (int i = 0; i < fetches; i++) {
+        buffer.insert(buffer.end(), fetch.begin(), fetch.end());
+        while (buffer.size() >= frame_samples) {
+            std::vector<int16_t> frame(buffer.begin(), buffer.begin() + frame_samples);
+            buffer.erase(buffer.begin(), buffer.begin() + frame_samples);
+            checksum += frame[0];
+            frames++;
+        }
+    }
+    int64_t vector_ns = NowNs() - start;
+
+    start = NowNs();
+    PcmRing ring(frame_samples + fetch_samples);
+    std::vector<int16_t> frame;
+    for (int i = 0; i < fetches; i++) {
+        ring.Push(fetch.data(), fetch.size());
+        while (ring.PopFrame(frame, frame_samples)) {
+            checksum -= frame[0];
+            frames--;
+        }
+    }
+    int64_t ring_ns = NowNs() - start;
+
+    CHECK(frames == 0 && checksum == 0);
+    printf("framing %zu sample fetches into %zu sample frames: vector insert/erase %.1f ns, ring %.1f ns per fetch\n",
+        fetch_samples, frame_samples, vector_ns / (double)fetches, ring_ns / (double)fetches);
+}
+
+int main() {
+    TestWrapAround();
+    TestOverrunDropsOldest();
+    TestSnapshot();
+    TestPrerollWindow();
+    TestAgainstReference();
+    TestFramingBenchmark();
+    return TestResult();
+}
@@ -0,0 +1,202 @@
+#include "sd_track_stream.h"
+#include "ogg_demuxer.h"
+#include "host_test.h"
+#include "ogg_test_stream.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <vector>
+
+/*
+ * Heap accounting for the memory figures: every allocation carries its size in front of it, the
+ * live total and its peak are kept across all threads.
+ */
+static std::atomic<size_t> heap_live{0};
+static std::atomic<size_t> heap_peak{0};
+static const size_t kHeapHeader = alignof(std::max_align_t);
+
+void* operator new(size_t size) {
+    auto block = static_cast<uint8_t*>(malloc(size + kHeapHeader));
+    if (block == nullptr) {
+        throw std::bad_alloc();
+    }
+    *reinterpret_cast<size_t*>(block) = size;
+    size_t live = heap_live += size;
+    size_t peak = heap_peak.load();
+    while (live > peak && !heap_peak.compare_exchange_weak(peak, live)) {
+    }
+    return block + kHeapHeader;
+}
+
+void operator delete(void* ptr) noexcept {
+    if (ptr == nullptr) {
+        return;
+    }
+    auto block = static_cast<uint8_t*>(ptr) - kHeapHeader;
+    heap_live -= *reinterpret_cast<size_t*>(block);
+    free(block);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    operator delete(ptr);
+}
+
+// Peak heap use above what was live when the measurement started
+class PeakHeap {
+public:
+    PeakHeap() : base_(heap_live.load()) { heap_peak = base_; }
+    size_t bytes() const { return heap_peak.load() - base_; }
+
+private:
+    size_t base_;
+};
+
+static const char* kTrackPath = "sd_track_stream_test.ogg";
+// As in SdAudioPlayer
+static const size_t kReadChunk = 16 * 1024;
+
+// A track of 60 ms packets of 100 to 259 bytes, about as much as a 24 kbps Opus stream
+static std::vector<Packet> WriteTrack(size_t bytes) {
+    std::vector<Packet> audio;
+    size_t total = 0;
+    while (total < bytes) {
+        audio.push_back(AudioPacket(audio.size(), 100 + audio.size() % 160));
+        total += audio.back().size();
+    }
+    auto stream = MakeStream(WithHeaders(audio));
+    FILE* file = fopen(kTrackPath, "wb");
+    fwrite(stream.data(), 1, stream.size(), file);
+    fclose(file);
+    return audio;
+}
+
+static void TestWholeTrack() {
+    auto audio = WriteTrack(200 * 1024);
+    // A chunk size that splits pages and packets everywhere
+    auto stream = std::make_unique<SdTrackStream>(fopen(kTrackPath, "rb"), 1000);
+    OggDemuxer demuxer;
+    std::vector<Packet> received;
+    while (true) {
+        auto chunk = stream->Read();
+        if (chunk.empty()) {
+            break;
+        }
+        demuxer.Feed(reinterpret_cast<const uint8_t*>(chunk.data()), chunk.size(),
+            [&received](const uint8_t* data, size_t size) {
+                received.emplace_back(data, data + size);
+                return true;
+            });
+    }
+    CHECK(received == audio);
+    // The end of the stream stays the end
+    CHECK(stream->Read().empty());
+}
+
+static void TestStopEarly() {
+    WriteTrack(1024 * 1024);
+    for (int reads = 0; reads < 3; reads++) {
+        auto stream = std::make_unique<SdTrackStream>(fopen(kTrackPath, "rb"), kReadChunk);
+        for (int i = 0; i < reads; i++) {
+            CHECK(stream->Read().size() == kReadChunk);
+        }
+        // Waits for the reader to let go of the file
+        stream.reset();
+    }
+
+    FILE* empty = fopen(kTrackPath, "wb");
+    fclose(empty);
+    SdTrackStream stream(fopen(kTrackPath, "rb"), kReadChunk);
+    CHECK(stream.Read().empty());
+}
+
+struct PlayResult {
+    int64_t first_packet_us = 0;
+    size_t peak_bytes = 0;
+    size_t packets = 0;
+};
+
+/* SdAudioPlayer::Play() before streaming: the whole file into a vector, then the demuxer */
+static PlayResult PlayLoaded() {
+    PlayResult result;
+    PeakHeap heap;
+    int64_t start = NowUs();
+    FILE* file = fopen(kTrackPath, "rb");
+    std::vector<uint8_t> buffer;
+    buffer.reserve(64 * 1024);
+    std::vector<uint8_t> chunk(kReadChunk);
+    size_t read_bytes = 0;
+    while ((read_bytes = fread(chunk.data(), 1, chunk.size(), file)) > 0) {
+        buffer.insert(buffer.end(), chunk.data(), chunk.data() + read_bytes);
+    }
+    fclose(file);
+
+    OggDemuxer demuxer;
+    demuxer.Feed(buffer.data(), buffer.size(), [&](const uint8_t*, size_t) {
+        if (result.packets++ == 0) {
+            result.first_packet_us = NowUs() - start;
+        }
+        return true;
+    });
+    result.peak_bytes = heap.bytes();
+    return result;
+}
+
+/* SdAudioPlayer::Play() now: the double-buffered stream through the demuxer */
+static PlayResult PlayStreamed() {
+    PlayResult result;
+    PeakHeap heap;
+    int64_t start = NowUs();
+    {
+        auto stream = std::make_unique<SdTrackStream>(fopen(kTrackPath, "rb"), kReadChunk);
+        OggDemuxer demuxer;
+        while (true) {
+            auto chunk = stream->Read();
+            if (chunk.empty()) {
+                break;
+            }
+            demuxer.Feed(reinterpret_cast<const uint8_t*>(chunk.data()), chunk.size(), [&](const uint8_t*, size_t) {
+                if (result.packets++ == 0) {
+                    result.first_packet_us = NowUs() - start;
+                }
+                return true;
+            });
+        }
+    }
+    result.peak_bytes = heap.bytes();
+    return result;
+}
+
+/*
+ * Time to the first packet out of the demuxer and peak heap over the whole track, by track size.
+ * The file is in the page cache, so this is the cost of the buffering alone: on the device the
+ * loaded path also waits for the SD card to deliver the whole file first.
+ */
+static void TestBenchmark() {
+    for (size_t size : {256 * 1024, 1024 * 1024, 5 * 1024 * 1024}) {
+        auto audio = WriteTrack(size);
+        std::vector<int64_t> loaded_times, streamed_times;
+        PlayResult loaded, streamed;
+        for (int round = 0; round < 5; round++) {
+            loaded = PlayLoaded();
+            streamed = PlayStreamed();
+            loaded_times.push_back(loaded.first_packet_us);
+            streamed_times.push_back(streamed.first_packet_us);
+        }
+        CHECK(loaded.packets == audio.size());
+        CHECK(streamed.packets == audio.size());
+        printf("%4zu KB track: loaded first packet %6lld us, peak %7zu bytes; streamed first packet %4lld us, peak %6zu bytes\n",
+            size / 1024, (long long)Median(loaded_times), loaded.peak_bytes, (long long)Median(streamed_times),
+            streamed.peak_bytes);
+    }
+}
+
+int main() {
+    TestWholeTrack();
+    TestStopEarly();
+    TestBenchmark();
+    remove(kTrackPath);
+    return TestResult();
+}
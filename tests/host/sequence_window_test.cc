@@ -0,0 +1,115 @@
+#include "sequence_window.h"
+#include "host_test.h"
+
+#include <cstdio>
+#include <vector>
+
+struct TraceStep {
+    uint32_t sequence;
+    SequenceWindowResult expected;
+};
+
+// Replays a receive trace and checks the verdict on every packet
+static void Replay(SequenceWindow& window, const std::vector<TraceStep>& trace) {
+    for (auto& step : trace) {
+        auto result = window.Accept(step.sequence);
+        if (result != step.expected) {
+            printf("sequence %u: got %d, expected %d\n", step.sequence, result, step.expected);
+            failures++;
+        }
+    }
+}
+
+static void TestInOrder() {
+    SequenceWindow window;
+    std::vector<TraceStep> trace;
+    for (uint32_t sequence = 1; sequence <= 200; sequence++) {
+        trace.push_back({sequence, kSequenceNew});
+    }
+    Replay(window, trace);
+    auto& stats = window.statistics();
+    CHECK(stats.received == 200);
+    CHECK(stats.reordered == 0 && stats.duplicated == 0 && stats.too_old == 0 && stats.lost == 0);
+    CHECK(window.highest() == 200);
+}
+
+static void TestReorderAndDuplicates() {
+    SequenceWindow window;
+    Replay(window, {
+        {10, kSequenceNew},
+        {12, kSequenceNew},
+        {11, kSequenceReordered},
+        {11, kSequenceDuplicated},
+        {12, kSequenceDuplicated},
+        {15, kSequenceNew},
+        {13, kSequenceReordered},
+        {14, kSequenceReordered},
+        {9, kSequenceDuplicated},     // Before the first packet, counted as seen
+    });
+    auto& stats = window.statistics();
+    CHECK(stats.received == 9);
+    CHECK(stats.reordered == 3);
+    CHECK(stats.duplicated == 3);
+    CHECK(stats.lost == 0);
+}
+
+static void TestLossAndTooOld() {
+    SequenceWindow window;
+    Replay(window, {
+        {100, kSequenceNew},
+        {103, kSequenceNew},          // 101 and 102 still inside the window
+        {170, kSequenceNew},          // 101..106 leave the window, 101 and 102 never arrived
+        {102, kSequenceTooOld},
+        {107, kSequenceReordered},    // 170 - 63 is the oldest sequence still in the window
+        {106, kSequenceTooOld},
+    });
+    auto& stats = window.statistics();
+    CHECK(stats.too_old == 2);
+    CHECK(stats.reordered == 1);
+    // Only the sequences that left the window count as lost: 101, 102 and 104..106
+    CHECK(stats.lost == 5);
+}
+
+static void TestWrapAround() {
+    SequenceWindow window;
+    Replay(window, {
+        {0xFFFFFFFE, kSequenceNew},
+        {0xFFFFFFFF, kSequenceNew},
+        {1, kSequenceNew},
+        {0, kSequenceReordered},
+        {0xFFFFFFFF, kSequenceDuplicated},
+        {2, kSequenceNew},
+    });
+    CHECK(window.highest() == 2);
+    CHECK(window.statistics().lost == 0);
+}
+
+static void TestReset() {
+    SequenceWindow window;
+    Replay(window, {{500, kSequenceNew}, {501, kSequenceNew}});
+    window.Reset();
+    // A new session may start anywhere, including below the old stream
+    Replay(window, {{1, kSequenceNew}, {2, kSequenceNew}});
+    CHECK(window.statistics().received == 2);
+}
+
+// Not replay protection: a forged packet far ahead pushes the genuine stream out of the window
+static void TestForgedSequence() {
+    SequenceWindow window;
+    Replay(window, {
+        {1, kSequenceNew},
+        {2, kSequenceNew},
+        {100000, kSequenceNew},
+        {3, kSequenceTooOld},
+    });
+}
+
+int main() {
+    TestInOrder();
+    TestReorderAndDuplicates();
+    TestLossAndTooOld();
+    TestWrapAround();
+    TestReset();
+    TestForgedSequence();
+    return TestResult();
+}
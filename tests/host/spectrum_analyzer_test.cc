@@ -0,0 +1,161 @@
+#include "spectrum_analyzer.h"
+#include "host_test.h"
+
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+static const double kPi = 3.14159265358979323846;
+
+// Textbook DFT in double precision, scaled by 1/N like the Q15 FFT
+static std::vector<std::complex<double>> NaiveDft(const std::vector<double>& input) {
+    size_t n = input.size();
+    std::vector<std::complex<double>> output(n);
+    for (size_t k = 0; k < n; k++) {
+        std::complex<double> sum = 0;
+        for (size_t t = 0; t < n; t++) {
+            sum += input[t] * std::polar(1.0, -2 * kPi * k * t / n);
+        }
+        output[k] = sum / (double)n;
+    }
+    return output;
+}
+
+/*
+ * Reference bars: Hann window and DFT in double precision, the band edges and the level mapping
+ * of the analyzer
+ */
+static SpectrumBars ReferenceBars(const std::vector<int16_t>& samples, int sample_rate) {
+    const int n = SPECTRUM_FFT_SIZE;
+    std::vector<double> windowed(n);
+    for (int i = 0; i < n; i++) {
+        windowed[i] = samples[i] * 0.5 * (1 - cos(2 * kPi * i / (n - 1)));
+    }
+    auto spectrum = NaiveDft(windowed);
+
+    int edges[SPECTRUM_BANDS + 1];
+    double max_frequency = std::min(SPECTRUM_MAX_FREQUENCY, sample_rate / 2);
+    int previous = 0;
+    for (int band = 0; band <= SPECTRUM_BANDS; band++) {
+        double frequency = SPECTRUM_MIN_FREQUENCY * pow(max_frequency / SPECTRUM_MIN_FREQUENCY, (double)band / SPECTRUM_BANDS);
+        int bin = lrint(frequency * n / sample_rate);
+        if (band > 0 && bin <= previous) {
+            bin = previous + 1;
+        }
+        edges[band] = std::max(1, std::min(bin, n / 2));
+        previous = edges[band];
+    }
+
+    SpectrumBars bars;
+    const double full_scale_power = (32767.0 / 4) * (32767.0 / 4);
+    for (int band = 0; band < SPECTRUM_BANDS; band++) {
+        double power = 0;
+        for (int bin = edges[band]; bin < edges[band + 1]; bin++) {
+            power += std::norm(spectrum[bin]);
+        }
+        double db = power > 0 ? 10 * log10(power / full_scale_power) : -1000;
+        int level = (int)((db + SPECTRUM_RANGE_DB) * 100 / SPECTRUM_RANGE_DB);
+        bars[band] = (uint8_t)std::max(0, std::min(level, 100));
+    }
+    return bars;
+}
+
+static std::vector<int16_t> Tone(double frequency, double amplitude, int sample_rate) {
+    std::vector<int16_t> samples(SPECTRUM_FFT_SIZE);
+    for (int i = 0; i < SPECTRUM_FFT_SIZE; i++) {
+        samples[i] = (int16_t)lrint(amplitude * 32767 * sin(2 * kPi * frequency * i / sample_rate));
+    }
+    return samples;
+}
+
+static std::mt19937 random_engine(8);
+
+static std::vector<int16_t> Noise(int amplitude) {
+    std::vector<int16_t> samples(SPECTRUM_FFT_SIZE);
+    std::uniform_int_distribution<int> distribution(-amplitude, amplitude);
+    for (auto& sample : samples) {
+        sample = distribution(random_engine);
+    }
+    return samples;
+}
+
+// The Q15 FFT against the DFT, within the rounding of its eight halving stages
+static void TestFftMatchesDft() {
+    for (int round = 0; round < 20; round++) {
+        auto samples = round < 10 ? Noise(32767) : Tone(100 + round * 377, 0.9, 16000);
+        std::vector<double> input(samples.begin(), samples.end());
+        auto expected = NaiveDft(input);
+
+        int16_t data[SPECTRUM_FFT_SIZE * 2];
+        for (int i = 0; i < SPECTRUM_FFT_SIZE; i++) {
+            data[i * 2] = samples[i];
+            data[i * 2 + 1] = 0;
+        }
+        SpectrumAnalyzer::Fft(data);
+
+        double max_error = 0;
+        for (int k = 0; k < SPECTRUM_FFT_SIZE; k++) {
+            std::complex<double> actual(data[k * 2], data[k * 2 + 1]);
+            max_error = std::max(max_error, std::abs(actual - expected[k]));
+        }
+        if (max_error > 4) {
+            printf("FFT round %d: error %.2f LSB\n", round, max_error);
+            failures++;
+        }
+    }
+}
+
+static void CheckBars(SpectrumAnalyzer& analyzer, const char* name, const std::vector<int16_t>& samples,
+    int sample_rate, int tolerance) {
+    SpectrumBars bars;
+    analyzer.Analyze(samples.data(), sample_rate, bars);
+    auto expected = ReferenceBars(samples, sample_rate);
+    for (int band = 0; band < SPECTRUM_BANDS; band++) {
+        if (abs(bars[band] - expected[band]) > tolerance) {
+            printf("%s at %d Hz, band %d: %d, reference %d\n", name, sample_rate, band, bars[band], expected[band]);
+            failures++;
+        }
+    }
+}
+
+// Levels are 0.6 dB apart, two of them allow for the Q15 window and FFT rounding
+static void TestBandsMatchReference() {
+    SpectrumAnalyzer analyzer;
+    for (int sample_rate : {16000, 24000, 48000}) {
+        for (double frequency : {80.0, 250.0, 1000.0, 3000.0, 7000.0}) {
+            CheckBars(analyzer, "tone", Tone(frequency, 0.8, sample_rate), sample_rate, 2);
+        }
+        CheckBars(analyzer, "quiet tone", Tone(1000, 0.01, sample_rate), sample_rate, 2);
+        CheckBars(analyzer, "noise", Noise(20000), sample_rate, 2);
+        CheckBars(analyzer, "silence", std::vector<int16_t>(SPECTRUM_FFT_SIZE), sample_rate, 0);
+    }
+
+    // A full scale tone fills its band and leaves the far bands low
+    SpectrumBars bars;
+    auto tone = Tone(1000, 1.0, 16000);
+    analyzer.Analyze(tone.data(), 16000, bars);
+    CHECK(*std::max_element(bars.begin(), bars.end()) >= 95);
+    CHECK(bars[0] < 50);
+}
+
+static void TestAnalyzeTime() {
+    SpectrumAnalyzer analyzer;
+    auto samples = Noise(20000);
+    SpectrumBars bars;
+    std::vector<int64_t> times;
+    for (int i = 0; i < 1000; i++) {
+        int64_t start = NowNs();
+        analyzer.Analyze(samples.data(), 16000, bars);
+        times.push_back(NowNs() - start);
+    }
+    printf("window, %d point FFT and bands: p50 %lld ns\n", SPECTRUM_FFT_SIZE, (long long)Median(times));
+}
+
+int main() {
+    TestFftMatchesDft();
+    TestBandsMatchReference();
+    TestAnalyzeTime();
+    return TestResult();
+}
@@ -0,0 +1,244 @@
+#include "spsc_queue.h"
+#include "host_test.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+static void TestFifoAndCapacity() {
+    // Rounded up to 8 slots, but full at the requested capacity
+    SpscQueue<int> queue(5);
+    CHECK(queue.capacity() == 5);
+    for (int i = 0; i < 5; i++) {
+        CHECK(queue.Push(i));
+    }
+    CHECK(queue.Full());
+    CHECK(!queue.Push(5));
+    CHECK(queue.Size() == 5);
+
+    int value;
+    for (int i = 0; i < 5; i++) {
+        CHECK(queue.Pop(value) && value == i);
+    }
+    CHECK(!queue.Pop(value));
+    CHECK(queue.Empty());
+
+    // Indexes keep running past the slot count
+    for (int i = 0; i < 1000; i++) {
+        CHECK(queue.Push(i) && queue.Pop(value) && value == i);
+    }
+}
+
+static void TestClear() {
+    SpscQueue<std::unique_ptr<int>> queue(4);
+    queue.Push(std::make_unique<int>(1));
+    queue.Push(std::make_unique<int>(2));
+    queue.Clear();
+    CHECK(queue.Empty() && queue.Size() == 0);
+    // The flushed items still hold their slots until the consumer drops them
+    CHECK(!queue.Full());
+
+    queue.Push(std::make_unique<int>(3));
+    CHECK(queue.Size() == 1);
+    std::unique_ptr<int> item;
+    CHECK(queue.Pop(item) && *item == 3);
+    CHECK(!queue.Pop(item));
+
+    // Clear() on an empty queue leaves it working
+    queue.Clear();
+    queue.Push(std::make_unique<int>(4));
+    CHECK(queue.Pop(item) && *item == 4);
+}
+
+// One producer and one consumer thread, every value has to come out once and in order
+static void TestThreads() {
+    SpscQueue<uint32_t> queue(8);
+    const uint32_t count = 1000000;
+    std::thread producer([&queue]() {
+        for (uint32_t i = 1; i <= count; i++) {
+            while (!queue.Push(i)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    uint32_t expected = 1;
+    bool ordered = true;
+    while (expected <= count) {
+        uint32_t value;
+        if (!queue.Pop(value)) {
+            std::this_thread::yield();
+            continue;
+        }
+        ordered &= value == expected;
+        expected++;
+    }
+    producer.join();
+    CHECK(ordered);
+    CHECK(queue.Empty());
+}
+
+struct ContentionCounters {
+    std::atomic<uint64_t> contended{0};     // Lock attempts that found the mutex taken
+    std::atomic<uint64_t> wakeups{0};       // Waits that returned
+    std::atomic<uint64_t> useless{0};       // ... and found nothing to do
+};
+
+static void Lock(std::unique_lock<std::mutex>& lock, ContentionCounters& counters) {
+    if (!lock.try_lock()) {
+        counters.contended++;
+        lock.lock();
+    }
+}
+
+/*
+ * The queues as AudioService had them: std::deque per queue, all behind one mutex and one
+ * condition variable, notify_all() on every change.
+ */
+static void RunSharedLock(int pairs, int items, size_t capacity, ContentionCounters& counters) {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<std::deque<int>> queues(pairs);
+    std::vector<std::thread> threads;
+
+    auto wait = [&](std::unique_lock<std::mutex>& lock, auto ready) {
+        while (!ready()) {
+            cv.wait(lock);
+            counters.wakeups++;
+            if (!ready()) {
+                counters.useless++;
+            }
+        }
+    };
+    for (int pair = 0; pair < pairs; pair++) {
+        auto& queue = queues[pair];
+        threads.emplace_back([&, pair]() {
+            for (int i = 0; i < items; i++) {
+                std::unique_lock<std::mutex> lock(mutex, std::defer_lock);
+                Lock(lock, counters);
+                wait(lock, [&queue, capacity]() { return queue.size() < capacity; });
+                queue.push_back(i);
+                cv.notify_all();
+            }
+        });
+        threads.emplace_back([&, pair]() {
+            for (int i = 0; i < items; i++) {
+                std::unique_lock<std::mutex> lock(mutex, std::defer_lock);
+                Lock(lock, counters);
+                wait(lock, [&queue]() { return !queue.empty(); });
+                queue.pop_front();
+                cv.notify_all();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+// xTaskNotifyGive() / ulTaskNotifyTake(pdTRUE, ...): a count per task, only that task is woken
+class TaskNotification {
+public:
+    explicit TaskNotification(ContentionCounters& counters) : counters_(counters) {}
+
+    void Give() {
+        std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
+        Lock(lock, counters_);
+        count_++;
+        cv_.notify_one();
+    }
+
+    void Take(const std::function<bool()>& ready) {
+        std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
+        Lock(lock, counters_);
+        while (count_ == 0) {
+            cv_.wait(lock);
+        }
+        count_ = 0;
+        lock.unlock();
+        counters_.wakeups++;
+        if (!ready()) {
+            counters_.useless++;
+        }
+    }
+
+private:
+    ContentionCounters& counters_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    uint32_t count_ = 0;
+};
+
+// The SPSC rings: a ring per pair, the consumer is notified of data and the producer of room
+static void RunSpsc(int pairs, int items, size_t capacity, ContentionCounters& counters) {
+    std::vector<std::unique_ptr<SpscQueue<int>>> queues;
+    std::vector<std::unique_ptr<TaskNotification>> data_ready, room;
+    for (int pair = 0; pair < pairs; pair++) {
+        queues.push_back(std::make_unique<SpscQueue<int>>(capacity));
+        data_ready.push_back(std::make_unique<TaskNotification>(counters));
+        room.push_back(std::make_unique<TaskNotification>(counters));
+    }
+    std::vector<std::thread> threads;
+    for (int pair = 0; pair < pairs; pair++) {
+        auto& queue = *queues[pair];
+        auto& data = *data_ready[pair];
+        auto& space = *room[pair];
+        threads.emplace_back([&queue, &data, &space, items]() {
+            for (int i = 0; i < items; i++) {
+                while (!queue.Push(i)) {
+                    space.Take([&queue]() { return !queue.Full(); });
+                }
+                data.Give();
+            }
+        });
+        threads.emplace_back([&queue, &data, &space, items]() {
+            int value;
+            for (int i = 0; i < items; i++) {
+                while (!queue.Pop(value)) {
+                    data.Take([&queue]() { return !queue.Empty(); });
+                }
+                space.Give();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+/*
+ * Producer / consumer pairs running at once, like the input task feeding the encoder while the
+ * decoder feeds the output task. Prints lock contention and wakeups per item for both designs.
+ */
+static void TestContentionBenchmark() {
+    const int items = 200000;
+    const size_t capacity = 8;
+    for (int pairs : {1, 2, 3}) {
+        ContentionCounters shared, spsc;
+        int64_t start = NowNs();
+        RunSharedLock(pairs, items, capacity, shared);
+        int64_t shared_ns = NowNs() - start;
+        start = NowNs();
+        RunSpsc(pairs, items, capacity, spsc);
+        int64_t spsc_ns = NowNs() - start;
+
+        double total = (double)pairs * items;
+        printf("%d pair(s), shared lock: %.0f ns, %.3f contended locks, %.3f wakeups (%.3f useless) per item\n",
+            pairs, shared_ns / total, shared.contended / total, shared.wakeups / total, shared.useless / total);
+        printf("%d pair(s), spsc rings:  %.0f ns, %.3f contended locks, %.3f wakeups (%.3f useless) per item\n",
+            pairs, spsc_ns / total, spsc.contended / total, spsc.wakeups / total, spsc.useless / total);
+    }
+}
+
+int main() {
+    TestFifoAndCapacity();
+    TestClear();
+    TestThreads();
+    TestContentionBenchmark();
+    return TestResult();
+}
@@ -0,0 +1,12 @@
+#ifndef ESP_LOG_H
+#define ESP_LOG_H
+
+#include <cstdio>
+
+// Host stand-in for the ESP-IDF logging macros, only errors and warnings are printed
+#define ESP_LOGE(tag, format, ...) printf("E %s: " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) printf("W %s: " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) do {} while (0)
+#define ESP_LOGD(tag, format, ...) do {} while (0)
+
+#endif // ESP_LOG_H
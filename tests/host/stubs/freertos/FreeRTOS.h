@@ -0,0 +1,18 @@
+#ifndef FREERTOS_H
+#define FREERTOS_H
+
+#include <cstdint>
+
+// Host stand-in for the FreeRTOS types used by the tested code
+typedef void* TaskHandle_t;
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef uint8_t StackType_t;
+typedef struct { void* unused; } StaticTask_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define portMAX_DELAY 0xFFFFFFFFu
+
+#endif // FREERTOS_H
@@ -0,0 +1,27 @@
+#ifndef TASK_H
+#define TASK_H
+
+#include <thread>
+
+#include "FreeRTOS.h"
+
+// Host stand-in: a task runs on a detached thread without a handle, notifications go nowhere
+inline BaseType_t xTaskCreate(void (*task)(void*), const char*, uint32_t, void* arg, int, TaskHandle_t* handle) {
+    if (handle != nullptr) {
+        *handle = nullptr;
+    }
+    std::thread(task, arg).detach();
+    return pdPASS;
+}
+// The handle only tells that the task was created, the stack and task buffer stay unused
+inline TaskHandle_t xTaskCreateStatic(void (*task)(void*), const char*, uint32_t, void* arg, int, StackType_t*,
+    StaticTask_t* buffer) {
+    std::thread(task, arg).detach();
+    return buffer;
+}
+inline void vTaskDelete(TaskHandle_t) {}
+inline void vTaskSuspend(TaskHandle_t) {}
+inline void xTaskNotifyGive(TaskHandle_t) {}
+inline uint32_t ulTaskNotifyTake(BaseType_t, TickType_t) { return 0; }
+
+#endif // TASK_H
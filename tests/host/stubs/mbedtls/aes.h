@@ -0,0 +1,48 @@
+#ifndef MBEDTLS_AES_H
+#define MBEDTLS_AES_H
+
+#define OPENSSL_SUPPRESS_DEPRECATED
+#include <openssl/aes.h>
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Host stand-in for the mbedtls AES calls the firmware makes, on the OpenSSL block cipher.
+ * The CTR mode follows mbedtls: the counter block is big endian and advanced per 16 bytes, nc_off
+ * and stream_block carry a partly used key stream block from one call to the next.
+ */
+typedef struct mbedtls_aes_context {
+    AES_KEY key;
+} mbedtls_aes_context;
+
+inline void mbedtls_aes_init(mbedtls_aes_context* ctx) {
+    (void)ctx;
+}
+
+inline void mbedtls_aes_free(mbedtls_aes_context* ctx) {
+    (void)ctx;
+}
+
+inline int mbedtls_aes_setkey_enc(mbedtls_aes_context* ctx, const unsigned char* key, unsigned int keybits) {
+    return AES_set_encrypt_key(key, keybits, &ctx->key) == 0 ? 0 : -1;
+}
+
+inline int mbedtls_aes_crypt_ctr(mbedtls_aes_context* ctx, size_t length, size_t* nc_off,
+    unsigned char nonce_counter[16], unsigned char stream_block[16], const unsigned char* input,
+    unsigned char* output) {
+    size_t n = *nc_off;
+    for (size_t i = 0; i < length; i++) {
+        if (n == 0) {
+            AES_encrypt(nonce_counter, stream_block, &ctx->key);
+            for (int j = 15; j >= 0 && ++nonce_counter[j] == 0; j--) {
+            }
+        }
+        output[i] = input[i] ^ stream_block[n];
+        n = (n + 1) & 0x0F;
+    }
+    *nc_off = n;
+    return 0;
+}
+
+#endif // MBEDTLS_AES_H
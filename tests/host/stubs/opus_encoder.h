@@ -0,0 +1,38 @@
+#ifndef OPUS_ENCODER_H
+#define OPUS_ENCODER_H
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Host stand-in for the Opus encoder wrapper, libopus is not built on the host. Encode() takes a
+ * whole frame, spins for opus_encode_cost_us to stand for the encoder's CPU time and writes a
+ * packet numbered in encoding order.
+ */
+inline int opus_encode_cost_us = 0;
+
+class OpusEncoderWrapper {
+public:
+    OpusEncoderWrapper(int sample_rate, int channels, int duration_ms = 60)
+        : frame_size_(sample_rate * channels * duration_ms / 1000) {}
+
+    void SetComplexity(int) {}
+
+    bool Encode(std::vector<int16_t>&& pcm, std::vector<uint8_t>& opus) {
+        if (pcm.size() != frame_size_) {
+            return false;
+        }
+        auto until = std::chrono::steady_clock::now() + std::chrono::microseconds(opus_encode_cost_us);
+        while (std::chrono::steady_clock::now() < until) {
+        }
+        opus.assign(40, (uint8_t)packets_++);
+        return true;
+    }
+
+private:
+    size_t frame_size_;
+    uint32_t packets_ = 0;
+};
+
+#endif // OPUS_ENCODER_H
@@ -0,0 +1,118 @@
+#include "uplink_gate.h"
+#include "host_test.h"
+
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+// The Kconfig defaults and the lookback of AudioService
+static const int kHangoverMs = 1200;
+static const int kKeepaliveMs = 1000;
+static const int kLookbackMs = 300;
+static const int kFrameMs = 60;
+
+struct SentFrame {
+    int number;
+    uint32_t skipped;
+};
+
+// Runs a VAD pattern through the gate, the first sample of every frame carries its number
+static std::vector<SentFrame> Run(UplinkGate& gate, const std::function<bool(int)>& speaking, int frames,
+    int frame_ms = kFrameMs) {
+    std::vector<SentFrame> sent;
+    for (int i = 0; i < frames; i++) {
+        std::vector<int16_t> pcm(16000 * frame_ms / 1000);
+        pcm[0] = (int16_t)i;
+        gate.Process(std::move(pcm), frame_ms, speaking(i), [&sent](std::vector<int16_t>&& pcm, uint32_t skipped) {
+            sent.push_back({pcm[0], skipped});
+        });
+    }
+    return sent;
+}
+
+static void TestSpeechPassesThrough() {
+    UplinkGate gate(kHangoverMs, kKeepaliveMs, kLookbackMs);
+    auto sent = Run(gate, [](int) { return true; }, 100);
+    CHECK(sent.size() == 100);
+    CHECK(gate.statistics().suppressed == 0 && gate.statistics().keepalive == 0);
+}
+
+static void TestSilence() {
+    UplinkGate gate(kHangoverMs, kKeepaliveMs, kLookbackMs);
+    // 10 frames of speech, then 10 s of silence
+    auto sent = Run(gate, [](int i) { return i < 10; }, 10 + 10000 / kFrameMs);
+
+    // Speech and the 20 frames of hangover go out in full
+    for (int i = 0; i < 30; i++) {
+        CHECK(sent[i].number == i && sent[i].skipped == 0);
+    }
+    // Then one keepalive per second, each after a gap of the frames dropped since the previous one
+    int keepalives = 0;
+    int expected = 30;
+    for (size_t i = 30; i < sent.size(); i++) {
+        CHECK(sent[i].number == expected + (int)sent[i].skipped);
+        expected = sent[i].number + 1;
+        keepalives++;
+    }
+    CHECK(keepalives == (10000 - 1200) / kKeepaliveMs);
+    CHECK(gate.statistics().keepalive == (uint32_t)keepalives);
+    CHECK(gate.statistics().sent + gate.statistics().suppressed + 5 == gate.statistics().frames);
+}
+
+static void TestOnsetLookback() {
+    UplinkGate gate(kHangoverMs, 0, kLookbackMs);
+    // Silence long past the hangover, then speech at frame 50
+    auto sent = Run(gate, [](int i) { return i >= 50; }, 55);
+
+    // The 300 ms before the onset are held and sent first, with the gap in front of them
+    CHECK(sent.size() == 20 + 5 + 5);
+    CHECK(sent[20].number == 45 && sent[20].skipped == 25);
+    for (size_t i = 21; i < sent.size(); i++) {
+        CHECK(sent[i].number == sent[i - 1].number + 1 && sent[i].skipped == 0);
+    }
+
+    gate.Reset();
+    CHECK(gate.statistics().frames == 0);
+    CHECK(Run(gate, [](int) { return false; }, 20).size() == 20);
+}
+
+/*
+ * Uplink bytes per minute with and without the gate. Every sent frame is counted at the size of a
+ * 60 ms frame at the auto bitrate (16 kbps + 1 kbps) plus the MQTT + UDP headers. The Opus DTX of
+ * the uplink encoder shrinks the silent frames that are still sent, which needs libopus and is not
+ * counted here.
+ */
+static void TestBandwidth() {
+    const int opus_bytes = 17000 / 8 * kFrameMs / 1000;
+    const int frame_bytes = opus_bytes + 16 + 28;
+    const int frames = 60000 / kFrameMs;
+
+    struct Scenario {
+        const char* name;
+        std::function<bool(int)> speaking;
+    };
+    Scenario scenarios[] = {
+        {"silent", [](int) { return false; }},
+        // 4 s of speech and 2 s of pause, like a conversation turn with breaks
+        {"talking", [](int i) { return (i * kFrameMs) % 6000 < 4000; }},
+        // 5 s of speech, then listening to the answer for 15 s
+        {"turns", [](int i) { return (i * kFrameMs) % 20000 < 5000; }},
+        {"speech", [](int) { return true; }},
+    };
+    for (auto& scenario : scenarios) {
+        UplinkGate gate(kHangoverMs, kKeepaliveMs, kLookbackMs);
+        auto sent = Run(gate, scenario.speaking, frames);
+        int gated = sent.size() * frame_bytes;
+        int ungated = frames * frame_bytes;
+        printf("%-8s %4zu of %d frames sent: %6d B/min gated, %6d B/min ungated, %2d%% saved\n", scenario.name,
+            sent.size(), frames, gated, ungated, 100 - gated * 100 / ungated);
+    }
+}
+
+int main() {
+    TestSpeechPassesThrough();
+    TestSilence();
+    TestOnsetLookback();
+    TestBandwidth();
+    return TestResult();
+}
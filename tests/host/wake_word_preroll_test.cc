@@ -0,0 +1,138 @@
+#include "wake_word_preroll.h"
+#include "host_test.h"
+
+#include <cstdio>
+#include <deque>
+#include <thread>
+#include <vector>
+
+static const int kSampleRate = 16000;
+static const int kWindowMs = 2000;
+// The AFE hands out 512 sample chunks
+static const size_t kChunkSamples = 512;
+
+/*
+ * Stores seconds of audio in AFE sized chunks. Paced at 8x real time, so the background encoder
+ * keeps up as it does on the device, only faster.
+ */
+static void StoreAudio(WakeWordPreroll& preroll, int milliseconds) {
+    std::vector<int16_t> chunk(kChunkSamples);
+    size_t total = (size_t)kSampleRate * milliseconds / 1000;
+    for (size_t stored = 0; stored < total; stored += kChunkSamples) {
+        preroll.Store(chunk.data(), chunk.size());
+        std::this_thread::sleep_for(std::chrono::microseconds(kChunkSamples * 1000000 / kSampleRate / 8));
+    }
+}
+
+// Collects the pre-roll handed over after Snapshot(), the packets carry their encoding order
+static std::vector<uint8_t> TakePreroll(WakeWordPreroll& preroll) {
+    std::vector<uint8_t> numbers;
+    std::vector<uint8_t> opus;
+    while (preroll.GetOpus(opus)) {
+        numbers.push_back(opus[0]);
+    }
+    return numbers;
+}
+
+static void TestWindow() {
+    WakeWordPreroll preroll(kSampleRate, 60, kWindowMs);
+    StoreAudio(preroll, 3000);
+    preroll.Snapshot();
+    auto numbers = TakePreroll(preroll);
+    // 3 s of audio is 50 frames of 60 ms, the newest 33 make up the window
+    CHECK(numbers.size() == kWindowMs / 60);
+    for (size_t i = 1; i < numbers.size(); i++) {
+        CHECK((uint8_t)(numbers[i] - numbers[i - 1]) == 1);
+    }
+    CHECK(numbers.back() == 49);
+
+    // A second detection starts over from what arrives after the first
+    StoreAudio(preroll, 600);
+    preroll.Snapshot();
+    numbers = TakePreroll(preroll);
+    CHECK(numbers.size() >= 9 && numbers.size() <= 10);
+}
+
+static void TestFrameDuration() {
+    WakeWordPreroll preroll(kSampleRate, 60, kWindowMs);
+    StoreAudio(preroll, 1000);
+    preroll.SetFrameDuration(20);
+    StoreAudio(preroll, 3000);
+    preroll.Snapshot();
+    CHECK(TakePreroll(preroll).size() == kWindowMs / 20);
+}
+
+struct PrerollTimes {
+    int64_t first_us;
+    int64_t all_us;
+};
+
+/* The encoding before the change: the buffered PCM frames are encoded on detection */
+static PrerollTimes EncodeOnDetection() {
+    std::deque<std::vector<int16_t>> pcm;
+    size_t frame_samples = kSampleRate * 60 / 1000;
+    for (int i = 0; i < kWindowMs / 60; i++) {
+        pcm.emplace_back(frame_samples);
+    }
+
+    PrerollTimes times;
+    int64_t start = NowUs();
+    OpusEncoderWrapper encoder(kSampleRate, 1, 60);
+    std::vector<uint8_t> opus;
+    bool first = true;
+    for (auto& frame : pcm) {
+        encoder.Encode(std::move(frame), opus);
+        if (first) {
+            times.first_us = NowUs() - start;
+            first = false;
+        }
+    }
+    times.all_us = NowUs() - start;
+    return times;
+}
+
+/* Now: the window is encoded while the audio arrives, detection only drains the queued frames */
+static PrerollTimes SnapshotAfterStreaming() {
+    WakeWordPreroll preroll(kSampleRate, 60, kWindowMs);
+    StoreAudio(preroll, 2500);
+
+    PrerollTimes times;
+    int64_t start = NowUs();
+    preroll.Snapshot();
+    std::vector<uint8_t> opus;
+    preroll.GetOpus(opus);
+    times.first_us = NowUs() - start;
+    while (preroll.GetOpus(opus)) {
+    }
+    times.all_us = NowUs() - start;
+    return times;
+}
+
+/*
+ * Time from the detection to the pre-roll being ready, with the stand-in encoder taking 1 ms per
+ * 60 ms frame. What scales is the number of frames encoded on the detection path: the whole window
+ * before, at most the frames still queued now.
+ */
+static void TestLatencyBenchmark() {
+    opus_encode_cost_us = 1000;
+    std::vector<int64_t> before_first, before_all, after_first, after_all;
+    for (int round = 0; round < 5; round++) {
+        auto before = EncodeOnDetection();
+        auto after = SnapshotAfterStreaming();
+        before_first.push_back(before.first_us);
+        before_all.push_back(before.all_us);
+        after_first.push_back(after.first_us);
+        after_all.push_back(after.all_us);
+    }
+    printf("pre-roll of %d ms at 1 ms per frame: encode on detection first %lld us, all %lld us; "
+        "background encoding first %lld us, all %lld us\n", kWindowMs, (long long)Median(before_first),
+        (long long)Median(before_all), (long long)Median(after_first), (long long)Median(after_all));
+    opus_encode_cost_us = 0;
+}
+
+int main() {
+    TestWindow();
+    TestFrameDuration();
+    TestLatencyBenchmark();
+    return TestResult();
+}